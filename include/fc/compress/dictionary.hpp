@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fc
+{
+
+  /**
+   *  Content that small messages are compressed against, so that even the first bytes of a message
+   *  can be matches into text it shares with the others: the keys of a JSON log record, the fields of
+   *  a transaction that are the same every time. The compressor and the decompressor must use the
+   *  same dictionary, and the compressed messages don't say which one that was: whatever carries
+   *  them has to record it, e.g. by id().
+   *
+   *  A dictionary is immutable and cheap to copy, and may be used from any number of threads.
+   */
+  class compression_dictionary
+  {
+    public:
+      /** Matches reach 64 KB back, so a larger dictionary only keeps its last 64 KB */
+      static constexpr size_t max_size = 65535;
+      static constexpr size_t default_size = 16 * 1024;
+
+      /** The empty dictionary, which compresses like no dictionary at all */
+      compression_dictionary();
+      /** Any content, e.g. a static table of strings expected in the messages, most common last */
+      compression_dictionary(const char* data, size_t size);
+      explicit compression_dictionary(const std::vector<char>& content);
+
+      /**
+       *  Builds a dictionary of up to @p size bytes from sample messages: the corpus is split into as
+       *  many stretches as there are segments to fill, and from each, the segment whose 8-byte
+       *  substrings are most frequent across all samples (and not already in the dictionary) is
+       *  taken. A few hundred samples like the messages to be compressed are usually enough.
+       */
+      static compression_dictionary train(const std::vector<std::string>& samples, size_t size = default_size);
+      static compression_dictionary train(const std::vector<std::vector<char>>& samples, size_t size = default_size);
+
+      const std::vector<char>& content()const;
+      /** crc32c of the content; not written into the compressed messages */
+      uint32_t id()const;
+
+    private:
+      friend void dictionary_compress(const compression_dictionary&, const char*, size_t, std::vector<char>&);
+      friend void dictionary_decompress(const compression_dictionary&, const char*, size_t, std::vector<char>&);
+
+      class impl;
+      std::shared_ptr<const impl> my;
+  };
+
+  /**
+   *  Compresses one message against @p dict into @p out, replacing its contents: its size as a
+   *  varint, then an LZ4 block whose matches may point into the dictionary. There is no checksum,
+   *  that is left to whatever carries the message.
+   */
+  void dictionary_compress(const compression_dictionary& dict, const char* in, size_t size, std::vector<char>& out);
+  /** Decompresses one message compressed against the same @p dict; damage throws parse_error_exception */
+  void dictionary_decompress(const compression_dictionary& dict, const char* in, size_t size, std::vector<char>& out);
+
+} // namespace fc
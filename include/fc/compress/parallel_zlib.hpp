@@ -0,0 +1,79 @@
+#pragma once
+
+#include <fc/compress/zlib.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace fc
+{
+
+  constexpr size_t parallel_zlib_default_chunk_size = 1024 * 1024;
+
+  /**
+   *  Compresses large inputs on several threads, pigz style: the input is cut into chunks which are
+   *  deflated independently, each chunk as its own zlib stream, so they can be inflated in parallel
+   *  too. Independent chunks cost a little ratio at the start of each one, well under 1% at the
+   *  default 1 MB.
+   *
+   *  The output is a frame of its own: a header, then for every chunk its size, its compressed size
+   *  and the zlib stream, then an end mark.
+   */
+  class parallel_zlib_compressor
+  {
+    public:
+      /** @param threads how many threads compress, the caller included; 0 uses every core */
+      explicit parallel_zlib_compressor(uint32_t threads = 0, int level = zlib_default_level,
+                                        size_t chunk_size = parallel_zlib_default_chunk_size);
+      ~parallel_zlib_compressor();
+
+      parallel_zlib_compressor(parallel_zlib_compressor&&);
+      parallel_zlib_compressor& operator=(parallel_zlib_compressor&&);
+
+      uint32_t threads()const;
+
+      /** Drops the current frame and starts a new one */
+      void reset();
+
+      /**
+       *  Appends the frame for everything written so far to @p out, a batch of chunks (one per
+       *  thread, twice over) at a time, so the input never has to be in memory all at once.
+       */
+      void write(const char* data, size_t size, std::vector<char>& out);
+      /** Ends the frame; reset() before writing another */
+      void finish(std::vector<char>& out);
+
+      /** One whole frame, replacing the contents of @p out */
+      void compress(const char* data, size_t size, std::vector<char>& out);
+
+    private:
+      class impl;
+      std::unique_ptr<impl> my;
+  };
+
+  /** Inflates a frame written by parallel_zlib_compressor, its chunks spread over several threads */
+  class parallel_zlib_decompressor
+  {
+    public:
+      /** @param threads how many threads decompress, the caller included; 0 uses every core */
+      explicit parallel_zlib_decompressor(uint32_t threads = 0);
+      ~parallel_zlib_decompressor();
+
+      parallel_zlib_decompressor(parallel_zlib_decompressor&&);
+      parallel_zlib_decompressor& operator=(parallel_zlib_decompressor&&);
+
+      uint32_t threads()const;
+
+      /**
+       *  One whole frame, replacing the contents of @p out. A truncated frame throws eof_exception,
+       *  a corrupt one parse_error_exception.
+       */
+      void decompress(const char* data, size_t size, std::vector<char>& out);
+
+    private:
+      class impl;
+      std::unique_ptr<impl> my;
+  };
+
+} // namespace fc
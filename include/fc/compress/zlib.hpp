@@ -1,10 +1,138 @@
 #pragma once
 
 #include <fc/string.hpp>
+#include <fc/utility.hpp>
+#include <cstring>
+#include <memory>
+#include <vector>
 
-namespace fc 
+namespace fc
 {
 
+  /** zlib levels: 0 stores, 1 is fastest, 9 smallest and 10 slower still for a little more */
+  constexpr int zlib_default_level = 6;
+
   string zlib_compress(const string& in);
 
+  /**
+   *  Compresses @p size bytes at @p in into @p out, replacing its contents.
+   *  The compressor state is kept per thread and @p out keeps its capacity,
+   *  so repeated calls with the same output vector do not allocate.
+   */
+  void zlib_compress(const char* in, size_t size, std::vector<char>& out, int level = zlib_default_level);
+
+  /** Throws parse_error_exception if the stream inflates to more than @p max_size bytes */
+  string zlib_decompress(const string& in, size_t max_size = MAX_SIZE_OF_BYTE_ARRAYS);
+  /**
+   *  Decompresses one whole zlib stream into @p out, replacing its contents; a stream that inflates
+   *  to more than @p max_size bytes throws parse_error_exception instead of growing @p out further.
+   */
+  void zlib_decompress(const char* in, size_t size, std::vector<char>& out, size_t max_size = MAX_SIZE_OF_BYTE_ARRAYS);
+  /**
+   *  Decompresses one whole zlib stream into [out, out + capacity), for when the size is known up
+   *  front; a stream that does not fit throws parse_error_exception.
+   *  @return the size of the decompressed data
+   */
+  size_t zlib_decompress(const char* in, size_t size, char* out, size_t capacity);
+
+  /**
+   *  Deflates a zlib stream fed in pieces; the compressed output is appended to the caller's vector
+   *  as it becomes ready. The several hundred KB of compressor state is borrowed from a spare kept
+   *  per thread and given back on destruction, so short-lived compressors don't allocate it.
+   */
+  class zlib_compressor
+  {
+    public:
+      explicit zlib_compressor(int level = zlib_default_level);
+      ~zlib_compressor();
+
+      zlib_compressor(zlib_compressor&&);
+      zlib_compressor& operator=(zlib_compressor&&);
+
+      /** Drops the current stream and starts a new one */
+      void reset();
+      void reset(int level);
+
+      void write(const char* data, size_t size, std::vector<char>& out);
+      /** Emits everything written so far, ending on a byte boundary, without ending the stream */
+      void flush(std::vector<char>& out);
+      /** Ends the stream with its adler32 trailer; reset() before writing another */
+      void finish(std::vector<char>& out);
+
+      /** One whole stream, replacing the contents of @p out; anything written before is dropped */
+      void compress(const char* data, size_t size, std::vector<char>& out);
+
+    private:
+      class impl;
+      std::unique_ptr<impl> my;
+  };
+
+  /**
+   *  Inflates a zlib stream fed in pieces of any size, appending the output as it is produced.
+   *  A corrupt stream, or one that inflates to more than max_size bytes in all, throws
+   *  parse_error_exception.
+   */
+  class zlib_decompressor
+  {
+    public:
+      explicit zlib_decompressor(size_t max_size = MAX_SIZE_OF_BYTE_ARRAYS);
+      ~zlib_decompressor();
+
+      zlib_decompressor(zlib_decompressor&&);
+      zlib_decompressor& operator=(zlib_decompressor&&);
+
+      void reset();
+
+      /** @return true once the end of the stream has been reached, after which only empty writes are allowed */
+      bool write(const char* data, size_t size, std::vector<char>& out);
+      bool finished()const;
+
+      /** One whole stream, replacing the contents of @p out; a truncated stream throws eof_exception */
+      void decompress(const char* data, size_t size, std::vector<char>& out);
+      /** One whole stream into [out, out + capacity); @return the size of the decompressed data */
+      size_t decompress(const char* data, size_t size, char* out, size_t capacity);
+
+    private:
+      class impl;
+      std::unique_ptr<impl> my;
+  };
+
+  /**
+   *  Stream adapter for fc::raw::pack that compresses as it goes. Packing issues a write per field,
+   *  so they are collected in a buffer and handed to the compressor a few KB at a time.
+   */
+  class zlib_compress_stream
+  {
+    public:
+      explicit zlib_compress_stream(std::vector<char>& out, int level = zlib_default_level);
+
+      void write(const char* d, size_t dlen)
+      {
+        if (dlen <= sizeof(_buffer) - _size) {
+          memcpy(_buffer + _size, d, dlen);
+          _size += dlen;
+          return;
+        }
+        write_through(d, dlen);
+      }
+
+      void put(char c)
+      {
+        if (_size == sizeof(_buffer)) flush_buffer();
+        _buffer[_size++] = c;
+      }
+
+      /** Ends the stream; the output vector then holds all of it */
+      void finish();
+
+    private:
+      void flush_buffer();
+      void write_through(const char* d, size_t dlen);
+
+      zlib_compressor     _compressor;
+      std::vector<char>&  _out;
+      size_t              _size = 0;
+      char                _buffer[4096];
+  };
+
 } // namespace fc
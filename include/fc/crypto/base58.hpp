@@ -3,8 +3,13 @@
 #include <vector>
 
 namespace fc {
+    /** Room for the base58 text of @p size bytes */
+    constexpr size_t base58_encoded_size_bound( size_t size ) { return size * 138 / 100 + 1; }
+
     std::string to_base58( const char* d, size_t s );
     std::string to_base58( const std::vector<char>& data );
+    /** Writes the text to @p out, which holds base58_encoded_size_bound( s ) chars, and returns its length */
+    size_t to_base58( const char* d, size_t s, char* out );
     std::vector<char> from_base58( const std::string& base58_str );
     size_t from_base58( const std::string& base58_str, char* out_data, size_t out_data_len );
 }
@@ -4,5 +4,19 @@
 
 namespace fc {
 std::string base64_encode(const std::vector<char>& bytes_to_encodes);
+std::string base64_encode(const char* data, size_t size);
 std::string base64_decode( const std::string& encoded_string);
+
+/** Length of the padded base64 text of @p size bytes */
+constexpr size_t base64_encoded_size(size_t size) { return (size + 2) / 3 * 4; }
+/** Room for the bytes decoded from @p size chars */
+constexpr size_t base64_decoded_size_bound(size_t size) { return size / 4 * 3 + 3; }
+
+/** Writes base64_encoded_size( size ) chars to @p out and returns their count */
+size_t base64_encode(const char* data, size_t size, char* out);
+/**
+ * Decodes up to the first padding or non-base64 char into @p out, which holds
+ * base64_decoded_size_bound( size ) bytes; returns the number of bytes decoded
+ */
+size_t base64_decode(const char* encoded, size_t size, char* out);
 }  // namespace fc
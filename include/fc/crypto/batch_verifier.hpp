@@ -0,0 +1,56 @@
+#pragma once
+#include <fc/crypto/public_key.hpp>
+#include <fc/crypto/signature.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/optional.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace fc { namespace crypto {
+
+   /**
+    * Recovers or verifies many signatures at once, spreading the batch over a pool of worker threads.
+    * K1 and R1 signatures can be mixed freely. Every item gets its own result, so one bad signature
+    * doesn't fail the others.
+    *
+    * The calling thread works on the batch too. Batches submitted from several threads at the same
+    * time are processed one after the other.
+    */
+   class batch_verifier
+   {
+      public:
+         struct verify_status { enum type { valid, mismatch, unrecoverable }; };
+
+         struct recovery_result {
+            optional<public_key>  key;
+            exception_ptr         error; // set when the key couldn't be recovered
+
+            bool ok()const { return key.valid(); }
+         };
+
+         /** @param threads how many threads work on a batch, the caller included; 0 uses every core */
+         explicit batch_verifier( uint32_t threads = 0 );
+         ~batch_verifier();
+
+         uint32_t threads()const;
+
+         std::vector<recovery_result> recover( const signature* signatures, const sha256* digests, size_t count,
+                                               bool check_canonical = true )const;
+         std::vector<recovery_result> recover( const std::vector<signature>& signatures, const std::vector<sha256>& digests,
+                                               bool check_canonical = true )const;
+
+         /** Checks that each signature recovers to the matching entry of @p keys */
+         std::vector<verify_status::type> verify( const signature* signatures, const sha256* digests, const public_key* keys,
+                                                  size_t count, bool check_canonical = true )const;
+         std::vector<verify_status::type> verify( const std::vector<signature>& signatures, const std::vector<sha256>& digests,
+                                                  const std::vector<public_key>& keys, bool check_canonical = true )const;
+
+      private:
+         class impl;
+         std::unique_ptr<impl> my;
+   };
+
+} } // fc::crypto
+
+FC_REFLECT_ENUM(fc::crypto::batch_verifier::verify_status::type, (valid)(mismatch)(unrecoverable))
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace fc {
+
+   /**
+    * Stream adapter for fc::raw::pack into a digest encoder.
+    *
+    * Packing a struct issues a write per field, a single byte for every varint, and each of those
+    * would otherwise be a separate hash update call. The writes are collected in a block-aligned buffer
+    * instead and reach the encoder in multiples of the 64-byte hash block, so the hash function
+    * compresses whole blocks straight from the buffer.
+    */
+   template<typename Encoder, uint32_t BufferSize = 256>
+   class buffered_hash_stream
+   {
+      static_assert( BufferSize >= 64 && BufferSize % 64 == 0, "the buffer must hold whole hash blocks" );
+
+      public:
+         using result_type = decltype( std::declval<Encoder&>().result() );
+
+         void write( const char* d, uint32_t dlen )
+         {
+            if( dlen <= BufferSize - _size ) {
+               std::memcpy( _buffer + _size, d, dlen );
+               _size += dlen;
+               return;
+            }
+            write_through( d, dlen );
+         }
+
+         void put( char c )
+         {
+            if( _size == BufferSize ) flush();
+            _buffer[_size++] = c;
+         }
+
+         void reset()
+         {
+            _size = 0;
+            _encoder.reset();
+         }
+
+         result_type result()
+         {
+            flush();
+            return _encoder.result();
+         }
+
+      private:
+         void flush()
+         {
+            if( _size ) {
+               _encoder.write( _buffer, _size );
+               _size = 0;
+            }
+         }
+
+         void write_through( const char* d, uint32_t dlen )
+         {
+            const uint32_t fill = BufferSize - _size;
+            std::memcpy( _buffer + _size, d, fill );
+            _encoder.write( _buffer, BufferSize );
+            d += fill;
+            dlen -= fill;
+
+            // whole blocks of a large write skip the buffer
+            const uint32_t blocks = dlen & ~uint32_t(63);
+            if( blocks ) {
+               _encoder.write( d, blocks );
+               d += blocks;
+               dlen -= blocks;
+            }
+            std::memcpy( _buffer, d, dlen );
+            _size = dlen;
+         }
+
+         alignas(64) char  _buffer[BufferSize];
+         uint32_t          _size = 0;
+         Encoder           _encoder;
+   };
+
+} // namespace fc
@@ -0,0 +1,35 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+namespace fc {
+
+    /**
+     * CRC-32C (Castagnoli, as used by iSCSI, ext4 and LevelDB) of [data, data + size), continuing
+     * from @p crc, the checksum of whatever came before it; crc32c( "123456789", 9 ) is 0xe3069283.
+     *
+     * Uses the SSE4.2 crc32 instruction when the CPU has it, running three streams at once over
+     * large buffers, and slicing-by-8 tables otherwise.
+     */
+    uint32_t crc32c( const char* data, size_t size, uint32_t crc = 0 );
+
+    /**
+     * The checksum of a buffer A followed by a buffer B, from crc32c() of each and the size of B,
+     * so pieces checksummed separately (or by different threads) can be joined.
+     */
+    uint32_t crc32c_combine( uint32_t crc_a, uint32_t crc_b, size_t size_b );
+
+    /** Streaming crc32c(), usable as a datastream for fc::raw::pack */
+    class crc32c_encoder
+    {
+      public:
+        void write( const char* d, uint32_t dlen ) { _crc = crc32c( d, dlen, _crc ); }
+        void put( char c ) { write( &c, 1 ); }
+        void reset() { _crc = 0; }
+        uint32_t result()const { return _crc; }
+
+      private:
+        uint32_t _crc = 0;
+    };
+
+} // namespace fc
@@ -2,13 +2,14 @@
 #include <fc/io/raw.hpp>
 #include <fc/reflect/reflect.hpp>
 #include <fc/crypto/sha256.hpp>
+#include <fc/crypto/buffered_hash_stream.hpp>
 
 namespace fc {
 
    template<typename T>
    fc::sha256 digest( const T& value )
    {
-      fc::sha256::encoder enc;
+      buffered_hash_stream<fc::sha256::encoder> enc;
       fc::raw::pack( enc, value );
       return enc.result();
    }
@@ -124,7 +124,8 @@ namespace fc {
            fc::sha512 get_shared_secret( const public_key& pub )const;
 
 //           signature         sign( const fc::sha256& digest )const;
-           compact_signature sign_compact( const fc::sha256& digest, bool require_canonical = true )const;
+           /** @param attempts if set, receives how many signatures were made to find a canonical one */
+           compact_signature sign_compact( const fc::sha256& digest, bool require_canonical = true, uint32_t* attempts = nullptr )const;
 //           bool              verify( const fc::sha256& digest, const signature& sig );
 
            public_key get_public_key()const;
@@ -108,6 +108,8 @@ namespace fc {
 
            signature         sign( const fc::sha256& digest )const;
            compact_signature sign_compact( const fc::sha256& digest )const;
+           /** For callers that keep this key's serialized public key around, so it isn't derived again */
+           compact_signature sign_compact( const fc::sha256& digest, const public_key_data& pub )const;
            bool              verify( const fc::sha256& digest, const signature& sig );
 
            public_key get_public_key()const;
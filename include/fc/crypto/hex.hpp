@@ -7,9 +7,12 @@ namespace fc {
     uint8_t from_hex( char c );
     fc::string to_hex( const char* d, uint32_t s );
     std::string to_hex( const std::vector<char>& data );
+    /** Writes the 2 * s chars to @p out and returns their count */
+    size_t to_hex( const char* d, size_t s, char* out );
 
     /**
      *  @return the number of bytes decoded
      */
     size_t from_hex( const fc::string& hex_str, char* out_data, size_t out_data_len );
+    size_t from_hex( const char* hex, size_t hex_len, char* out_data, size_t out_data_len );
 } 
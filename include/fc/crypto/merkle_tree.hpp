@@ -0,0 +1,56 @@
+#pragma once
+#include <fc/crypto/sha256.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace fc {
+
+   /**
+    * Binary Merkle tree over sha256 leaves, with the same shape as sha256::merkle_root: a parent is the
+    * hash of the 64-byte concatenation of its children, and the last node of an odd level is paired
+    * with itself.
+    *
+    * Every level is kept, so appending leaves only rehashes the nodes between the new leaves and the
+    * root, and proofs are read straight off the stored levels. Levels wide enough to be worth it are
+    * hashed by several threads at once.
+    */
+   class merkle_tree
+   {
+      public:
+         struct proof {
+            uint64_t              index = 0;
+            /** the sibling of every node on the way up, leaf level first */
+            std::vector<sha256>   path;
+         };
+
+         /** @param threads how many threads hash a wide level, the caller included; 0 uses every core */
+         explicit merkle_tree( uint32_t threads = 1 );
+         explicit merkle_tree( const std::vector<sha256>& leaves, uint32_t threads = 1 );
+         ~merkle_tree();
+
+         merkle_tree( merkle_tree&& );
+         merkle_tree& operator = ( merkle_tree&& );
+
+         void append( const sha256& leaf );
+         void append( const sha256* leaves, size_t count );
+         void append( const std::vector<sha256>& leaves );
+
+         size_t size()const;
+         const sha256& leaf( size_t index )const;
+
+         /** All zero for an empty tree, the leaf itself for a single one */
+         sha256 root()const;
+
+         proof prove( size_t index )const;
+         static bool verify( const sha256& leaf, const proof& p, const sha256& root );
+
+      private:
+         class impl;
+         std::unique_ptr<impl> my;
+   };
+
+} // namespace fc
+
+FC_REFLECT( fc::merkle_tree::proof, (index)(path) )
@@ -60,6 +60,7 @@ namespace fc { namespace crypto {
          friend bool operator != ( const private_key& p1, const private_key& p2);
          friend bool operator < ( const private_key& p1, const private_key& p2);
          friend struct reflector<private_key>;
+         friend class signing_key;
    }; // private_key
 
 } }  // fc::crypto
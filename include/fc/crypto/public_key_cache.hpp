@@ -0,0 +1,50 @@
+#pragma once
+#include <fc/crypto/public_key.hpp>
+#include <fc/crypto/signature.hpp>
+#include <fc/optional.hpp>
+
+#include <memory>
+
+namespace fc { namespace crypto {
+
+   /**
+    * Bounded LRU cache of public keys recovered from (signature, digest) pairs, for callers which
+    * recover the same signatures over and over (e.g. when a transaction is received, admitted and
+    * then validated in a block).
+    *
+    * Entries are spread over independently locked shards, each evicting its own least recently used
+    * entry when full, so concurrent lookups rarely contend. Failed recoveries are not cached.
+    */
+   class public_key_cache
+   {
+      public:
+         struct stats {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t evictions = 0;
+            uint64_t size = 0;
+         };
+
+         /** @param shards rounded up to a power of two */
+         explicit public_key_cache( size_t capacity = 1 << 16, uint32_t shards = 16 );
+         ~public_key_cache();
+
+         /** Same as public_key( sig, digest, check_canonical ), served from the cache when possible */
+         public_key recover( const signature& sig, const sha256& digest, bool check_canonical = true );
+
+         optional<public_key> find( const signature& sig, const sha256& digest, bool check_canonical = true );
+         void insert( const signature& sig, const sha256& digest, const public_key& key, bool check_canonical = true );
+
+         void clear();
+
+         size_t capacity()const;
+         stats get_stats()const;
+
+      private:
+         class impl;
+         std::unique_ptr<impl> my;
+   };
+
+} } // fc::crypto
+
+FC_REFLECT(fc::crypto::public_key_cache::stats, (hits)(misses)(evictions)(size))
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <fc/fwd.hpp>
+#include <fc/crypto/buffered_hash_stream.hpp>
 #include <fc/io/raw_fwd.hpp>
 #include <fc/reflect/typename.hpp>
 
@@ -28,7 +29,7 @@ class ripemd160
     template<typename T>
     static ripemd160 hash( const T& t ) 
     { 
-      ripemd160::encoder e; 
+      buffered_hash_stream<ripemd160::encoder> e; 
       fc::raw::pack(e,t);
       return e.result(); 
     } 
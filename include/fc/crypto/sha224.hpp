@@ -1,6 +1,7 @@
 #pragma once
 #include <unordered_map>
 #include <fc/fwd.hpp>
+#include <fc/crypto/buffered_hash_stream.hpp>
 #include <fc/io/raw_fwd.hpp>
 #include <fc/string.hpp>
 
@@ -25,7 +26,7 @@ class sha224
     template<typename T>
     static sha224 hash( const T& t ) 
     { 
-      sha224::encoder e; 
+      buffered_hash_stream<sha224::encoder> e; 
       fc::raw::pack(e,t);
       return e.result(); 
     } 
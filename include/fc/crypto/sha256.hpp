@@ -1,9 +1,12 @@
 #pragma once
 #include <fc/fwd.hpp>
+#include <fc/crypto/buffered_hash_stream.hpp>
 #include <fc/string.hpp>
 #include <fc/platform_independence.hpp>
 #include <fc/io/raw_fwd.hpp>
 
+#include <vector>
+
 namespace fc
 {
 
@@ -24,10 +27,37 @@ class sha256
     static sha256 hash( const string& );
     static sha256 hash( const sha256& );
 
+    struct engine { enum type { automatic, scalar, avx2, shani }; };
+
+    /** One of the messages handed to hash_many */
+    struct input {
+      const char* data;
+      size_t      size;
+    };
+
+    /**
+     * Hashes @p count independent messages into @p out. Messages are processed with the SHA
+     * extensions when the CPU has them, eight at a time in AVX2 lanes otherwise, and one by one
+     * through OpenSSL as the last resort.
+     */
+    static void hash_many( const input* messages, size_t count, sha256* out );
+    static std::vector<sha256> hash_many( const std::vector<input>& messages );
+
+    /**
+     * Root of the binary Merkle tree over @p leaves. Each level hashes the 64-byte concatenation of
+     * neighbouring nodes with hash_many; an odd node at the end of a level is paired with itself.
+     * No leaves give an all-zero hash.
+     */
+    static sha256 merkle_root( std::vector<sha256> leaves );
+
+    /** Forces the hash_many implementation; returns false if this CPU can't run it */
+    static bool set_hash_many_engine( engine::type e );
+    static engine::type hash_many_engine();
+
     template<typename T>
     static sha256 hash( const T& t ) 
     { 
-      sha256::encoder e; 
+      buffered_hash_stream<sha256::encoder> e; 
       fc::raw::pack(e,t);
       return e.result(); 
     } 
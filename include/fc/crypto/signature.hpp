@@ -42,6 +42,7 @@ namespace fc { namespace crypto {
          friend struct reflector<signature>;
          friend class private_key;
          friend class public_key;
+         friend class signing_key;
    }; // public_key
 
    size_t hash_value(const signature& b);
@@ -0,0 +1,49 @@
+#pragma once
+#include <fc/crypto/private_key.hpp>
+#include <fc/crypto/public_key.hpp>
+#include <fc/crypto/signature.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace fc { namespace crypto {
+
+   /**
+    * A private key held ready for signing many digests. private_key::sign rebuilds the curve key from
+    * its secret and derives the public key again for every signature (R1 needs it to find the recovery
+    * id); this does both once, up front. A K1 key is only its secret, so K1 signing costs the same
+    * either way, and gains only from spreading sign_many over threads.
+    *
+    * K1 signatures are the same as private_key::sign gives. sign() may be called from several threads
+    * at once; batches passed to sign_many from several threads are signed one after the other.
+    */
+   class signing_key
+   {
+      public:
+         /** @param threads how many threads sign a batch, the caller included; 0 uses every core */
+         explicit signing_key( const private_key& key, uint32_t threads = 1 );
+         ~signing_key();
+
+         signing_key( signing_key&& );
+         signing_key& operator = ( signing_key&& );
+
+         const private_key& get_private_key()const;
+         const public_key& get_public_key()const;
+
+         /**
+          * @param attempts if set, receives how many signatures were made to find a canonical one;
+          *        K1 keeps trying new nonces until it finds one, R1 always takes one
+          */
+         signature sign( const sha256& digest, bool require_canonical = true, uint32_t* attempts = nullptr )const;
+
+         /** @param attempts if set, @p count entries receiving the attempts behind each signature */
+         std::vector<signature> sign_many( const sha256* digests, size_t count, bool require_canonical = true,
+                                           uint32_t* attempts = nullptr )const;
+         std::vector<signature> sign_many( const std::vector<sha256>& digests, bool require_canonical = true )const;
+
+      private:
+         class impl;
+         std::unique_ptr<impl> my;
+   };
+
+} } // fc::crypto
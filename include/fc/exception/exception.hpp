@@ -48,6 +48,10 @@ namespace fc
     *  At each level in the stack where the exception is caught and rethrown a
     *  new log_message is added to the exception.
     *
+    *  Copies share their state, so passing exceptions between threads or through
+    *  dynamic_copy_exception() is O(1).  append_log() copies the state first if it
+    *  is shared, so a copy never sees messages appended to another one.
+    *
     *  exception's are designed to be serialized to a variant and
     *  deserialized from an variant.
     *
@@ -88,6 +92,20 @@ namespace fc
          static void enable_detailed_strace(bool value = true);
          static bool is_detailed_strace();
 
+         /**
+          *  Which exceptions record the call stack they were created on.  Recording only
+          *  walks the return addresses, they are symbolized the first time strace() is called.
+          */
+         struct strace_policy { enum type {
+            never,     ///< strace() is empty
+            sampled,   ///< one in every sample_every exceptions created by a thread records it
+            always     ///< every exception records it
+         }; };
+
+         /** applies to exceptions created from now on, by all threads */
+         static void set_strace_policy( strace_policy::type policy, uint32_t sample_every = 100 );
+         static strace_policy::type get_strace_policy();
+
          /**
           *   @return a reference to log messages that have
           *   been added to this log.
@@ -134,7 +152,10 @@ namespace fc
          exception& operator=( const exception& copy );
          exception& operator=( exception&& copy );
       protected:
-         std::unique_ptr<detail::exception_impl> my;
+         /** the state of this exception, copied first if other exceptions share it */
+         detail::exception_impl& unique_impl();
+
+         std::shared_ptr<detail::exception_impl> my;
    };
 
    void to_variant( const exception& e, variant& v );
@@ -30,12 +30,51 @@ namespace fc {
 
   class mapped_region {
     public:
+      /** How the region is going to be read, for advise() */
+      enum advice_type {
+        normal_access,
+        sequential_access,
+        random_access,
+        will_need,        ///< start reading it in now
+        dont_need         ///< drop it from memory; a shared mapping reads it back from the file
+      };
+
+      /** How the region is mapped, or'ed together */
+      enum map_flags {
+        default_map  = 0,
+        prefault_map = 1, ///< read all of it in while mapping, instead of a page fault at a time
+        huge_pages   = 2, ///< ask for transparent huge pages, where the kernel does them for this kind of file
+        locked_map   = 4  ///< keep it in RAM, as lock(); throws if the RLIMIT_MEMLOCK is too low
+      };
+
       mapped_region( const file_mapping& fm, mode_t m, uint64_t start, size_t size );
+      mapped_region( const file_mapping& fm, mode_t m, uint64_t start, size_t size, uint32_t flags );
       mapped_region( const file_mapping& fm, mode_t m );
       ~mapped_region();
       void  flush();
+      /** flush(), waiting for the writes to reach the disk; flush() only starts them */
+      void  sync();
       void* get_address()const;
       size_t get_size()const;
+
+      /** Hints for the kernel's read-ahead and caching; @return false where they aren't supported */
+      bool advise( advice_type a );
+      /** The same for [offset, offset + size) of the region, widened to whole pages */
+      bool advise( advice_type a, size_t offset, size_t size );
+
+      /**
+       *  Faults every page in now, so the first pass over the region doesn't pay for it.
+       *  @param for_write also makes the pages writable, where the kernel can do that without
+       *         writing to them (Linux 5.14); otherwise the first write to each page still faults
+       */
+      void prefault( bool for_write = false );
+
+      /** Keeps the region in RAM; @return false if the system refuses, e.g. over RLIMIT_MEMLOCK */
+      bool lock();
+      void unlock();
+
+      static size_t page_size();
+
     private:
       fc::fwd<boost::interprocess::mapped_region,40> my;
   };
@@ -17,7 +17,7 @@ namespace fc
             void flush();
 
           protected:
-            void open( const fc::path& file, size_t s, bool create );
+            void open( const fc::path& file, size_t s, bool create, uint32_t flags );
             std::unique_ptr<fc::file_mapping>  _file_mapping;
             std::unique_ptr<fc::mapped_region> _mapped_region;
        };
@@ -36,13 +36,14 @@ namespace fc
         mmap_struct():_mapped_struct(nullptr){}
         /**
          *  Create the file if it does not exist or is of the wrong size if create is true, then maps
-         *  the file to memory.
+         *  the file to memory. A file on hugetlbfs is sized up to a whole number of huge pages.
          *
+         *  @param flags mapped_region::map_flags for the mapping
          *  @throw an exception if the file does not exist or is the wrong size and create is false
          */
-        void open( const fc::path& file, bool create = false )
+        void open( const fc::path& file, bool create = false, uint32_t flags = mapped_region::default_map )
         {
-            detail::mmap_struct_base::open( file, sizeof(T), create ); 
+            detail::mmap_struct_base::open( file, sizeof(T), create, flags ); 
             _mapped_struct = (T*)_mapped_region->get_address();
         }
 
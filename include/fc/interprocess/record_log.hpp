@@ -0,0 +1,107 @@
+#pragma once
+#include <fc/io/datastream.hpp>
+#include <fc/io/raw.hpp>
+#include <memory>
+
+namespace fc
+{
+   class path;
+
+   /**
+    *  @class record_log
+    *  @brief An append-only file of records, numbered from 0, mapped into memory for reading.
+    *
+    *  Each record is its size and a crc32c of the size and content, followed by the content. A
+    *  second file, the log's name with ".index" added, is a table of where every record starts,
+    *  so any record is read in O(1) straight from the mapping, without copying it.
+    *
+    *  Appends are written to the mapping; flush() makes them durable, log first, then the index.
+    *  On open, the index is trusted up to the last flush() and the records past it are checked
+    *  against their crc32c; the first that doesn't match, torn by a crash, is where the log ends,
+    *  and it is cut off there. A missing or damaged index is rebuilt from the log.
+    *
+    *  Streams from read(), and anything unpacked from them that points into the mapping, are only
+    *  valid until the next append, truncate or close: a growing log is mapped again.
+    *
+    *  Not thread safe.
+    */
+   class record_log
+   {
+      public:
+        /** Larger records could be garbage that happens to parse, and are taken as the end of the log */
+        static constexpr size_t max_record_size = 1024 * 1024 * 1024;
+
+        record_log();
+        /** open( file ) */
+        explicit record_log( const fc::path& file );
+        ~record_log();
+
+        /** Opens the log at @p file, creating it if it doesn't exist, and recovers it as described above */
+        void open( const fc::path& file );
+        /** flush()es and trims the files down to the records in them */
+        void close();
+        bool is_open()const;
+
+        /** The number of records */
+        uint64_t size()const;
+        /** The number of bytes in the log, record headers included */
+        uint64_t bytes()const;
+
+        /** Appends a record, @return its sequence number */
+        uint64_t append( const char* data, size_t size );
+        /** Appends @p v fc::raw::pack()ed, straight into the mapping; @return its sequence number */
+        template<typename T>
+        uint64_t pack( const T& v )
+        {
+           const size_t size = fc::raw::pack_size( v );
+           datastream<char*> ds( begin_append( size ), size );
+           fc::raw::pack( ds, v );
+           return end_append( size );
+        }
+
+        /** Record @p seq, in place; throws out_of_range_exception past the end */
+        datastream<const char*> read( uint64_t seq )const;
+        /** Record @p seq, fc::raw::unpack()ed */
+        template<typename T>
+        T unpack( uint64_t seq )const
+        {
+           auto ds = read( seq );
+           T v;
+           fc::raw::unpack( ds, v );
+           return v;
+        }
+        /** Checks record @p seq against its crc32c; records are only checked on open when recovering */
+        bool verify( uint64_t seq )const;
+
+        /**
+         *  Calls @p f( seq, datastream<const char*>& ) with every record from @p first on, in order,
+         *  telling the kernel to read ahead. @p f must not append to or truncate the log.
+         */
+        template<typename F>
+        void for_each( uint64_t first, F&& f )const
+        {
+           const uint64_t last = size();
+           if( first >= last ) return;
+           advise_sequential( first );
+           for( uint64_t seq = first; seq < last; ++seq )
+           {
+              auto ds = read( seq );
+              f( seq, ds );
+           }
+        }
+
+        /** Drops the records from @p count on */
+        void truncate( uint64_t count );
+        /** Makes everything appended so far durable */
+        void flush();
+
+      private:
+        char*    begin_append( size_t size );
+        uint64_t end_append( size_t size );
+        void     advise_sequential( uint64_t first )const;
+
+        class impl;
+        std::unique_ptr<impl> my;
+   };
+
+}
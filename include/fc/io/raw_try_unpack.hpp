@@ -0,0 +1,498 @@
+#pragma once
+#include <fc/io/raw.hpp>
+
+#include <array>
+#include <type_traits>
+
+namespace fc {
+   namespace raw {
+
+   /**
+    *  @brief Outcome of try_unpack(), which reports malformed input without throwing.
+    *
+    *  Failing is cheap: the kind and byte offset are recorded where decoding stopped, and
+    *  every level it returns through adds a field name or element index.  The path is only
+    *  rendered into a string when type_path() or to_string() is called.
+    */
+   class unpack_status
+   {
+      public:
+         enum error_kind
+         {
+            ok,
+            out_of_range,  ///< the input ended before the value did
+            too_large,     ///< a length prefix above MAX_NUM_ARRAY_ELEMENTS or MAX_SIZE_OF_BYTE_ARRAYS
+            invalid_value, ///< e.g. a bool other than 0/1 or a static_variant tag out of range
+            exception      ///< thrown by a type without a try_unpack overload, or by its reflector_init()
+         };
+         typedef const char* (*type_name_func)();
+
+         explicit operator bool()const { return _kind == ok; }
+         error_kind    kind()const     { return _kind;       }
+         /** position in the stream where decoding stopped */
+         size_t        offset()const   { return _offset;     }
+
+         /** e.g. "transaction.actions[2].data (std::vector<char>)" */
+         std::string   type_path()const;
+         std::string   to_string()const;
+
+         /** @name used by try_unpack() overloads */
+         ///@{
+         bool fail( error_kind kind, size_t offset, type_name_func type )
+         {
+            _kind   = kind;
+            _offset = offset;
+            _leaf   = type;
+            return false;
+         }
+         bool in_field( const char* name )   { return push( { name, 0 } ); }
+         bool in_element( uint32_t index )   { return push( { nullptr, index } ); }
+         void set_root( type_name_func type ) { _root = type; }
+         ///@}
+
+      private:
+         struct frame
+         {
+            const char* field; ///< null for an element index
+            uint32_t    index;
+         };
+
+         bool push( const frame& f )
+         {
+            if( _depth < _frames.size() )
+               _frames[_depth] = f;
+            ++_depth;
+            return false;
+         }
+
+         error_kind                 _kind   = ok;
+         size_t                     _offset = 0;
+         type_name_func             _leaf   = nullptr;
+         type_name_func             _root   = nullptr;
+         uint32_t                   _depth  = 0;    ///< may exceed _frames.size(), the outermost are dropped
+         std::array<frame, 16>      _frames;        ///< innermost first
+   };
+
+   const char* to_string( unpack_status::error_kind kind );
+
+    template<typename Stream> bool try_unpack( Stream& s, bool& v, unpack_status& st );
+    template<typename Stream> bool try_unpack( Stream& s, unsigned_int& v, unpack_status& st );
+    template<typename Stream> bool try_unpack( Stream& s, signed_int& v, unpack_status& st );
+    template<typename Stream> bool try_unpack( Stream& s, std::string& v, unpack_status& st );
+    template<typename Stream> bool try_unpack( Stream& s, std::vector<char>& v, unpack_status& st );
+    template<typename Stream> bool try_unpack( Stream& s, fc::time_point& v, unpack_status& st );
+    template<typename Stream> bool try_unpack( Stream& s, fc::time_point_sec& v, unpack_status& st );
+    template<typename Stream> bool try_unpack( Stream& s, fc::microseconds& v, unpack_status& st );
+    template<typename Stream, typename T> bool try_unpack( Stream& s, std::vector<T>& v, unpack_status& st );
+    template<typename Stream, typename T> bool try_unpack( Stream& s, std::deque<T>& v, unpack_status& st );
+    template<typename Stream, typename T> bool try_unpack( Stream& s, std::set<T>& v, unpack_status& st );
+    template<typename Stream, typename T> bool try_unpack( Stream& s, std::unordered_set<T>& v, unpack_status& st );
+    template<typename Stream, typename K, typename V> bool try_unpack( Stream& s, std::map<K,V>& v, unpack_status& st );
+    template<typename Stream, typename K, typename V> bool try_unpack( Stream& s, std::unordered_map<K,V>& v, unpack_status& st );
+    template<typename Stream, typename K, typename V> bool try_unpack( Stream& s, std::pair<K,V>& v, unpack_status& st );
+    template<typename Stream, typename T> bool try_unpack( Stream& s, fc::optional<T>& v, unpack_status& st );
+    template<typename Stream, typename T> bool try_unpack( Stream& s, std::shared_ptr<T>& v, unpack_status& st );
+    template<typename Stream, typename T, std::size_t N> bool try_unpack( Stream& s, std::array<T,N>& v, unpack_status& st );
+    template<typename Stream, typename T, std::size_t N> bool try_unpack( Stream& s, fc::array<T,N>& v, unpack_status& st );
+    template<typename Stream, typename... T> bool try_unpack( Stream& s, static_variant<T...>& v, unpack_status& st );
+    template<typename Stream, typename T> bool try_unpack( Stream& s, T& v, unpack_status& st );
+
+    namespace detail {
+
+      template<typename Stream>
+      inline bool try_read( Stream& s, char* d, size_t size, unpack_status& st, unpack_status::type_name_func type )
+      {
+         if( s.remaining() < size )
+            return st.fail( unpack_status::out_of_range, s.tellp(), type );
+         s.read( d, size );
+         return true;
+      }
+
+      template<typename Stream>
+      inline bool try_unpack_size( Stream& s, uint32_t max, uint32_t& size, unpack_status& st )
+      {
+         const size_t start = s.tellp();
+         unsigned_int n;
+         if( !try_unpack( s, n, st ) )
+            return false;
+         if( n.value > max )
+            return st.fail( unpack_status::too_large, start, &get_typename<unsigned_int>::name );
+         size = n.value;
+         return true;
+      }
+
+      /** elements may be default constructed and filled in place */
+      template<typename Stream, typename Range>
+      inline bool try_unpack_elements( Stream& s, Range& range, unpack_status& st )
+      {
+         uint32_t i = 0;
+         for( auto& e : range ) {
+            if( !try_unpack( s, e, st ) )
+               return st.in_element( i );
+            ++i;
+         }
+         return true;
+      }
+
+      /** elements are decoded one by one and then inserted */
+      template<typename Stream, typename Element, typename Container>
+      inline bool try_unpack_inserted( Stream& s, Container& c, unpack_status& st )
+      {
+         uint32_t size;
+         if( !try_unpack_size( s, MAX_NUM_ARRAY_ELEMENTS, size, st ) )
+            return false;
+         c.clear();
+         for( uint32_t i = 0; i < size; ++i ) {
+            Element tmp;
+            if( !try_unpack( s, tmp, st ) )
+               return st.in_element( i );
+            c.insert( std::move(tmp) );
+         }
+         return true;
+      }
+
+      template<typename Stream, typename Class>
+      struct try_unpack_object_visitor : public fc::reflector_init_visitor<Class>
+      {
+         try_unpack_object_visitor( Class& c, Stream& s, unpack_status& st )
+         :fc::reflector_init_visitor<Class>(c), s(s), st(st){}
+
+         template<typename T, typename C, T(C::*p)>
+         inline void operator()( const char* name )const
+         {
+            if( st && !try_unpack( s, this->obj.*p, st ) )
+               st.in_field( name );
+         }
+
+         void reflector_init()
+         {
+            if( !st )
+               return;
+            try {
+               fc::reflector_init_visitor<Class>::reflector_init();
+            } catch( const fc::exception& ) {
+               st.fail( unpack_status::exception, s.tellp(), &get_typename<Class>::name );
+            }
+         }
+
+         Stream&        s;
+         unpack_status& st;
+      };
+
+      template<typename Stream, typename T>
+      inline bool try_unpack_unreflected( Stream& s, T& v, unpack_status& st, std::false_type /*is_class*/ )
+      {
+         return try_read( s, (char*)&v, sizeof(v), st, &get_typename<T>::name );
+      }
+
+      template<typename Stream, typename T>
+      inline bool try_unpack_unreflected( Stream& s, T& v, unpack_status& st, std::true_type /*is_class*/ )
+      {
+         // a type with its own unpack, which reports errors only by throwing
+         const size_t start = s.tellp();
+         try {
+            fc::raw::unpack( s, v );
+            return true;
+         } catch( const fc::exception& ) {
+            return st.fail( unpack_status::exception, start, &get_typename<T>::name );
+         }
+      }
+
+      template<typename Stream, typename T>
+      inline bool try_unpack_reflected( Stream& s, T& v, unpack_status& st, fc::true_type /*is_enum*/ )
+      {
+         int64_t temp;
+         if( !try_read( s, (char*)&temp, sizeof(temp), st, &get_typename<T>::name ) )
+            return false;
+         v = (T)temp;
+         return true;
+      }
+
+      template<typename Stream, typename T>
+      inline bool try_unpack_reflected( Stream& s, T& v, unpack_status& st, fc::false_type /*is_enum*/ )
+      {
+         fc::reflector<T>::visit( try_unpack_object_visitor<Stream,T>( v, s, st ) );
+         return bool(st);
+      }
+
+      /**
+       *  Whether unpack() picks an overload of its own for T over the generic one, which decodes a
+       *  reflected T field by field.  Only for reflected types, where the generic one compiles.
+       *  Like unpack() itself, it finds overloads declared before fc/io/raw.hpp is included.
+       */
+      template<typename Stream, typename T>
+      constexpr bool has_own_unpack = static_cast<void(*)( Stream&, T& )>( &fc::raw::unpack )
+                                   != static_cast<void(*)( Stream&, T& )>( &fc::raw::unpack<Stream, T> );
+
+      template<typename Stream, typename T>
+      inline bool try_unpack_dispatch( Stream& s, T& v, unpack_status& st, fc::true_type /*is_reflected*/ )
+      {
+         // a wire format of its own wins over the reflection, as in unpack()
+         if constexpr( has_own_unpack<Stream, T> )
+            return try_unpack_unreflected( s, v, st, std::true_type() );
+         else
+            return try_unpack_reflected( s, v, st, typename fc::reflector<T>::is_enum() );
+      }
+
+      template<typename Stream, typename T>
+      inline bool try_unpack_dispatch( Stream& s, T& v, unpack_status& st, fc::false_type /*is_reflected*/ )
+      {
+         return try_unpack_unreflected( s, v, st, std::is_class<T>() );
+      }
+
+    } // namespace detail
+
+    template<typename Stream>
+    inline bool try_unpack( Stream& s, bool& v, unpack_status& st )
+    {
+       const size_t start = s.tellp();
+       uint8_t b;
+       if( !detail::try_read( s, (char*)&b, 1, st, &get_typename<bool>::name ) )
+          return false;
+       if( b & ~1 )
+          return st.fail( unpack_status::invalid_value, start, &get_typename<bool>::name );
+       v = b != 0;
+       return true;
+    }
+
+    // same decoding as unpack(), including ignoring bits past the 5th byte
+    template<typename Stream>
+    inline bool try_unpack( Stream& s, unsigned_int& vi, unpack_status& st )
+    {
+       uint64_t v = 0; char b = 0; uint8_t by = 0;
+       do {
+          if( !s.remaining() )
+             return st.fail( unpack_status::out_of_range, s.tellp(), &get_typename<unsigned_int>::name );
+          s.get( b );
+          v |= uint32_t(uint8_t(b) & 0x7f) << by;
+          by += 7;
+       } while( uint8_t(b) & 0x80 && by < 32 );
+       vi.value = static_cast<uint32_t>(v);
+       return true;
+    }
+
+    // a 32 bit value takes at most 5 bytes, a longer varint is rejected rather than shifted out of range
+    template<typename Stream>
+    inline bool try_unpack( Stream& s, signed_int& vi, unpack_status& st )
+    {
+       const size_t start = s.tellp();
+       uint32_t v = 0; char b = 0; int by = 0;
+       do {
+          if( by >= 35 )
+             return st.fail( unpack_status::invalid_value, start, &get_typename<signed_int>::name );
+          if( !s.remaining() )
+             return st.fail( unpack_status::out_of_range, s.tellp(), &get_typename<signed_int>::name );
+          s.get( b );
+          v |= uint32_t(uint8_t(b) & 0x7f) << by;
+          by += 7;
+       } while( uint8_t(b) & 0x80 );
+       vi.value = (v>>1) ^ (~(v&1)+1ull);
+       return true;
+    }
+
+    template<typename Stream>
+    inline bool try_unpack( Stream& s, std::string& v, unpack_status& st )
+    {
+       uint32_t size;
+       if( !detail::try_unpack_size( s, MAX_SIZE_OF_BYTE_ARRAYS, size, st ) )
+          return false;
+       if( s.remaining() < size )
+          return st.fail( unpack_status::out_of_range, s.tellp(), &get_typename<std::string>::name );
+       v.resize( size );
+       if( size )
+          s.read( &v[0], size );
+       return true;
+    }
+
+    template<typename Stream>
+    inline bool try_unpack( Stream& s, std::vector<char>& v, unpack_status& st )
+    {
+       uint32_t size;
+       if( !detail::try_unpack_size( s, MAX_SIZE_OF_BYTE_ARRAYS, size, st ) )
+          return false;
+       if( s.remaining() < size )
+          return st.fail( unpack_status::out_of_range, s.tellp(), &get_typename<std::vector<char>>::name );
+       v.resize( size );
+       if( size )
+          s.read( v.data(), size );
+       return true;
+    }
+
+    template<typename Stream>
+    inline bool try_unpack( Stream& s, fc::time_point& v, unpack_status& st )
+    {
+       uint64_t usec;
+       if( !detail::try_read( s, (char*)&usec, sizeof(usec), st, +[]{ return "fc::time_point"; } ) )
+          return false;
+       v = fc::time_point() + fc::microseconds(usec);
+       return true;
+    }
+
+    template<typename Stream>
+    inline bool try_unpack( Stream& s, fc::time_point_sec& v, unpack_status& st )
+    {
+       uint32_t sec;
+       if( !detail::try_read( s, (char*)&sec, sizeof(sec), st, +[]{ return "fc::time_point_sec"; } ) )
+          return false;
+       v = fc::time_point() + fc::seconds(sec);
+       return true;
+    }
+
+    template<typename Stream>
+    inline bool try_unpack( Stream& s, fc::microseconds& v, unpack_status& st )
+    {
+       uint64_t usec;
+       if( !detail::try_read( s, (char*)&usec, sizeof(usec), st, +[]{ return "fc::microseconds"; } ) )
+          return false;
+       v = fc::microseconds(usec);
+       return true;
+    }
+
+    template<typename Stream, typename T>
+    inline bool try_unpack( Stream& s, std::vector<T>& v, unpack_status& st )
+    {
+       uint32_t size;
+       if( !detail::try_unpack_size( s, MAX_NUM_ARRAY_ELEMENTS, size, st ) )
+          return false;
+       if constexpr( std::is_arithmetic<T>::value && !std::is_same<T, bool>::value ) {
+          // the elements are read as they are, all at once
+          if( s.remaining() / sizeof(T) < size )
+             return st.fail( unpack_status::out_of_range, s.tellp(), &get_typename<std::vector<T>>::name );
+          v.resize( size );
+          if( size )
+             s.read( (char*)v.data(), size * sizeof(T) );
+          return true;
+       } else {
+          v.resize( size );
+          return detail::try_unpack_elements( s, v, st );
+       }
+    }
+
+    template<typename Stream, typename T>
+    inline bool try_unpack( Stream& s, std::deque<T>& v, unpack_status& st )
+    {
+       uint32_t size;
+       if( !detail::try_unpack_size( s, MAX_NUM_ARRAY_ELEMENTS, size, st ) )
+          return false;
+       v.resize( size );
+       return detail::try_unpack_elements( s, v, st );
+    }
+
+    template<typename Stream, typename T>
+    inline bool try_unpack( Stream& s, std::set<T>& v, unpack_status& st )
+    {
+       return detail::try_unpack_inserted<Stream, T>( s, v, st );
+    }
+
+    template<typename Stream, typename T>
+    inline bool try_unpack( Stream& s, std::unordered_set<T>& v, unpack_status& st )
+    {
+       return detail::try_unpack_inserted<Stream, T>( s, v, st );
+    }
+
+    template<typename Stream, typename K, typename V>
+    inline bool try_unpack( Stream& s, std::map<K,V>& v, unpack_status& st )
+    {
+       return detail::try_unpack_inserted<Stream, std::pair<K,V>>( s, v, st );
+    }
+
+    template<typename Stream, typename K, typename V>
+    inline bool try_unpack( Stream& s, std::unordered_map<K,V>& v, unpack_status& st )
+    {
+       return detail::try_unpack_inserted<Stream, std::pair<K,V>>( s, v, st );
+    }
+
+    template<typename Stream, typename K, typename V>
+    inline bool try_unpack( Stream& s, std::pair<K,V>& v, unpack_status& st )
+    {
+       return try_unpack( s, v.first, st ) && try_unpack( s, v.second, st );
+    }
+
+    template<typename Stream, typename T>
+    inline bool try_unpack( Stream& s, fc::optional<T>& v, unpack_status& st )
+    {
+       bool b;
+       if( !try_unpack( s, b, st ) )
+          return false;
+       if( b ) {
+          v = T();
+          return try_unpack( s, *v, st );
+       }
+       return true;
+    }
+
+    template<typename Stream, typename T>
+    inline bool try_unpack( Stream& s, std::shared_ptr<T>& v, unpack_status& st )
+    {
+       bool b;
+       if( !try_unpack( s, b, st ) )
+          return false;
+       if( b ) {
+          v = std::make_shared<T>();
+          return try_unpack( s, *v, st );
+       }
+       return true;
+    }
+
+    template<typename Stream, typename T, std::size_t N>
+    inline bool try_unpack( Stream& s, std::array<T,N>& v, unpack_status& st )
+    {
+       if constexpr( is_trivial_array<T> )
+          return detail::try_read( s, (char*)v.data(), N * sizeof(T), st, +[]{ return "std::array"; } );
+       else
+          return detail::try_unpack_elements( s, v, st );
+    }
+
+    template<typename Stream, typename T, std::size_t N>
+    inline bool try_unpack( Stream& s, fc::array<T,N>& v, unpack_status& st )
+    {
+       if constexpr( is_trivial_array<T> )
+          return detail::try_read( s, (char*)&v.data[0], N * sizeof(T), st, &get_typename<fc::array<T,N>>::name );
+       else
+          return detail::try_unpack_elements( s, v.data, st );
+    }
+
+    template<typename Stream, typename... T>
+    inline bool try_unpack( Stream& s, static_variant<T...>& sv, unpack_status& st )
+    {
+       const size_t start = s.tellp();
+       unsigned_int w;
+       if( !try_unpack( s, w, st ) )
+          return false;
+       if( w.value >= sv.count() )
+          return st.fail( unpack_status::invalid_value, start, &get_typename<static_variant<T...>>::name );
+       sv.set_which( w.value );
+       return sv.visit( [&]( auto& v ) { return try_unpack( s, v, st ); } );
+    }
+
+    template<typename Stream, typename T>
+    inline bool try_unpack( Stream& s, T& v, unpack_status& st )
+    {
+       return detail::try_unpack_dispatch( s, v, st, typename fc::reflector<T>::is_defined() );
+    }
+
+    /**
+     *  Decodes @p v like unpack(), but reports malformed input in the returned status instead
+     *  of throwing.  Types without a try_unpack overload that are not reflected, or that have an
+     *  unpack() overload of their own, fall back to their unpack(), and exceptions it throws are
+     *  reported as unpack_status::exception.
+     *
+     *  @note @p v may be partially decoded when the status is not ok
+     */
+    template<typename T>
+    inline unpack_status try_unpack( const char* d, size_t size, T& v )
+    {
+       unpack_status st;
+       datastream<const char*> ds( d, size );
+       if( !try_unpack( ds, v, st ) )
+          st.set_root( &get_typename<T>::name );
+       return st;
+    }
+
+    template<typename T>
+    inline unpack_status try_unpack( const std::vector<char>& s, T& v )
+    {
+       return try_unpack( s.data(), s.size(), v );
+    }
+
+} } // namespace fc::raw
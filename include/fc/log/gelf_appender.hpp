@@ -4,17 +4,31 @@
 #include <fc/log/logger.hpp>
 #include <fc/time.hpp>
 
-namespace fc 
+namespace fc
 {
-  // Log appender that sends log messages in JSON format over UDP
+  // Log appender that sends log messages in JSON format over UDP or TCP
   // https://www.graylog2.org/resources/gelf/specification
-  class gelf_appender final : public appender 
+  //
+  // Messages are rendered on the logging thread into a pooled buffer and handed
+  // over to a background thread, which compresses, chunks and sends them in batches.
+  class gelf_appender final : public appender
   {
   public:
-    struct config 
+    struct transport { enum type { udp, tcp }; };
+
+    struct config
     {
       string endpoint = "127.0.0.1:12201";
       string host = "fc"; // the name of the host, source or application that sent this message (just passed through to GELF server)
+      gelf_appender::transport::type transport = gelf_appender::transport::udp;
+      // largest UDP datagram to send, chunk header included; messages that don't fit are chunked
+      uint32_t max_payload_size = 512;
+      // zlib-compress UDP messages; GELF over TCP is always sent uncompressed and null-delimited
+      bool compress = true;
+      // messages waiting for the sender thread beyond this limit are dropped
+      uint32_t max_queue_size = 8192;
+      // a TCP connect or write taking longer than this is abandoned, and its messages dropped
+      uint32_t tcp_timeout_ms = 3000;
     };
 
     gelf_appender(const variant& args);
@@ -36,5 +50,6 @@ namespace fc
 } // namespace fc
 
 #include <fc/reflect/reflect.hpp>
+FC_REFLECT_ENUM(fc::gelf_appender::transport::type, (udp)(tcp))
 FC_REFLECT(fc::gelf_appender::config,
-           (endpoint)(host))
+           (endpoint)(host)(transport)(max_payload_size)(compress)(max_queue_size)(tcp_timeout_ms))
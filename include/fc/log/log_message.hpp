@@ -6,6 +6,8 @@
 #include <fc/time.hpp>
 #include <fc/variant_object.hpp>
 #include <memory>
+#include <string_view>
+#include <type_traits>
 
 namespace fc
 {
@@ -55,11 +57,24 @@ namespace fc
    class log_context 
    {
       public:
+        /** Tags the constructor taking strings that live as long as the program, as FC_LOG_CONTEXT does */
+        struct static_strings_t {};
+        static constexpr static_strings_t static_strings{};
+
         log_context();
         log_context( log_level ll,
                     const char* file, 
                     uint64_t line, 
                     const char* method );
+        /**
+         *  Keeps @p file and @p method without copying them, so they must be static, e.g. __func__ and
+         *  a file name from FC_LOG_FILE, which is used as it is
+         */
+        log_context( static_strings_t,
+                    log_level ll,
+                    const char* file,
+                    uint64_t line,
+                    const char* method );
         ~log_context();
         explicit log_context( const variant& v );
         variant to_variant()const;
@@ -67,12 +82,16 @@ namespace fc
         string        get_file()const;
         uint64_t      get_line_number()const;
         string        get_method()const;
-        string        get_thread_name()const;
-        string        get_task_name()const;
-        string        get_host_name()const;
+        const string& get_thread_name()const;
+        const string& get_task_name()const;
+        const string& get_host_name()const;
         time_point    get_timestamp()const;
         log_level     get_log_level()const;
-        string        get_context()const;
+        const string& get_context()const;
+
+        /** same as get_file()/get_method() without copying, valid as long as the context */
+        std::string_view get_file_view()const;
+        std::string_view get_method_view()const;
 
         void          append_context( const fc::string& c );
 
@@ -110,6 +129,14 @@ namespace fc
           *  @param ctx - generally provided using the FC_LOG_CONTEXT(LEVEL) macro 
           */
          log_message( log_context ctx, std::string format, variant_object args = variant_object() );
+         /**
+          *  A format given as a string literal is copied like any other, and its address kept as
+          *  the key the parsed form is cached under, see append_format_string(); any char array
+          *  may be passed, the address is never read through
+          */
+         template<size_t N>
+         log_message( log_context ctx, const char (&format)[N], variant_object args = variant_object() )
+         :log_message( std::move(ctx), format, std::char_traits<char>::length(format), std::move(args) ){}
          ~log_message();
 
          log_message( const variant& v );
@@ -121,12 +148,16 @@ namespace fc
           * @return formatted message according to format and variant args
           */
          string         get_limited_message()const;
+         /** appends get_message() to @p out */
+         void           append_message( std::string& out )const;
                               
-         log_context    get_context()const;
-         string         get_format()const;
-         variant_object get_data()const;
+         log_context           get_context()const;
+         const string&         get_format()const;
+         const variant_object& get_data()const;
 
       private:
+         log_message( log_context ctx, const char* static_format, size_t size, variant_object args );
+
          std::shared_ptr<detail::log_message_impl> my;
    };
 
@@ -140,10 +171,31 @@ namespace fc
 
 FC_REFLECT_TYPENAME( fc::log_message );
 
+namespace fc { namespace detail {
+   /**
+    *  @return the offset of the file name in @p path, i.e. past the last directory separator
+    */
+   constexpr size_t file_basename_offset( const char* path )
+   {
+      size_t offset = 0;
+      for( size_t i = 0; path[i]; ++i )
+         if( path[i] == '/' || path[i] == '\\' )
+            offset = i + 1;
+      return offset;
+   }
+} } // fc::detail
+
 #ifndef __func__
 #define __func__ __FUNCTION__
 #endif
 
+/**
+ * @def FC_LOG_FILE
+ * @brief The file name part of __FILE__, stripped of its directories at compile time
+ */
+#define FC_LOG_FILE \
+   (__FILE__ + std::integral_constant<size_t, fc::detail::file_basename_offset(__FILE__)>::value)
+
 /**
  * @def FC_LOG_CONTEXT(LOG_LEVEL)
  * @brief Automatically captures the File, Line, and Method names and passes them to
@@ -151,7 +203,7 @@ FC_REFLECT_TYPENAME( fc::log_message );
  * @param LOG_LEVEL - a valid log_level::Enum name.
  */
 #define FC_LOG_CONTEXT(LOG_LEVEL) \
-   fc::log_context( fc::log_level::LOG_LEVEL, __FILE__, __LINE__, __func__ )
+   fc::log_context( fc::log_context::static_strings, fc::log_level::LOG_LEVEL, FC_LOG_FILE, __LINE__, __func__ )
    
 /**
  * @def FC_LOG_MESSAGE(LOG_LEVEL,FORMAT,...)
@@ -161,7 +213,10 @@ FC_REFLECT_TYPENAME( fc::log_message );
  * @param LOG_LEVEL a valid log_level::Enum name to be passed to the log_context
  * @param FORMAT A const char* string containing zero or more references to keys as "${key}"
  * @param ...  A set of key/value pairs denoted as ("key",val)("key2",val2)...
+ *
+ * Messages are built on every throw, so the arguments get room for a few keys rather than
+ * the 100 entries mutable_variant_object() reserves.
  */
 #define FC_LOG_MESSAGE( LOG_LEVEL, FORMAT, ... ) \
-   fc::log_message( FC_LOG_CONTEXT(LOG_LEVEL), FORMAT, fc::mutable_variant_object()__VA_ARGS__ )
+   fc::log_message( FC_LOG_CONTEXT(LOG_LEVEL), FORMAT, fc::mutable_variant_object::with_capacity( 4 )__VA_ARGS__ )
 
@@ -2,6 +2,7 @@
 #include <fc/string.hpp>
 #include <fc/time.hpp>
 #include <fc/log/log_message.hpp>
+#include <atomic>
 
 namespace fc  
 {
@@ -54,6 +55,76 @@ namespace fc
          std::shared_ptr<impl> my;
    };
 
+   namespace detail {
+      /** seconds of a coarse monotonic clock, cheap enough to read for every throttled message */
+      int64_t coarse_seconds();
+   }
+
+   /**
+    *  Call site state of the fc_*log_rate macros, lets through at most max_per_second
+    *  messages every second.  Counts are approximate when threads race at the turn of a second.
+    */
+   class log_rate_limit
+   {
+      public:
+         explicit constexpr log_rate_limit( uint32_t max_per_second ):_max(max_per_second){}
+
+         /**
+          *  @param suppressed the number of messages suppressed during the last busy second,
+          *         reported by the first message let through after it, 0 otherwise
+          *  @return whether to log this message
+          */
+         bool allow( uint64_t& suppressed )
+         {
+            suppressed = 0;
+            // a suppressed message costs a clock read and an atomic increment
+            if( detail::coarse_seconds() == _second.load( std::memory_order_relaxed ) )
+               return _count.fetch_add( 1, std::memory_order_relaxed ) < _max;
+            return next_second( suppressed );
+         }
+
+      private:
+         bool next_second( uint64_t& suppressed );
+
+         const uint32_t         _max;
+         std::atomic<int64_t>   _second{-1};
+         std::atomic<uint64_t>  _count{0};
+   };
+
+   /**
+    *  Call site state of the fc_*log_every macros, lets through one in every N messages.
+    */
+   class log_sample
+   {
+      public:
+         explicit constexpr log_sample( uint32_t every ):_every(every ? every : 1){}
+
+         /**
+          *  @param suppressed the number of messages skipped since the last report, reported
+          *         at most once a second, 0 otherwise
+          *  @return whether to log this message
+          */
+         bool allow( uint64_t& suppressed )
+         {
+            suppressed = 0;
+            // a suppressed message costs an atomic increment
+            const uint64_t n = _count.fetch_add( 1, std::memory_order_relaxed );
+            if( n % _every )
+               return false;
+            if( detail::coarse_seconds() != _last_report.load( std::memory_order_relaxed ) )
+               report( n, suppressed );
+            return true;
+         }
+
+      private:
+         void report( uint64_t n, uint64_t& suppressed );
+
+         const uint32_t         _every;
+         std::atomic<uint64_t>  _count{0};
+         std::atomic<int64_t>   _last_report{-1};
+         std::atomic<uint64_t>  _reported{0}; ///< the message that made the last report
+   };
+
 } // namespace fc
 
 #ifndef DEFAULT_LOGGER
@@ -132,6 +203,55 @@ namespace fc
       (fc::logger::get(DEFAULT_LOGGER)).log( FC_LOG_MESSAGE( error, FORMAT, __VA_ARGS__ ) ); \
   FC_MULTILINE_MACRO_END
 
+/**
+ * @def FC_LOG_THROTTLED(LOGGER,LEVEL,THROTTLE,FORMAT,...)
+ * @brief Logs like fc_*log, but only when the call site's THROTTLE (a log_rate_limit or
+ *        log_sample named fc_throttle) lets the message through.  A "suppressed N messages"
+ *        line precedes the next message let through after some were suppressed.
+ */
+#define FC_LOG_THROTTLED( LOGGER, LEVEL, THROTTLE, FORMAT, ... ) \
+  FC_MULTILINE_MACRO_BEGIN \
+   if( (LOGGER).is_enabled( fc::log_level::LEVEL ) ) { \
+      static THROTTLE; \
+      uint64_t fc_suppressed; \
+      if( fc_throttle.allow( fc_suppressed ) ) { \
+         if( fc_suppressed ) \
+            (LOGGER).log( FC_LOG_MESSAGE( LEVEL, "suppressed ${count} messages", ("count", fc_suppressed) ) ); \
+         (LOGGER).log( FC_LOG_MESSAGE( LEVEL, FORMAT, __VA_ARGS__ ) ); \
+      } \
+   } \
+  FC_MULTILINE_MACRO_END
+
+/// at most MAX_PER_SECOND messages a second from this call site
+#define fc_dlog_rate( LOGGER, MAX_PER_SECOND, FORMAT, ... ) \
+   FC_LOG_THROTTLED( LOGGER, debug, fc::log_rate_limit fc_throttle( MAX_PER_SECOND ), FORMAT, __VA_ARGS__ )
+#define fc_ilog_rate( LOGGER, MAX_PER_SECOND, FORMAT, ... ) \
+   FC_LOG_THROTTLED( LOGGER, info, fc::log_rate_limit fc_throttle( MAX_PER_SECOND ), FORMAT, __VA_ARGS__ )
+#define fc_wlog_rate( LOGGER, MAX_PER_SECOND, FORMAT, ... ) \
+   FC_LOG_THROTTLED( LOGGER, warn, fc::log_rate_limit fc_throttle( MAX_PER_SECOND ), FORMAT, __VA_ARGS__ )
+#define fc_elog_rate( LOGGER, MAX_PER_SECOND, FORMAT, ... ) \
+   FC_LOG_THROTTLED( LOGGER, error, fc::log_rate_limit fc_throttle( MAX_PER_SECOND ), FORMAT, __VA_ARGS__ )
+
+/// one in every N messages from this call site
+#define fc_dlog_every( LOGGER, N, FORMAT, ... ) \
+   FC_LOG_THROTTLED( LOGGER, debug, fc::log_sample fc_throttle( N ), FORMAT, __VA_ARGS__ )
+#define fc_ilog_every( LOGGER, N, FORMAT, ... ) \
+   FC_LOG_THROTTLED( LOGGER, info, fc::log_sample fc_throttle( N ), FORMAT, __VA_ARGS__ )
+#define fc_wlog_every( LOGGER, N, FORMAT, ... ) \
+   FC_LOG_THROTTLED( LOGGER, warn, fc::log_sample fc_throttle( N ), FORMAT, __VA_ARGS__ )
+#define fc_elog_every( LOGGER, N, FORMAT, ... ) \
+   FC_LOG_THROTTLED( LOGGER, error, fc::log_sample fc_throttle( N ), FORMAT, __VA_ARGS__ )
+
+#define dlog_rate( MAX_PER_SECOND, FORMAT, ... ) fc_dlog_rate( fc::logger::get(DEFAULT_LOGGER), MAX_PER_SECOND, FORMAT, __VA_ARGS__ )
+#define ilog_rate( MAX_PER_SECOND, FORMAT, ... ) fc_ilog_rate( fc::logger::get(DEFAULT_LOGGER), MAX_PER_SECOND, FORMAT, __VA_ARGS__ )
+#define wlog_rate( MAX_PER_SECOND, FORMAT, ... ) fc_wlog_rate( fc::logger::get(DEFAULT_LOGGER), MAX_PER_SECOND, FORMAT, __VA_ARGS__ )
+#define elog_rate( MAX_PER_SECOND, FORMAT, ... ) fc_elog_rate( fc::logger::get(DEFAULT_LOGGER), MAX_PER_SECOND, FORMAT, __VA_ARGS__ )
+
+#define dlog_every( N, FORMAT, ... ) fc_dlog_every( fc::logger::get(DEFAULT_LOGGER), N, FORMAT, __VA_ARGS__ )
+#define ilog_every( N, FORMAT, ... ) fc_ilog_every( fc::logger::get(DEFAULT_LOGGER), N, FORMAT, __VA_ARGS__ )
+#define wlog_every( N, FORMAT, ... ) fc_wlog_every( fc::logger::get(DEFAULT_LOGGER), N, FORMAT, __VA_ARGS__ )
+#define elog_every( N, FORMAT, ... ) fc_elog_every( fc::logger::get(DEFAULT_LOGGER), N, FORMAT, __VA_ARGS__ )
+
 #include <boost/preprocessor/seq/for_each.hpp>
 #include <boost/preprocessor/seq/enum.hpp>
 #include <boost/preprocessor/seq/size.hpp>
@@ -175,4 +295,20 @@ namespace fc
 # define ilog(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
 # undef dlog
 # define dlog(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef elog_rate
+# define elog_rate(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef wlog_rate
+# define wlog_rate(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef ilog_rate
+# define ilog_rate(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef dlog_rate
+# define dlog_rate(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef elog_every
+# define elog_every(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef wlog_every
+# define wlog_every(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef ilog_every
+# define ilog_every(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
+# undef dlog_every
+# define dlog_every(...) FC_MULTILINE_MACRO_BEGIN FC_MULTILINE_MACRO_END
 #endif
\ No newline at end of file
@@ -9,8 +9,30 @@ namespace fc {
     using boost::stacktrace::stacktrace;
 
     string to_string(const stacktrace&);
+
+    /**
+     * Renders function names and source lines for every frame. Symbols are resolved in-process
+     * (libbacktrace when fc is built with it, addr2line otherwise) and cached per address, so
+     * only the first trace through a call site pays for the lookup.
+     */
     string to_detail_string(const stacktrace&);
 
+    /**
+     * Installs handlers for SIGSEGV, SIGBUS, SIGFPE, SIGILL and SIGABRT which write the stacks of
+     * all threads to @p filename before letting the signal kill the process. If a dump from a
+     * previous run is present it is printed to stderr and removed.
+     *
+     * The handlers are async-signal-safe: the faulting thread records its own frames, interrupts
+     * every other thread with SIGRTMIN+5 to have them record theirs into preallocated slots, and
+     * writes the raw addresses together with /proc/self/maps. Symbolization is deferred to
+     * get_btrace(), which relocates the addresses into the reading process by module and offset,
+     * so a restarted instance of the same binary can explain the crash of the previous one.
+     *
+     * Dump layout (native byte order):
+     *    "FCBT", uint16 version, uint16 signal, uint32 pid, uint32 thread count,
+     *    per thread: uint32 tid, uint32 frame count, uint64 frames[frame count] (crashed thread first),
+     *    then the text of /proc/self/maps up to the end of the file.
+     */
     void install_btrace_signal_handler(const path&);
 
     string get_btrace(const path&);
@@ -23,6 +45,9 @@ namespace fc {
     void remove_btrace();
 
     namespace detail {
+        /** Symbolizes a single return address the way to_detail_string() does */
+        string symbolize(const void* address);
+
         template <typename ToStringImpl>
         string to_string_impl(const stacktrace& strace) {
             if (!strace) return {};
@@ -49,4 +74,4 @@ namespace fc {
             return res;
         }
     } // namespace detail
-} // namespace fc
\ No newline at end of file
+} // namespace fc
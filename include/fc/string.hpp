@@ -26,6 +26,19 @@ namespace fc
   typedef fc::optional<fc::string> ostring;
   class variant_object;
   fc::string format_string( const fc::string&, const variant_object&, bool minimize = false );
+  /** appends format_string( format, args, minimize ) to @p out */
+  void append_format_string( std::string& out, const fc::string& format, const variant_object& args, bool minimize = false );
+  /**
+   *  Appends format_string( format, args, minimize ) to @p out, @p format being parsed only
+   *  once per thread and cached by its address.  Meant for string literals which are
+   *  formatted over and over, as the log and exception messages are.
+   */
+  void append_format_string( std::string& out, const char* format, size_t size, const variant_object& args, bool minimize = false );
+  /**
+   *  As above, for a copy of such a literal: the parsed form is cached under @p key, which is
+   *  only compared and never read, so it may be the address of a buffer gone since.
+   */
+  void append_format_string( std::string& out, const void* key, const fc::string& format, const variant_object& args, bool minimize = false );
   fc::string trim( const fc::string& );
   fc::string to_lower( const fc::string& );
   string trim_and_normalize_spaces( const string& s );
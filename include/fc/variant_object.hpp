@@ -220,6 +220,9 @@ namespace fc
 
       mutable_variant_object();
 
+      /** an empty object with room for @p capacity entries, where mutable_variant_object() reserves 100 */
+      static mutable_variant_object with_capacity( size_t capacity );
+
       /** initializes the first key/value pair in the object */
       mutable_variant_object( string key, variant val );
       template<typename T>
@@ -242,6 +245,9 @@ namespace fc
 
       bool operator==(const variant_object&) const;
    private:
+      explicit mutable_variant_object( std::unique_ptr< std::vector< entry > > key_value )
+      :_key_value( std::move(key_value) ){}
+
       std::unique_ptr< std::vector< entry > > _key_value;
       friend class variant_object;
    };
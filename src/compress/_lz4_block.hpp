@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* The LZ4 block coder with a prefix the data may refer back into, for dictionaries
+ */
+namespace fc { namespace detail {
+
+   constexpr unsigned lz4_hash_log = 12;
+   constexpr size_t lz4_hash_size = size_t( 1 ) << lz4_hash_log;
+   constexpr size_t lz4_max_offset = 65535;
+
+   // records every position of [base, base + size) in @p table, later positions winning
+   void lz4_hash_prefix( const char* base, size_t size, uint32_t* table );
+
+   // compresses [base + prefix, base + prefix + size), matching back into [base, base + prefix) too;
+   // @p table is the hash table left by lz4_hash_prefix for the prefix, updated as it goes
+   size_t lz4_compress_prefixed( const char* base, size_t prefix, size_t size, char* out, uint32_t* table );
+
+   // decompresses a block whose matches may reach back past @p out into [dict, dict + dict_size)
+   size_t lz4_decompress_prefixed( const char* in, size_t size, char* out, size_t capacity,
+                                   const char* dict, size_t dict_size );
+
+} } // fc::detail
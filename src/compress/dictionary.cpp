@@ -0,0 +1,223 @@
+#include <fc/compress/dictionary.hpp>
+#include <fc/compress/lz4.hpp>
+#include <fc/crypto/crc32c.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "_lz4_block.hpp"
+
+namespace fc
+{
+  namespace
+  {
+    // training looks at substrings this long, counted in a table this many bits wide
+    constexpr size_t dmer_size = 8;
+    constexpr unsigned dmer_table_bits = 20;
+    constexpr uint32_t no_dmer = ~0u;
+    // and fills the dictionary with segments this long
+    constexpr size_t segment_size = 64;
+
+    // a block can't expand more than this, so a larger stated size means damage
+    constexpr uint64_t max_lz4_ratio = 255;
+    // large messages don't get to keep their copy in the per-thread buffer
+    constexpr size_t max_kept_scratch = 1024 * 1024;
+
+    std::atomic<uint64_t> next_serial{ 1 };
+
+    uint32_t dmer_hash(const char* p)
+    {
+      uint64_t v;
+      memcpy(&v, p, sizeof(v));
+      return uint32_t((v * 0x9e3779b97f4a7c15ull) >> (64 - dmer_table_bits));
+    }
+
+    template<typename Samples>
+    compression_dictionary train_from(const Samples& samples, size_t size)
+    {
+      size = std::min(size, compression_dictionary::max_size);
+      std::vector<char> corpus;
+      for (const auto& s : samples) corpus.insert(corpus.end(), s.begin(), s.end());
+      if (corpus.size() <= size || corpus.size() < segment_size) {
+        size = std::min(size, corpus.size());
+        return compression_dictionary(corpus.data() + corpus.size() - size, size);
+      }
+
+      // how often each substring occurs, and which one starts where (none across two samples)
+      std::vector<uint32_t> frequency(size_t(1) << dmer_table_bits);
+      std::vector<uint32_t> dmers(corpus.size(), no_dmer);
+      size_t pos = 0;
+      for (const auto& s : samples) {
+        for (size_t i = 0; i + dmer_size <= s.size(); ++i) {
+          const uint32_t h = dmer_hash(corpus.data() + pos + i);
+          dmers[pos + i] = h;
+          ++frequency[h];
+        }
+        pos += s.size();
+      }
+
+      // from each stretch of the corpus, the segment scoring highest: the frequencies of the distinct
+      // substrings in it, less those already taken
+      struct segment {
+        size_t    begin;
+        uint64_t  score;
+      };
+      std::vector<segment> chosen;
+      std::vector<uint16_t> in_window(frequency.size());
+      const size_t window = segment_size - dmer_size + 1;
+      const size_t epochs = std::max<size_t>(1, std::min(size / segment_size, corpus.size() / segment_size));
+      const size_t epoch_size = corpus.size() / epochs;
+      for (size_t e = 0; e < epochs; ++e) {
+        const size_t begin = e * epoch_size;
+        const size_t end = std::min(begin + epoch_size, corpus.size() - segment_size + 1);
+        const size_t last = end + window - 1;
+        uint64_t score = 0;
+        segment best{ begin, 0 };
+        for (size_t i = begin; i < last; ++i) {
+          const uint32_t added = dmers[i];
+          if (added != no_dmer && in_window[added]++ == 0) score += frequency[added];
+          if (i >= begin + window) {
+            const uint32_t removed = dmers[i - window];
+            if (removed != no_dmer && --in_window[removed] == 0) score -= frequency[removed];
+          }
+          const size_t start = i + 1 >= begin + window ? i + 1 - window : begin;
+          if (score > best.score && start < end) best = { start, score };
+        }
+        for (size_t i = begin; i < last; ++i)
+          if (dmers[i] != no_dmer) in_window[dmers[i]] = 0;
+        if (!best.score) continue;
+
+        chosen.push_back(best);
+        for (size_t i = best.begin; i < best.begin + window; ++i)
+          if (dmers[i] != no_dmer) frequency[dmers[i]] = 0;
+      }
+
+      // the best last, nearest to the messages
+      std::sort(chosen.begin(), chosen.end(), [](const segment& a, const segment& b) { return a.score < b.score; });
+      std::vector<char> content;
+      content.reserve(chosen.size() * segment_size);
+      for (const auto& s : chosen)
+        content.insert(content.end(), corpus.begin() + s.begin, corpus.begin() + s.begin + segment_size);
+      if (content.size() > size) content.erase(content.begin(), content.end() - size);
+      return compression_dictionary(content);
+    }
+  }
+
+  class compression_dictionary::impl
+  {
+    public:
+      impl(const char* data, size_t size)
+      :_serial(next_serial++)
+      ,_table(detail::lz4_hash_size)
+      {
+        if (size > max_size) {
+          data += size - max_size;
+          size = max_size;
+        }
+        _content.assign(data, data + size);
+        _id = crc32c(data, size);
+        detail::lz4_hash_prefix(data, size, _table.data());
+      }
+
+      // tells dictionaries apart in the per-thread buffer, where an address could be reused
+      uint64_t                 _serial;
+      std::vector<char>        _content;
+      uint32_t                 _id = 0;
+      // the hash table after the content has gone through the compressor
+      std::vector<uint32_t>    _table;
+  };
+
+  compression_dictionary::compression_dictionary()
+  {
+    static const std::shared_ptr<const impl> empty = std::make_shared<const impl>(nullptr, 0);
+    my = empty;
+  }
+
+  compression_dictionary::compression_dictionary(const char* data, size_t size)
+  :my(std::make_shared<const impl>(data, size))
+  {
+  }
+
+  compression_dictionary::compression_dictionary(const std::vector<char>& content)
+  :compression_dictionary(content.data(), content.size())
+  {
+  }
+
+  compression_dictionary compression_dictionary::train(const std::vector<std::string>& samples, size_t size)
+  {
+    return train_from(samples, size);
+  }
+
+  compression_dictionary compression_dictionary::train(const std::vector<std::vector<char>>& samples, size_t size)
+  {
+    return train_from(samples, size);
+  }
+
+  const std::vector<char>& compression_dictionary::content()const
+  {
+    return my->_content;
+  }
+
+  uint32_t compression_dictionary::id()const
+  {
+    return my->_id;
+  }
+
+  void dictionary_compress(const compression_dictionary& dict, const char* in, size_t size, std::vector<char>& out)
+  {
+    // the message goes right after a copy of the dictionary, which stays for the next message
+    struct scratch_buffer {
+      uint64_t            serial = 0;
+      std::vector<char>   data;
+    };
+    static thread_local scratch_buffer scratch;
+
+    const auto& d = *dict.my;
+    const size_t prefix = d._content.size();
+    if (scratch.serial != d._serial) {
+      scratch.data.assign(d._content.begin(), d._content.end());
+      scratch.serial = d._serial;
+    }
+    scratch.data.resize(prefix + size);
+    memcpy(scratch.data.data() + prefix, in, size);
+
+    out.resize(10 + lz4_block_bound(size));
+    size_t pos = 0;
+    for (uint64_t v = size; ; v >>= 7) {
+      out[pos++] = char((v & 0x7f) | (v > 0x7f ? 0x80 : 0));
+      if (v <= 0x7f) break;
+    }
+    uint32_t table[detail::lz4_hash_size];
+    memcpy(table, d._table.data(), sizeof(table));
+    out.resize(pos + detail::lz4_compress_prefixed(scratch.data.data(), prefix, size, out.data() + pos, table));
+
+    if (scratch.data.capacity() > prefix + max_kept_scratch) {
+      scratch.data.resize(prefix);
+      scratch.data.shrink_to_fit();
+    }
+  }
+
+  void dictionary_decompress(const compression_dictionary& dict, const char* in, size_t size, std::vector<char>& out)
+  {
+    uint64_t raw_size = 0;
+    size_t pos = 0;
+    for (unsigned shift = 0; ; shift += 7) {
+      if (pos == size || shift > 56)
+        FC_THROW_EXCEPTION(parse_error_exception, "Malformed message size");
+      const uint8_t b = uint8_t(in[pos++]);
+      raw_size |= uint64_t(b & 0x7f) << shift;
+      if (!(b & 0x80)) break;
+    }
+    if (raw_size > (size - pos) * max_lz4_ratio + 32)
+      FC_THROW_EXCEPTION(parse_error_exception, "Message of ${n} bytes from ${c} compressed", ("n", raw_size)("c", size - pos));
+
+    const auto& content = dict.my->_content;
+    out.resize(raw_size);
+    if (detail::lz4_decompress_prefixed(in + pos, size - pos, out.data(), out.size(), content.data(), content.size()) != raw_size) {
+      out.clear();
+      FC_THROW_EXCEPTION(parse_error_exception, "Message is shorter than its stated size");
+    }
+  }
+}
@@ -0,0 +1,550 @@
+#include <fc/compress/lz4.hpp>
+#include <fc/crypto/crc32c.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <cstring>
+#include <limits>
+
+#include "_lz4_block.hpp"
+
+namespace fc
+{
+  namespace
+  {
+    // the format: the last 5 bytes are always literals and no match starts in the last 12
+    constexpr size_t min_match = 4;
+    constexpr size_t last_literals = 5;
+    constexpr size_t match_limit = 12;
+    using detail::lz4_hash_log;
+    using detail::lz4_max_offset;
+    // after this many misses in a row the search starts skipping ahead, faster and faster
+    constexpr unsigned skip_trigger = 6;
+
+    constexpr char frame_magic[4] = { 'f', 'c', 'L', '4' };
+    constexpr uint8_t frame_version = 1;
+    constexpr size_t frame_header_size = 6;
+    constexpr uint32_t stored_block = 0x80000000u;
+
+    uint32_t read32(const uint8_t* p)
+    {
+      uint32_t v;
+      memcpy(&v, p, sizeof(v));
+      return v;
+    }
+
+    uint64_t read64(const uint8_t* p)
+    {
+      uint64_t v;
+      memcpy(&v, p, sizeof(v));
+      return v;
+    }
+
+    uint32_t read32_le(const char* p)
+    {
+      auto b = (const uint8_t*)p;
+      return uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 | uint32_t(b[3]) << 24;
+    }
+
+    void write32_le(char* p, uint32_t v)
+    {
+      p[0] = char(v);
+      p[1] = char(v >> 8);
+      p[2] = char(v >> 16);
+      p[3] = char(v >> 24);
+    }
+
+    // five bytes hash better than four; every position hashed has at least 12 bytes after it
+    uint32_t hash(const uint8_t* p)
+    {
+      return uint32_t(((read64(p) << 24) * 889523592379ull) >> (64 - lz4_hash_log));
+    }
+
+    /** How many bytes from @p a on match those from @p b on, without reading past @p end */
+    size_t common_length(const uint8_t* a, const uint8_t* b, const uint8_t* end)
+    {
+      const uint8_t* const start = a;
+#if ( defined(__GNUC__) || defined(__clang__) ) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      while (a + 8 <= end) {
+        const uint64_t diff = read64(a) ^ read64(b);
+        if (diff) return a - start + (__builtin_ctzll(diff) >> 3);
+        a += 8;
+        b += 8;
+      }
+#endif
+      while (a < end && *a == *b) {
+        ++a;
+        ++b;
+      }
+      return a - start;
+    }
+
+    uint8_t* write_length(uint8_t* op, size_t length)
+    {
+      for (; length >= 255; length -= 255) *op++ = 255;
+      *op++ = uint8_t(length);
+      return op;
+    }
+
+    [[noreturn]] void malformed_block()
+    {
+      FC_THROW_EXCEPTION(parse_error_exception, "Malformed lz4 block");
+    }
+
+    /**
+     *  Copies an overlapping match less than 8 back, up to 8 bytes past @p end: the first bytes are
+     *  spread out until the copy is at least 8 behind, a whole number of periods, then 8 at a time.
+     */
+    void copy_short_offset(uint8_t* op, const uint8_t* match, size_t offset, uint8_t* end)
+    {
+      static const uint8_t advance[8] = { 0, 1, 2, 1, 0, 4, 4, 4 };
+      static const int8_t back[8] = { 0, 0, 0, -1, -4, 1, 2, 3 };
+      op[0] = match[0];
+      op[1] = match[1];
+      op[2] = match[2];
+      op[3] = match[3];
+      match += advance[offset];
+      memcpy(op + 4, match, 4);
+      match -= back[offset];
+      for (op += 8; op < end; op += 8, match += 8) memcpy(op, match, 8);
+    }
+
+    size_t read_length(const uint8_t*& ip, const uint8_t* iend)
+    {
+      size_t length = 0;
+      uint8_t b;
+      do {
+        if (ip == iend) malformed_block();
+        b = *ip++;
+        length += b;
+      } while (b == 255);
+      return length;
+    }
+  }
+
+  void detail::lz4_hash_prefix(const char* base, size_t size, uint32_t* table)
+  {
+    // hash() reads 8 bytes
+    for (size_t pos = 0; pos + 8 <= size; ++pos)
+      table[hash((const uint8_t*)base + pos)] = uint32_t(pos);
+  }
+
+  size_t detail::lz4_compress_prefixed(const char* in, size_t prefix, size_t size, char* out, uint32_t* table)
+  {
+    FC_ASSERT(prefix + size <= std::numeric_limits<uint32_t>::max(), "lz4 blocks are limited to 4 GB");
+    const uint8_t* const base = (const uint8_t*)in;
+    const uint8_t* const iend = base + prefix + size;
+    const uint8_t* ip = base + prefix;
+    const uint8_t* anchor = ip;
+    uint8_t* op = (uint8_t*)out;
+
+    if (size > match_limit) {
+      const uint8_t* const mflimit = iend - match_limit;
+      const uint8_t* const matchlimit = iend - last_literals;
+
+      for (;;) {
+        // the next position whose first four bytes were seen at the position last hashed alike
+        const uint8_t* match;
+        unsigned searches = 1u << skip_trigger;
+        for (;;) {
+          if (ip > mflimit) goto done;
+          const uint32_t sequence = read32(ip);
+          uint32_t& slot = table[hash(ip)];
+          match = base + slot;
+          slot = uint32_t(ip - base);
+          if (match < ip && size_t(ip - match) <= lz4_max_offset && read32(match) == sequence) break;
+          ip += searches++ >> skip_trigger;
+        }
+        while (ip > anchor && match > base && ip[-1] == match[-1]) {
+          --ip;
+          --match;
+        }
+
+        uint8_t* const token = op++;
+        const size_t literals = ip - anchor;
+        if (literals >= 15) {
+          *token = 15 << 4;
+          op = write_length(op, literals - 15);
+        } else {
+          *token = uint8_t(literals << 4);
+        }
+        memcpy(op, anchor, literals);
+        op += literals;
+
+        const size_t offset = ip - match;
+        *op++ = uint8_t(offset);
+        *op++ = uint8_t(offset >> 8);
+
+        const size_t length = common_length(ip + min_match, match + min_match, matchlimit);
+        ip += min_match + length;
+        if (length >= 15) {
+          *token |= 15;
+          op = write_length(op, length - 15);
+        } else {
+          *token |= uint8_t(length);
+        }
+        anchor = ip;
+        if (ip > mflimit) break;
+        table[hash(ip - 2)] = uint32_t(ip - 2 - base);
+      }
+    }
+
+  done:
+    const size_t literals = iend - anchor;
+    if (literals >= 15) {
+      *op++ = 15 << 4;
+      op = write_length(op, literals - 15);
+    } else {
+      *op++ = uint8_t(literals << 4);
+    }
+    memcpy(op, anchor, literals);
+    op += literals;
+    return op - (uint8_t*)out;
+  }
+
+  size_t lz4_compress_block(const char* in, size_t size, char* out)
+  {
+    uint32_t table[detail::lz4_hash_size] = {};
+    return detail::lz4_compress_prefixed(in, 0, size, out, table);
+  }
+
+  size_t detail::lz4_decompress_prefixed(const char* in, size_t size, char* out, size_t capacity,
+                                         const char* dict, size_t dict_size)
+  {
+    const uint8_t* const dict_end = (const uint8_t*)dict + dict_size;
+    const uint8_t* ip = (const uint8_t*)in;
+    const uint8_t* const iend = ip + size;
+    uint8_t* const ostart = (uint8_t*)out;
+    uint8_t* op = ostart;
+    uint8_t* const oend = ostart + capacity;
+
+    // copies run 8 or 16 bytes at a time, past the end of what they need, wherever there is room for it
+    for (;;) {
+      if (ip == iend) malformed_block();
+      const uint8_t token = *ip++;
+      size_t literals = token >> 4;
+
+      // the common short sequence, with room to spare on both sides: no length bytes, fixed-size copies
+      if (literals < 15 && iend - ip >= 16 + 2 && oend - op >= 16 + 32) {
+        memcpy(op, ip, 16);
+        op += literals;
+        ip += literals;
+        const size_t offset = size_t(ip[0]) | size_t(ip[1]) << 8;
+        const size_t length = token & 15;
+        if (length < 15 && offset - 1 < size_t(op - ostart)) {
+          ip += 2;
+          const uint8_t* match = op - offset;
+          if (offset >= 8) {
+            memcpy(op, match, 8);
+            memcpy(op + 8, match + 8, 8);
+            memcpy(op + 16, match + 16, 2);
+          } else {
+            copy_short_offset(op, match, offset, op + length + min_match);
+          }
+          op += length + min_match;
+          continue;
+        }
+      } else {
+        if (literals == 15) literals += read_length(ip, iend);
+        if (size_t(iend - ip) >= literals + 16 && size_t(oend - op) >= literals + 16) {
+          for (size_t i = 0; i < literals; i += 16) memcpy(op + i, ip + i, 16);
+        } else {
+          if (literals > size_t(iend - ip) || literals > size_t(oend - op)) malformed_block();
+          memcpy(op, ip, literals);
+        }
+        ip += literals;
+        op += literals;
+        // the last sequence is literals only
+        if (ip == iend) break;
+      }
+
+      if (iend - ip < 2) malformed_block();
+      const size_t offset = size_t(ip[0]) | size_t(ip[1]) << 8;
+      ip += 2;
+      size_t length = token & 15;
+      if (length == 15) length += read_length(ip, iend);
+      length += min_match;
+      if (offset == 0 || length > size_t(oend - op)) malformed_block();
+
+      if (offset > size_t(op - ostart)) {
+        // into the dictionary, and maybe on from there into the start of the output
+        const size_t back = offset - (op - ostart);
+        if (back > dict_size) malformed_block();
+        const size_t n = std::min(back, length);
+        memcpy(op, dict_end - back, n);
+        for (size_t i = n; i < length; ++i) op[i] = ostart[i - n];
+        op += length;
+        continue;
+      }
+
+      const uint8_t* match = op - offset;
+      uint8_t* const end = op + length;
+      if (size_t(oend - op) < length + 16) {
+        for (size_t i = 0; i < length; ++i) op[i] = match[i];
+      } else {
+        if (offset < 8) {
+          copy_short_offset(op, match, offset, end);
+        } else {
+          for (; op < end; op += 8, match += 8) memcpy(op, match, 8);
+        }
+      }
+      op = end;
+    }
+    return op - ostart;
+  }
+
+  size_t lz4_decompress_block(const char* in, size_t size, char* out, size_t capacity)
+  {
+    return detail::lz4_decompress_prefixed(in, size, out, capacity, nullptr, 0);
+  }
+
+  class lz4_compressor::impl
+  {
+    public:
+      explicit impl(size_t block_size)
+      :_block_size(block_size)
+      {
+        FC_ASSERT(block_size >= lz4_default_block_size && block_size <= lz4_max_block_size && !(block_size & (block_size - 1)),
+                  "lz4 block size ${s} is not a power of two from 64 KB to 4 MB", ("s", block_size));
+      }
+
+      void start(std::vector<char>& out)
+      {
+        FC_ASSERT(!_finished, "the lz4 frame has already been finished");
+        if (_started) return;
+        out.insert(out.end(), std::begin(frame_magic), std::end(frame_magic));
+        out.push_back(char(frame_version));
+        uint8_t block_log = 0;
+        while ((size_t(1) << block_log) < _block_size) ++block_log;
+        out.push_back(char(block_log));
+        _started = true;
+      }
+
+      void emit_block(const char* data, size_t size, std::vector<char>& out)
+      {
+        _crc = crc32c(data, size, _crc);
+        const size_t pos = out.size();
+        out.resize(pos + 4 + lz4_block_bound(size) + 4);
+        char* const payload = out.data() + pos + 4;
+        size_t n = lz4_compress_block(data, size, payload);
+        uint32_t header = uint32_t(n);
+        if (n >= size) {
+          memcpy(payload, data, size);
+          n = size;
+          header = uint32_t(size) | stored_block;
+        }
+        write32_le(payload - 4, header);
+        write32_le(payload + n, crc32c(payload, n));
+        out.resize(pos + 4 + n + 4);
+      }
+
+      size_t                    _block_size;
+      std::unique_ptr<char[]>   _block;
+      size_t                    _fill = 0;
+      uint32_t                  _crc = 0;
+      bool                      _started = false;
+      bool                      _finished = false;
+  };
+
+  lz4_compressor::lz4_compressor(size_t block_size)
+  :my(new impl(block_size))
+  {
+  }
+
+  lz4_compressor::~lz4_compressor() = default;
+  lz4_compressor::lz4_compressor(lz4_compressor&&) = default;
+  lz4_compressor& lz4_compressor::operator=(lz4_compressor&&) = default;
+
+  void lz4_compressor::reset()
+  {
+    my->_fill = 0;
+    my->_crc = 0;
+    my->_started = false;
+    my->_finished = false;
+  }
+
+  void lz4_compressor::write(const char* data, size_t size, std::vector<char>& out)
+  {
+    my->start(out);
+    const size_t block_size = my->_block_size;
+    while (size) {
+      // whole blocks go straight from the caller's buffer
+      if (my->_fill == 0 && size >= block_size) {
+        my->emit_block(data, block_size, out);
+        data += block_size;
+        size -= block_size;
+        continue;
+      }
+      if (!my->_block) my->_block.reset(new char[block_size]);
+      const size_t n = std::min(size, block_size - my->_fill);
+      memcpy(my->_block.get() + my->_fill, data, n);
+      my->_fill += n;
+      data += n;
+      size -= n;
+      if (my->_fill == block_size) flush(out);
+    }
+  }
+
+  void lz4_compressor::flush(std::vector<char>& out)
+  {
+    my->start(out);
+    if (!my->_fill) return;
+    my->emit_block(my->_block.get(), my->_fill, out);
+    my->_fill = 0;
+  }
+
+  void lz4_compressor::finish(std::vector<char>& out)
+  {
+    flush(out);
+    const size_t pos = out.size();
+    out.resize(pos + 8);
+    write32_le(out.data() + pos, 0);
+    write32_le(out.data() + pos + 4, my->_crc);
+    my->_finished = true;
+  }
+
+  void lz4_compressor::compress(const char* data, size_t size, std::vector<char>& out)
+  {
+    reset();
+    out.clear();
+    write(data, size, out);
+    finish(out);
+  }
+
+  class lz4_decompressor::impl
+  {
+    public:
+      enum stage_type {
+        header_stage,
+        block_stage,
+        payload_stage,
+        trailer_stage,
+        done_stage
+      };
+
+      /**
+       *  The next @p n bytes of the frame: straight from the input when they are all there, otherwise
+       *  gathered across writes. nullptr until enough have arrived.
+       */
+      const char* take(size_t n, const char*& data, size_t& size)
+      {
+        if (_pending.empty() && size >= n) {
+          const char* p = data;
+          data += n;
+          size -= n;
+          return p;
+        }
+        const size_t k = std::min(n - _pending.size(), size);
+        _pending.insert(_pending.end(), data, data + k);
+        data += k;
+        size -= k;
+        return _pending.size() == n ? _pending.data() : nullptr;
+      }
+
+      stage_type          _stage = header_stage;
+      size_t              _block_size = 0;
+      size_t              _payload_size = 0;
+      bool                _stored = false;
+      uint32_t            _crc = 0;
+      std::vector<char>   _pending;
+  };
+
+  lz4_decompressor::lz4_decompressor()
+  :my(new impl)
+  {
+  }
+
+  lz4_decompressor::~lz4_decompressor() = default;
+  lz4_decompressor::lz4_decompressor(lz4_decompressor&&) = default;
+  lz4_decompressor& lz4_decompressor::operator=(lz4_decompressor&&) = default;
+
+  void lz4_decompressor::reset()
+  {
+    my->_stage = impl::header_stage;
+    my->_crc = 0;
+    my->_pending.clear();
+  }
+
+  bool lz4_decompressor::finished()const
+  {
+    return my->_stage == impl::done_stage;
+  }
+
+  bool lz4_decompressor::write(const char* data, size_t size, std::vector<char>& out)
+  {
+    for (;;) {
+      const char* p = nullptr;
+      switch (my->_stage) {
+        case impl::header_stage: {
+          if (!(p = my->take(frame_header_size, data, size))) return false;
+          const uint8_t block_log = uint8_t(p[5]);
+          if (memcmp(p, frame_magic, sizeof(frame_magic)) != 0 || uint8_t(p[4]) != frame_version || block_log < 16 || block_log > 22)
+            FC_THROW_EXCEPTION(parse_error_exception, "Not an lz4 frame");
+          my->_block_size = size_t(1) << block_log;
+          my->_stage = impl::block_stage;
+          break;
+        }
+        case impl::block_stage: {
+          if (!(p = my->take(4, data, size))) return false;
+          const uint32_t header = read32_le(p);
+          my->_stored = header & stored_block;
+          my->_payload_size = header & ~stored_block;
+          if (!header) {
+            my->_stage = impl::trailer_stage;
+          } else {
+            if (my->_payload_size > (my->_stored ? my->_block_size : lz4_block_bound(my->_block_size)))
+              FC_THROW_EXCEPTION(parse_error_exception, "lz4 block of ${n} bytes is too large", ("n", my->_payload_size));
+            my->_stage = impl::payload_stage;
+          }
+          break;
+        }
+        case impl::payload_stage: {
+          const size_t n = my->_payload_size;
+          if (!(p = my->take(n + 4, data, size))) return false;
+          if (crc32c(p, n) != read32_le(p + n))
+            FC_THROW_EXCEPTION(parse_error_exception, "lz4 block checksum mismatch");
+          const size_t pos = out.size();
+          if (my->_stored) {
+            out.insert(out.end(), p, p + n);
+          } else {
+            out.resize(pos + my->_block_size);
+            out.resize(pos + lz4_decompress_block(p, n, out.data() + pos, my->_block_size));
+          }
+          my->_crc = crc32c(out.data() + pos, out.size() - pos, my->_crc);
+          my->_stage = impl::block_stage;
+          break;
+        }
+        case impl::trailer_stage: {
+          if (!(p = my->take(4, data, size))) return false;
+          if (read32_le(p) != my->_crc)
+            FC_THROW_EXCEPTION(parse_error_exception, "lz4 frame checksum mismatch");
+          my->_stage = impl::done_stage;
+          break;
+        }
+        case impl::done_stage:
+          FC_ASSERT(size == 0, "${n} bytes after the end of the lz4 frame", ("n", size));
+          return true;
+      }
+      my->_pending.clear();
+    }
+  }
+
+  void lz4_decompressor::decompress(const char* data, size_t size, std::vector<char>& out)
+  {
+    reset();
+    out.clear();
+    if (!write(data, size, out)) {
+      out.clear();
+      FC_THROW_EXCEPTION(eof_exception, "Truncated lz4 frame");
+    }
+  }
+
+  void lz4_compress(const char* in, size_t size, std::vector<char>& out, size_t block_size)
+  {
+    lz4_compressor(block_size).compress(in, size, out);
+  }
+
+  void lz4_decompress(const char* in, size_t size, std::vector<char>& out)
+  {
+    lz4_decompressor().decompress(in, size, out);
+  }
+}
@@ -0,0 +1,273 @@
+#include <fc/compress/parallel_zlib.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <cstring>
+#include <exception>
+
+#include "../crypto/_worker_pool.hpp"
+
+namespace fc
+{
+  namespace
+  {
+    constexpr char frame_magic[4] = { 'f', 'c', 'P', 'Z' };
+    constexpr uint8_t frame_version = 1;
+    constexpr size_t frame_header_size = 5;
+    constexpr size_t chunk_header_size = 8;
+    constexpr size_t max_chunk_size = 256 * 1024 * 1024;
+    // deflate can't do better than about 1032:1, so a chunk claiming more is corrupt rather than large
+    constexpr uint64_t max_deflate_ratio = 1032;
+
+    uint32_t read32_le(const char* p)
+    {
+      auto b = (const uint8_t*)p;
+      return uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 | uint32_t(b[3]) << 24;
+    }
+
+    void write32_le(char* p, uint32_t v)
+    {
+      p[0] = char(v);
+      p[1] = char(v >> 8);
+      p[2] = char(v >> 16);
+      p[3] = char(v >> 24);
+    }
+
+    /** Rethrows, on the calling thread, the first exception a job left behind */
+    void rethrow_first(const std::vector<std::exception_ptr>& errors)
+    {
+      for (const auto& e : errors)
+        if (e) std::rethrow_exception(e);
+    }
+  }
+
+  class parallel_zlib_compressor::impl : public fc::detail::worker_pool
+  {
+    public:
+      impl(uint32_t threads, int level, size_t chunk_size)
+      :worker_pool(threads)
+      ,_level(level)
+      ,_chunk_size(chunk_size)
+      ,_batch_size(chunk_size * this->threads() * 2)
+      {
+        FC_ASSERT(level >= 0 && level <= 10, "zlib level ${l} is out of range", ("l", level));
+        FC_ASSERT(chunk_size > 0 && chunk_size <= max_chunk_size, "chunk size ${s} is out of range", ("s", chunk_size));
+      }
+
+      struct compress_job {
+        const char*                          data;
+        size_t                               size;
+        size_t                               chunk_size;
+        int                                  level;
+        std::vector<std::vector<char>>&      chunks;
+        std::vector<std::exception_ptr>&     errors;
+
+        static void apply(void* context, size_t i) {
+          auto& self = *static_cast<compress_job*>(context);
+          try {
+            const size_t begin = i * self.chunk_size;
+            zlib_compress(self.data + begin, std::min(self.chunk_size, self.size - begin), self.chunks[i], self.level);
+          } catch (...) {
+            self.errors[i] = std::current_exception();
+          }
+        }
+      };
+
+      void start(std::vector<char>& out)
+      {
+        FC_ASSERT(!_finished, "the parallel zlib frame has already been finished");
+        if (_started) return;
+        out.insert(out.end(), std::begin(frame_magic), std::end(frame_magic));
+        out.push_back(char(frame_version));
+        _started = true;
+      }
+
+      /** Compresses [data, data + size) as consecutive chunks on all threads and appends them in order */
+      void compress_chunks(const char* data, size_t size, std::vector<char>& out)
+      {
+        const size_t count = (size + _chunk_size - 1) / _chunk_size;
+        if (_chunks.size() < count) _chunks.resize(count);
+        _errors.assign(count, nullptr);
+        compress_job job{ data, size, _chunk_size, _level, _chunks, _errors };
+        run(count, &compress_job::apply, &job);
+        rethrow_first(_errors);
+
+        size_t total = 0;
+        for (size_t i = 0; i < count; ++i) total += chunk_header_size + _chunks[i].size();
+        size_t pos = out.size();
+        out.resize(pos + total);
+        for (size_t i = 0; i < count; ++i) {
+          const auto& chunk = _chunks[i];
+          write32_le(out.data() + pos, uint32_t(std::min(_chunk_size, size - i * _chunk_size)));
+          write32_le(out.data() + pos + 4, uint32_t(chunk.size()));
+          memcpy(out.data() + pos + chunk_header_size, chunk.data(), chunk.size());
+          pos += chunk_header_size + chunk.size();
+        }
+      }
+
+      int                                  _level;
+      size_t                               _chunk_size;
+      size_t                               _batch_size;
+      std::vector<char>                    _buffer;
+      std::vector<std::vector<char>>       _chunks;
+      std::vector<std::exception_ptr>      _errors;
+      bool                                 _started = false;
+      bool                                 _finished = false;
+  };
+
+  parallel_zlib_compressor::parallel_zlib_compressor(uint32_t threads, int level, size_t chunk_size)
+  :my(new impl(threads, level, chunk_size))
+  {
+  }
+
+  parallel_zlib_compressor::~parallel_zlib_compressor() = default;
+  parallel_zlib_compressor::parallel_zlib_compressor(parallel_zlib_compressor&&) = default;
+  parallel_zlib_compressor& parallel_zlib_compressor::operator=(parallel_zlib_compressor&&) = default;
+
+  uint32_t parallel_zlib_compressor::threads()const
+  {
+    return my->threads();
+  }
+
+  void parallel_zlib_compressor::reset()
+  {
+    my->_buffer.clear();
+    my->_started = false;
+    my->_finished = false;
+  }
+
+  void parallel_zlib_compressor::write(const char* data, size_t size, std::vector<char>& out)
+  {
+    my->start(out);
+    const size_t batch = my->_batch_size;
+    if (!my->_buffer.empty()) {
+      const size_t n = std::min(size, batch - my->_buffer.size());
+      my->_buffer.insert(my->_buffer.end(), data, data + n);
+      data += n;
+      size -= n;
+      if (my->_buffer.size() < batch) return;
+      my->compress_chunks(my->_buffer.data(), batch, out);
+      my->_buffer.clear();
+    }
+    // whole batches go straight from the caller's buffer
+    const size_t direct = size - size % batch;
+    if (direct) my->compress_chunks(data, direct, out);
+    my->_buffer.assign(data + direct, data + size);
+  }
+
+  void parallel_zlib_compressor::finish(std::vector<char>& out)
+  {
+    my->start(out);
+    if (!my->_buffer.empty()) my->compress_chunks(my->_buffer.data(), my->_buffer.size(), out);
+    my->_buffer.clear();
+    const size_t pos = out.size();
+    out.resize(pos + 4);
+    write32_le(out.data() + pos, 0);
+    my->_finished = true;
+  }
+
+  void parallel_zlib_compressor::compress(const char* data, size_t size, std::vector<char>& out)
+  {
+    reset();
+    out.clear();
+    my->start(out);
+    if (size) my->compress_chunks(data, size, out);
+    finish(out);
+  }
+
+  class parallel_zlib_decompressor::impl : public fc::detail::worker_pool
+  {
+    public:
+      explicit impl(uint32_t threads)
+      :worker_pool(threads)
+      {
+      }
+
+      struct chunk {
+        const char*  data;
+        uint32_t     size;
+        uint32_t     raw_size;
+        size_t       offset;
+      };
+
+      struct decompress_job {
+        const std::vector<chunk>&           chunks;
+        char*                               out;
+        std::vector<std::exception_ptr>&    errors;
+
+        static void apply(void* context, size_t i) {
+          auto& self = *static_cast<decompress_job*>(context);
+          const auto& c = self.chunks[i];
+          try {
+            if (zlib_decompress(c.data, c.size, self.out + c.offset, c.raw_size) != c.raw_size)
+              FC_THROW_EXCEPTION(parse_error_exception, "chunk ${i} is shorter than its header says", ("i", i));
+          } catch (...) {
+            self.errors[i] = std::current_exception();
+          }
+        }
+      };
+
+      std::vector<chunk>                  _chunks;
+      std::vector<std::exception_ptr>     _errors;
+  };
+
+  parallel_zlib_decompressor::parallel_zlib_decompressor(uint32_t threads)
+  :my(new impl(threads))
+  {
+  }
+
+  parallel_zlib_decompressor::~parallel_zlib_decompressor() = default;
+  parallel_zlib_decompressor::parallel_zlib_decompressor(parallel_zlib_decompressor&&) = default;
+  parallel_zlib_decompressor& parallel_zlib_decompressor::operator=(parallel_zlib_decompressor&&) = default;
+
+  uint32_t parallel_zlib_decompressor::threads()const
+  {
+    return my->threads();
+  }
+
+  void parallel_zlib_decompressor::decompress(const char* data, size_t size, std::vector<char>& out)
+  {
+    out.clear();
+    if (size < frame_header_size)
+      FC_THROW_EXCEPTION(eof_exception, "Truncated parallel zlib frame");
+    if (memcmp(data, frame_magic, sizeof(frame_magic)) != 0 || uint8_t(data[4]) != frame_version)
+      FC_THROW_EXCEPTION(parse_error_exception, "Not a parallel zlib frame");
+
+    // the chunk headers first, to know where every chunk starts and where its output goes
+    auto& chunks = my->_chunks;
+    chunks.clear();
+    size_t pos = frame_header_size;
+    size_t total = 0;
+    for (;;) {
+      if (size - pos < 4)
+        FC_THROW_EXCEPTION(eof_exception, "Truncated parallel zlib frame");
+      const uint32_t raw_size = read32_le(data + pos);
+      if (!raw_size) {
+        pos += 4;
+        break;
+      }
+      if (size - pos < chunk_header_size)
+        FC_THROW_EXCEPTION(eof_exception, "Truncated parallel zlib frame");
+      const uint32_t compressed_size = read32_le(data + pos + 4);
+      pos += chunk_header_size;
+      if (raw_size > max_chunk_size || raw_size > compressed_size * max_deflate_ratio)
+        FC_THROW_EXCEPTION(parse_error_exception, "Chunk of ${n} bytes from ${c} compressed", ("n", raw_size)("c", compressed_size));
+      if (size - pos < compressed_size)
+        FC_THROW_EXCEPTION(eof_exception, "Truncated parallel zlib frame");
+      chunks.push_back({ data + pos, compressed_size, raw_size, total });
+      pos += compressed_size;
+      total += raw_size;
+    }
+    FC_ASSERT(pos == size, "${n} bytes after the end of the parallel zlib frame", ("n", size - pos));
+
+    out.resize(total);
+    my->_errors.assign(chunks.size(), nullptr);
+    impl::decompress_job job{ chunks, out.data(), my->_errors };
+    my->run(chunks.size(), &impl::decompress_job::apply, &job);
+    try {
+      rethrow_first(my->_errors);
+    } catch (...) {
+      out.clear();
+      throw;
+    }
+  }
+}
@@ -1,15 +1,344 @@
 #include <fc/compress/zlib.hpp>
+#include <fc/exception/exception.hpp>
 
+#include <memory>
+
+// the zlib-style macros would rename members such as compress()
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
 #include "miniz.c"
 
 namespace fc
 {
+  namespace
+  {
+    /**
+     *  One spare T per thread: the compressor state is large enough that allocating it for every
+     *  stream shows up, and a thread typically runs one stream at a time.
+     */
+    template<typename T>
+    struct thread_spare
+    {
+      static std::unique_ptr<T> take()
+      {
+        auto& s = slot();
+        if (s) return std::move(s);
+        return std::unique_ptr<T>(new T);
+      }
+
+      static void give(std::unique_ptr<T> state)
+      {
+        auto& s = slot();
+        if (!s) s = std::move(state);
+      }
+
+    private:
+      static std::unique_ptr<T>& slot()
+      {
+        static thread_local std::unique_ptr<T> s;
+        return s;
+      }
+    };
+
+    mz_bool append_to_vector(const void* buf, int len, void* user)
+    {
+      auto& out = *static_cast<std::vector<char>*>(user);
+      out.insert(out.end(), static_cast<const char*>(buf), static_cast<const char*>(buf) + len);
+      return MZ_TRUE;
+    }
+
+    struct inflate_state
+    {
+      tinfl_decompressor  decompressor;
+      mz_uint8            window[TINFL_LZ_DICT_SIZE];
+    };
+  }
+
+  class zlib_compressor::impl
+  {
+    public:
+      explicit impl(int level)
+      :_state(thread_spare<tdefl_compressor>::take())
+      {
+        start(level);
+      }
+
+      ~impl()
+      {
+        thread_spare<tdefl_compressor>::give(std::move(_state));
+      }
+
+      void start(int level)
+      {
+        FC_ASSERT(level >= 0 && level <= 10, "zlib level ${l} is out of range", ("l", level));
+        _level = level;
+        const mz_uint flags = tdefl_create_comp_flags_from_zip_params(level, MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY);
+        FC_ASSERT(tdefl_init(_state.get(), append_to_vector, nullptr, flags) == TDEFL_STATUS_OKAY);
+        _finished = false;
+      }
+
+      void compress(const char* data, size_t size, std::vector<char>& out, tdefl_flush flush)
+      {
+        FC_ASSERT(!_finished, "the zlib stream has already been finished");
+        // the output vector can change from call to call
+        _state->m_pPut_buf_user = &out;
+        const tdefl_status status = tdefl_compress_buffer(_state.get(), data, size, flush);
+        _state->m_pPut_buf_user = nullptr;
+        if (flush == TDEFL_FINISH) {
+          FC_ASSERT(status == TDEFL_STATUS_DONE);
+          _finished = true;
+        } else {
+          FC_ASSERT(status == TDEFL_STATUS_OKAY);
+        }
+      }
+
+      std::unique_ptr<tdefl_compressor>  _state;
+      int                                _level = zlib_default_level;
+      bool                               _finished = false;
+  };
+
+  zlib_compressor::zlib_compressor(int level)
+  :my(new impl(level))
+  {
+  }
+
+  zlib_compressor::~zlib_compressor() = default;
+  zlib_compressor::zlib_compressor(zlib_compressor&&) = default;
+  zlib_compressor& zlib_compressor::operator=(zlib_compressor&&) = default;
+
+  void zlib_compressor::reset()
+  {
+    my->start(my->_level);
+  }
+
+  void zlib_compressor::reset(int level)
+  {
+    my->start(level);
+  }
+
+  void zlib_compressor::write(const char* data, size_t size, std::vector<char>& out)
+  {
+    if (size) my->compress(data, size, out, TDEFL_NO_FLUSH);
+  }
+
+  void zlib_compressor::flush(std::vector<char>& out)
+  {
+    my->compress(nullptr, 0, out, TDEFL_SYNC_FLUSH);
+  }
+
+  void zlib_compressor::finish(std::vector<char>& out)
+  {
+    my->compress(nullptr, 0, out, TDEFL_FINISH);
+  }
+
+  void zlib_compressor::compress(const char* data, size_t size, std::vector<char>& out)
+  {
+    my->start(my->_level);
+    out.clear();
+    my->compress(data, size, out, TDEFL_FINISH);
+  }
+
+  class zlib_decompressor::impl
+  {
+    public:
+      explicit impl(size_t max_size)
+      :_state(thread_spare<inflate_state>::take())
+      ,_max_size(max_size)
+      {
+        start();
+      }
+
+      ~impl()
+      {
+        thread_spare<inflate_state>::give(std::move(_state));
+      }
+
+      void start()
+      {
+        tinfl_init(&_state->decompressor);
+        _window_pos = 0;
+        _produced = 0;
+        _finished = false;
+      }
+
+      [[noreturn]] void too_large()const
+      {
+        FC_THROW_EXCEPTION(parse_error_exception, "zlib stream inflates to more than ${n} bytes", ("n", _max_size));
+      }
+
+      std::unique_ptr<inflate_state>  _state;
+      size_t                          _max_size;
+      size_t                          _window_pos = 0;
+      size_t                          _produced = 0;
+      bool                            _finished = false;
+  };
+
+  zlib_decompressor::zlib_decompressor(size_t max_size)
+  :my(new impl(max_size))
+  {
+  }
+
+  zlib_decompressor::~zlib_decompressor() = default;
+  zlib_decompressor::zlib_decompressor(zlib_decompressor&&) = default;
+  zlib_decompressor& zlib_decompressor::operator=(zlib_decompressor&&) = default;
+
+  void zlib_decompressor::reset()
+  {
+    my->start();
+  }
+
+  bool zlib_decompressor::finished()const
+  {
+    return my->_finished;
+  }
+
+  bool zlib_decompressor::write(const char* data, size_t size, std::vector<char>& out)
+  {
+    if (my->_finished) {
+      FC_ASSERT(size == 0, "${n} bytes written after the end of the zlib stream", ("n", size));
+      return true;
+    }
+
+    // output goes through the 32 KB window the back references point into, then to the caller
+    auto in = (const mz_uint8*)data;
+    auto& state = *my->_state;
+    for (;;) {
+      size_t in_bytes = size;
+      size_t out_bytes = TINFL_LZ_DICT_SIZE - my->_window_pos;
+      const tinfl_status status = tinfl_decompress(&state.decompressor, in, &in_bytes, state.window, state.window + my->_window_pos,
+                                                   &out_bytes, TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+      in += in_bytes;
+      size -= in_bytes;
+      if (out_bytes > my->_max_size - my->_produced) my->too_large();
+      my->_produced += out_bytes;
+      const char* produced = (const char*)state.window + my->_window_pos;
+      out.insert(out.end(), produced, produced + out_bytes);
+      my->_window_pos = (my->_window_pos + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+      if (status == TINFL_STATUS_DONE) {
+        // anything after the end can't be told apart reliably, the decoder reads ahead
+        my->_finished = true;
+        return true;
+      }
+      if (status < TINFL_STATUS_DONE)
+        FC_THROW_EXCEPTION(parse_error_exception, "Invalid zlib stream, status ${s}", ("s", int(status)));
+      if (status == TINFL_STATUS_NEEDS_MORE_INPUT && size == 0)
+        return false;
+    }
+  }
+
+  void zlib_decompressor::decompress(const char* data, size_t size, std::vector<char>& out)
+  {
+    my->start();
+    auto& state = *my->_state;
+
+    // straight into the output, which grows until the whole stream fits, up to max_size
+    auto in = (const mz_uint8*)data;
+    size_t produced = 0;
+    out.resize(std::min(std::max(out.capacity(), std::max<size_t>(4096, size * 4)), my->_max_size));
+    for (;;) {
+      size_t in_bytes = size;
+      size_t out_bytes = out.size() - produced;
+      const tinfl_status status = tinfl_decompress(&state.decompressor, in, &in_bytes, (mz_uint8*)out.data(), (mz_uint8*)out.data() + produced,
+                                                   &out_bytes, TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF |
+                                                   TINFL_FLAG_HAS_MORE_INPUT); // so running out of input is reported, not read as zeros
+      in += in_bytes;
+      size -= in_bytes;
+      produced += out_bytes;
+
+      if (status == TINFL_STATUS_DONE) break;
+      if (status == TINFL_STATUS_HAS_MORE_OUTPUT) {
+        if (out.size() >= my->_max_size) {
+          out.clear();
+          my->too_large();
+        }
+        // grown exactly, resize() alone could allocate past max_size
+        const size_t grown = std::min(out.size() * 2, my->_max_size);
+        out.reserve(grown);
+        out.resize(grown);
+        continue;
+      }
+      out.clear();
+      if (status == TINFL_STATUS_NEEDS_MORE_INPUT)
+        FC_THROW_EXCEPTION(eof_exception, "Truncated zlib stream");
+      FC_THROW_EXCEPTION(parse_error_exception, "Invalid zlib stream, status ${s}", ("s", int(status)));
+    }
+    out.resize(produced);
+    my->_finished = true;
+  }
+
+  size_t zlib_decompressor::decompress(const char* data, size_t size, char* out, size_t capacity)
+  {
+    my->start();
+    size_t in_bytes = size;
+    size_t out_bytes = capacity;
+    const tinfl_status status = tinfl_decompress(&my->_state->decompressor, (const mz_uint8*)data, &in_bytes, (mz_uint8*)out, (mz_uint8*)out,
+                                                 &out_bytes, TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF |
+                                                 TINFL_FLAG_HAS_MORE_INPUT);
+    if (status == TINFL_STATUS_NEEDS_MORE_INPUT)
+      FC_THROW_EXCEPTION(eof_exception, "Truncated zlib stream");
+    if (status == TINFL_STATUS_HAS_MORE_OUTPUT)
+      FC_THROW_EXCEPTION(parse_error_exception, "zlib stream does not fit in ${n} bytes", ("n", capacity));
+    if (status != TINFL_STATUS_DONE)
+      FC_THROW_EXCEPTION(parse_error_exception, "Invalid zlib stream, status ${s}", ("s", int(status)));
+    my->_finished = true;
+    return out_bytes;
+  }
+
+  zlib_compress_stream::zlib_compress_stream(std::vector<char>& out, int level)
+  :_compressor(level)
+  ,_out(out)
+  {
+  }
+
+  void zlib_compress_stream::finish()
+  {
+    flush_buffer();
+    _compressor.finish(_out);
+  }
+
+  void zlib_compress_stream::flush_buffer()
+  {
+    _compressor.write(_buffer, _size, _out);
+    _size = 0;
+  }
+
+  void zlib_compress_stream::write_through(const char* d, size_t dlen)
+  {
+    flush_buffer();
+    if (dlen >= sizeof(_buffer)) {
+      _compressor.write(d, dlen, _out);
+      return;
+    }
+    memcpy(_buffer, d, dlen);
+    _size = dlen;
+  }
+
   string zlib_compress(const string& in)
   {
-    size_t compressed_message_length;
-    char* compressed_message = (char*)tdefl_compress_mem_to_heap(in.c_str(), in.size(), &compressed_message_length,  TDEFL_WRITE_ZLIB_HEADER | TDEFL_DEFAULT_MAX_PROBES);
-    string result(compressed_message, compressed_message_length);
-    free(compressed_message);
-    return result;
+    std::vector<char> out;
+    zlib_compress(in.data(), in.size(), out);
+    return string(out.data(), out.size());
+  }
+
+  void zlib_compress(const char* in, size_t size, std::vector<char>& out, int level)
+  {
+    zlib_compressor(level).compress(in, size, out);
+  }
+
+  string zlib_decompress(const string& in, size_t max_size)
+  {
+    std::vector<char> out;
+    zlib_decompress(in.data(), in.size(), out, max_size);
+    return string(out.data(), out.size());
+  }
+
+  void zlib_decompress(const char* in, size_t size, std::vector<char>& out, size_t max_size)
+  {
+    zlib_decompressor(max_size).decompress(in, size, out);
+  }
+
+  size_t zlib_decompress(const char* in, size_t size, char* out, size_t capacity)
+  {
+    return zlib_decompressor().decompress(in, size, out, capacity);
   }
 }
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Fixed set of threads which split an indexed job with the calling thread
+ */
+namespace fc { namespace detail {
+
+   class worker_pool
+   {
+      public:
+         using job_type = void (*)( void* context, size_t index );
+
+         explicit worker_pool( uint32_t threads )
+         {
+            if( !threads ) threads = std::max( 1u, std::thread::hardware_concurrency() );
+            _workers.reserve( threads - 1 );
+            for( uint32_t i = 1; i < threads; ++i )
+               _workers.emplace_back( [this]{ work(); } );
+         }
+
+         ~worker_pool()
+         {
+            {
+               std::lock_guard<std::mutex> lock( _mutex );
+               _stopping = true;
+            }
+            _wake.notify_all();
+            for( auto& worker : _workers )
+               worker.join();
+         }
+
+         uint32_t threads()const { return _workers.size() + 1; }
+
+         // calls job( context, i ) for every i in [0, count), spread over the workers and the caller
+         void run( size_t count, job_type job, void* context )
+         {
+            std::lock_guard<std::mutex> batch( _batch_mutex );
+
+            // jobs are expected to be coarse (a signature, a run of hashes), so small chunks keep the threads evenly loaded
+            const size_t chunk = std::max<size_t>( 1, std::min<size_t>( 16, count / ( threads() * 4 ) ) );
+            if( _workers.empty() || count <= chunk ) {
+               for( size_t i = 0; i < count; ++i )
+                  job( context, i );
+               return;
+            }
+
+            {
+               std::lock_guard<std::mutex> lock( _mutex );
+               _job = job;
+               _context = context;
+               _count = count;
+               _chunk = chunk;
+               _next = 0;
+               _active = _workers.size();
+               ++_generation;
+            }
+            _wake.notify_all();
+
+            drain();
+
+            std::unique_lock<std::mutex> lock( _mutex );
+            _done.wait( lock, [this]{ return _active == 0; } );
+         }
+
+      private:
+         void drain()
+         {
+            for( ;; ) {
+               const size_t begin = _next.fetch_add( _chunk, std::memory_order_relaxed );
+               if( begin >= _count ) return;
+               const size_t end = std::min( begin + _chunk, _count );
+               for( size_t i = begin; i < end; ++i )
+                  _job( _context, i );
+            }
+         }
+
+         void work()
+         {
+            uint64_t seen = 0;
+            std::unique_lock<std::mutex> lock( _mutex );
+            for( ;; ) {
+               _wake.wait( lock, [&]{ return _stopping || _generation != seen; } );
+               if( _stopping ) return;
+               seen = _generation;
+
+               lock.unlock();
+               drain();
+               lock.lock();
+
+               if( --_active == 0 ) _done.notify_one();
+            }
+         }
+
+         std::vector<std::thread>   _workers;
+         std::mutex                 _batch_mutex;
+
+         std::mutex                 _mutex;
+         std::condition_variable    _wake;
+         std::condition_variable    _done;
+         bool                       _stopping = false;
+         uint64_t                   _generation = 0;
+         size_t                     _active = 0;
+
+         // the current batch, published to the workers under _mutex
+         job_type                   _job = nullptr;
+         void*                      _context = nullptr;
+         size_t                     _count = 0;
+         size_t                     _chunk = 1;
+         std::atomic<size_t>        _next{ 0 };
+   };
+
+} } // fc::detail
@@ -1,5 +1,4 @@
 #include <fc/crypto/base64.hpp>
-#include <ctype.h>
 /* 
    base64.cpp and base64.h
 
@@ -25,108 +24,182 @@
 
    René Nyffenegger rene.nyffenegger@adp-gmbh.ch
 
+   Altered for fc: table driven, with SSE4.1 kernels and caller buffer variants.
+
 */
 
+#if defined(__x86_64__) && ( defined(__GNUC__) || defined(__clang__) )
+#define FC_BASE64_SSE 1
+#include <immintrin.h>
+#endif
+
 namespace fc {
 
-inline const std::string& base64_chars()
-{
-    static const std::string m_base64_chars = 
-                 "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-                 "abcdefghijklmnopqrstuvwxyz"
-                 "0123456789+/";
-    return m_base64_chars;
-}
+namespace {
 
-static inline bool is_base64(unsigned char c) {
-  return (isalnum(c) || (c == '+') || (c == '/'));
-}
+constexpr const char* base64_chars =
+             "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+             "abcdefghijklmnopqrstuvwxyz"
+             "0123456789+/";
 
-std::string base64_encode(const std::vector<char>& bytes_to_encode) {
+// built at compile time, so it's usable from other static initializers
+struct base64_values {
+  int8_t value[256];
 
-  std::string ret;
-  int i = 0;
-  int j = 0;
-  unsigned char char_array_3[3];
-  unsigned char char_array_4[4];
-
-  for (const auto& byte : bytes_to_encode) {
-    char_array_3[i++] = byte;
-    if (i == 3) {
-      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-      char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-      char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-      char_array_4[3] = char_array_3[2] & 0x3f;
-
-      for(i = 0; (i <4) ; i++)
-        ret += base64_chars()[char_array_4[i]];
-      i = 0;
-    }
+  constexpr base64_values() : value{} {
+    for (int i = 0; i < 256; ++i) value[i] = -1;
+    for (int i = 0; i < 64; ++i) value[uint8_t(base64_chars[i])] = int8_t(i);
   }
+};
+constexpr base64_values sextet_values;
+
+inline void encode_group(const unsigned char* in, char* out) {
+  out[0] = base64_chars[in[0] >> 2];
+  out[1] = base64_chars[(in[0] & 0x03) << 4 | in[1] >> 4];
+  out[2] = base64_chars[(in[1] & 0x0f) << 2 | in[2] >> 6];
+  out[3] = base64_chars[in[2] & 0x3f];
+}
 
-  if (i)
-  {
-    for(j = i; j < 3; j++)
-      char_array_3[j] = '\0';
-
-    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-    char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-    char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-    char_array_4[3] = char_array_3[2] & 0x3f;
-
-    for (j = 0; (j < i + 1); j++)
-      ret += base64_chars()[char_array_4[j]];
+inline void decode_group(const uint8_t* v, unsigned char* out) {
+  out[0] = v[0] << 2 | v[1] >> 4;
+  out[1] = v[1] << 4 | v[2] >> 2;
+  out[2] = v[2] << 6 | v[3];
+}
 
-    while((i++ < 3))
-      ret += '=';
+#ifdef FC_BASE64_SSE
+bool cpu_has_sse41() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.1");
+}
+const bool has_sse41 = cpu_has_sse41();
+
+// 12 bytes -> 16 chars per step, reading 16 bytes at a time; returns how many bytes were done
+__attribute__((target("sse4.1")))
+size_t encode_sse(const unsigned char* in, size_t size, char* out) {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 12, out += 16) {
+    // every three bytes b0 b1 b2 to the 32-bit word b1 b0 b2 b1, so each sextet sits in one 16-bit half
+    __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + i)),
+                                 _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i first_third = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+    const __m128i second_fourth = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+    const __m128i sextets = _mm_or_si128(first_third, second_fourth);
+
+    // sextet ranges A-Z, a-z, 0-9, + and / map to offsets 13, 0, 1-10, 11 and 12 of the shift table
+    __m128i range = _mm_subs_epu8(sextets, _mm_set1_epi8(51));
+    range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), sextets), _mm_set1_epi8(13)));
+    const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    _mm_storeu_si128((__m128i*)out, _mm_add_epi8(_mm_shuffle_epi8(shift, range), sextets));
+  }
+  return i;
+}
 
+// 16 chars -> 12 bytes per step, writing 16 at a time; stops at the first block holding anything but
+// the 64 digits and returns how many chars were done
+__attribute__((target("sse4.1")))
+size_t decode_sse(const char* in, size_t size, unsigned char* out) {
+  // a char is valid unless its low nibble's bitmask shares a bit with its high nibble's class
+  const __m128i low_mask = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m128i high_class = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+
+  size_t i = 0;
+  // the last step writes 16 bytes, which the size bound of the output allows only this far in
+  for (; i + 32 <= size; i += 16, out += 12) {
+    const __m128i chars = _mm_loadu_si128((const __m128i*)(in + i));
+    const __m128i high = _mm_and_si128(_mm_srli_epi32(chars, 4), nibble);
+    const __m128i low = _mm_and_si128(chars, nibble);
+    if (!_mm_testz_si128(_mm_shuffle_epi8(low_mask, low), _mm_shuffle_epi8(high_class, high)))
+      break;
+
+    const __m128i slash = _mm_cmpeq_epi8(chars, _mm_set1_epi8('/'));
+    const __m128i sextets = _mm_add_epi8(chars, _mm_shuffle_epi8(roll, _mm_add_epi8(slash, high)));
+
+    // four sextets to 24 bits, big-endian
+    const __m128i pairs = _mm_maddubs_epi16(sextets, _mm_set1_epi32(0x01400140));
+    const __m128i words = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    _mm_storeu_si128((__m128i*)out, _mm_shuffle_epi8(words, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)));
+  }
+  return i;
+}
+#endif
+
+} // namespace
+
+size_t base64_encode(const char* data, size_t size, char* out) {
+  auto in = (const unsigned char*)data;
+  char* p = out;
+  size_t i = 0;
+#ifdef FC_BASE64_SSE
+  if (size >= 16 && has_sse41) {
+    i = encode_sse(in, size, p);
+    p += i / 3 * 4;
   }
+#endif
+  for (; i + 3 <= size; i += 3, p += 4)
+    encode_group(in + i, p);
+
+  if (i < size) {
+    unsigned char rest[3] = {};
+    for (size_t j = 0; i + j < size; ++j)
+      rest[j] = in[i + j];
+    encode_group(rest, p);
+    if (size - i == 1) p[2] = '=';
+    p[3] = '=';
+    p += 4;
+  }
+  return p - out;
+}
 
+std::string base64_encode(const char* data, size_t size) {
+  std::string ret(base64_encoded_size(size), '\0');
+  base64_encode(data, size, &ret[0]);
   return ret;
-
 }
 
+std::string base64_encode(const std::vector<char>& bytes_to_encode) {
+  return base64_encode(bytes_to_encode.data(), bytes_to_encode.size());
+}
 
-std::string base64_decode(std::string const& encoded_string) {
-  int in_len = encoded_string.size();
-  int i = 0;
-  int j = 0;
-  int in_ = 0;
-  unsigned char char_array_4[4], char_array_3[3];
-  std::string ret;
-
-  while (in_len-- && ( encoded_string[in_] != '=') && is_base64(encoded_string[in_])) {
-    char_array_4[i++] = encoded_string[in_]; in_++;
-    if (i ==4) {
-      for (i = 0; i <4; i++)
-        char_array_4[i] = base64_chars().find(char_array_4[i]);
-
-      char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-      char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-      for (i = 0; (i < 3); i++)
-        ret += char_array_3[i];
-      i = 0;
+size_t base64_decode(const char* encoded, size_t size, char* out) {
+  auto p = (unsigned char*)out;
+  size_t i = 0;
+#ifdef FC_BASE64_SSE
+  if (size >= 32 && has_sse41) {
+    i = decode_sse(encoded, size, p);
+    p += i / 4 * 3;
+  }
+#endif
+  // stops at padding or at anything else that isn't a digit, as it always has
+  uint8_t v[4];
+  size_t n = 0;
+  for (; i < size; ++i) {
+    const int8_t value = sextet_values.value[uint8_t(encoded[i])];
+    if (value < 0) break;
+    v[n++] = value;
+    if (n == 4) {
+      decode_group(v, p);
+      p += 3;
+      n = 0;
     }
   }
-
-  if (i) {
-    for (j = i; j <4; j++)
-      char_array_4[j] = 0;
-
-    for (j = 0; j <4; j++)
-      char_array_4[j] = base64_chars().find(char_array_4[j]);
-
-    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-    char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-    for (j = 0; (j < i - 1); j++) ret += char_array_3[j];
+  if (n) {
+    for (size_t j = n; j < 4; ++j) v[j] = 0;
+    unsigned char last[3];
+    decode_group(v, last);
+    for (size_t j = 0; j + 1 < n; ++j) *p++ = last[j];
   }
+  return p - (unsigned char*)out;
+}
 
+std::string base64_decode(std::string const& encoded_string) {
+  std::string ret(base64_decoded_size_bound(encoded_string.size()), '\0');
+  ret.resize(base64_decode(encoded_string.data(), encoded_string.size(), &ret[0]));
   return ret;
 }
 
 } // namespace fc
-
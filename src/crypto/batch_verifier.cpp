@@ -0,0 +1,108 @@
+#include <fc/crypto/batch_verifier.hpp>
+
+#include <boost/core/typeinfo.hpp>
+
+#include "_worker_pool.hpp"
+
+namespace fc { namespace crypto {
+
+   class batch_verifier::impl : public fc::detail::worker_pool
+   {
+      public:
+         using worker_pool::worker_pool;
+   };
+
+   namespace {
+      struct recovery_job {
+         const signature*                                 signatures;
+         const sha256*                                    digests;
+         bool                                             check_canonical;
+         std::vector<batch_verifier::recovery_result>&   results;
+
+         static void apply( void* context, size_t i ) {
+            auto& self = *static_cast<recovery_job*>( context );
+            auto& result = self.results[i];
+            try {
+               result.key = public_key( self.signatures[i], self.digests[i], self.check_canonical );
+            } catch( const fc::exception& e ) {
+               result.error = e.dynamic_copy_exception();
+            } catch( const std::exception& e ) {
+               result.error = std::make_shared<fc::exception>(
+                  FC_LOG_MESSAGE( warn, "${what}", ("what", e.what()) ),
+                  fc::std_exception_code, BOOST_CORE_TYPEID(e).name(), e.what() );
+            } catch( ... ) {
+               result.error = std::make_shared<fc::unhandled_exception>(
+                  FC_LOG_MESSAGE( warn, "unknown error recovering public key" ), std::current_exception() );
+            }
+         }
+      };
+
+      struct verify_job {
+         const signature*                                    signatures;
+         const sha256*                                       digests;
+         const public_key*                                   keys;
+         bool                                                check_canonical;
+         std::vector<batch_verifier::verify_status::type>&  results;
+
+         static void apply( void* context, size_t i ) {
+            auto& self = *static_cast<verify_job*>( context );
+            try {
+               self.results[i] = public_key( self.signatures[i], self.digests[i], self.check_canonical ) == self.keys[i]
+                                    ? batch_verifier::verify_status::valid
+                                    : batch_verifier::verify_status::mismatch;
+            } catch( ... ) {
+               self.results[i] = batch_verifier::verify_status::unrecoverable;
+            }
+         }
+      };
+   }
+
+   batch_verifier::batch_verifier( uint32_t threads )
+   :my( new impl( threads ) )
+   {
+   }
+
+   batch_verifier::~batch_verifier() = default;
+
+   uint32_t batch_verifier::threads()const
+   {
+      return my->threads();
+   }
+
+   std::vector<batch_verifier::recovery_result> batch_verifier::recover(
+      const signature* signatures, const sha256* digests, size_t count, bool check_canonical )const
+   {
+      std::vector<recovery_result> results( count );
+      recovery_job job{ signatures, digests, check_canonical, results };
+      my->run( count, &recovery_job::apply, &job );
+      return results;
+   }
+
+   std::vector<batch_verifier::recovery_result> batch_verifier::recover(
+      const std::vector<signature>& signatures, const std::vector<sha256>& digests, bool check_canonical )const
+   {
+      FC_ASSERT( signatures.size() == digests.size(), "${s} signatures for ${d} digests",
+                 ("s", signatures.size())("d", digests.size()) );
+      return recover( signatures.data(), digests.data(), signatures.size(), check_canonical );
+   }
+
+   std::vector<batch_verifier::verify_status::type> batch_verifier::verify(
+      const signature* signatures, const sha256* digests, const public_key* keys, size_t count, bool check_canonical )const
+   {
+      std::vector<verify_status::type> results( count, verify_status::unrecoverable );
+      verify_job job{ signatures, digests, keys, check_canonical, results };
+      my->run( count, &verify_job::apply, &job );
+      return results;
+   }
+
+   std::vector<batch_verifier::verify_status::type> batch_verifier::verify(
+      const std::vector<signature>& signatures, const std::vector<sha256>& digests,
+      const std::vector<public_key>& keys, bool check_canonical )const
+   {
+      FC_ASSERT( signatures.size() == digests.size() && signatures.size() == keys.size(),
+                 "${s} signatures, ${d} digests and ${k} keys don't match up",
+                 ("s", signatures.size())("d", digests.size())("k", keys.size()) );
+      return verify( signatures.data(), digests.data(), keys.data(), signatures.size(), check_canonical );
+   }
+
+} } // fc::crypto
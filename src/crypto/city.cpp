@@ -655,6 +655,17 @@ array<uint64_t,4> city_hash_crc_256(const char *s, size_t len)
    return buf;
 }
 
+// Same split as city_hash_crc_128: the CRC path only pays off on long inputs
+uint64_t city_hash_crc_64(const char *s, size_t len) {
+  if (len <= 900) {
+    return city_hash64(s, len);
+  } else {
+    uint64_t result[4];
+    CityHashCrc256(s, len, result);
+    return HashLen16(result[2], result[3]);
+  }
+}
+
 uint128 CityHashCrc128WithSeed(const char *s, size_t len, uint128 seed) {
   if (len <= 900) {
     return CityHash128WithSeed(s, len, seed);
@@ -1,5 +1,12 @@
+#include <fc/crypto/crc32c.hpp>
+
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && ( defined(__GNUC__) || defined(__clang__) )
+#define FC_CRC32C_SSE42 1
+#endif
 //#include <zlib.h>
 /* Tables generated with code like the following:
 
@@ -601,11 +608,137 @@ static const uint32_t crc_c[256] = {
          0x79B737BA, 0x8BDCB4B9, 0x988C474D, 0x6AE7C44E,
          0xBE2DA0A5, 0x4C4623A6, 0x5F16D052, 0xAD7D5351,
  };
+namespace fc {
+
+    namespace {
+      // reflected CRC-32C polynomial, bit 31 is x^0
+      constexpr uint32_t crc32c_poly = 0x82f63b78;
+
+      // a * b mod p over GF(2), both reflected
+      constexpr uint32_t multmodp( uint32_t a, uint32_t b ) {
+        uint32_t product = 0;
+        for( uint32_t m = 1u << 31; m; m >>= 1 ) {
+          if( a & m ) product ^= b;
+          b = b & 1 ? ( b >> 1 ) ^ crc32c_poly : b >> 1;
+        }
+        return product;
+      }
+
+      // x^(8 * bytes) mod p: what appending that many zero bytes multiplies a CRC by
+      constexpr uint32_t zeros_operator( uint64_t bytes ) {
+        uint32_t square = 1u << 30; // x^1, squared up to x^(2^k) as k walks the bits of 8 * bytes
+        uint32_t result = 1u << 31; // x^0
+        for( uint64_t bits = bytes * 8; bits; bits >>= 1 ) {
+          if( bits & 1 ) result = multmodp( square, result );
+          square = multmodp( square, square );
+        }
+        return result;
+      }
+
+      // appending a fixed number of zero bytes one CRC byte at a time; built at compile time
+      struct zeros_table {
+        uint32_t byte[4][256];
+
+        constexpr explicit zeros_table( uint64_t bytes ) : byte{} {
+          const uint32_t op = zeros_operator( bytes );
+          for( int i = 0; i < 4; ++i )
+            for( uint32_t b = 0; b < 256; ++b )
+              byte[i][b] = multmodp( op, b << ( 8 * i ) );
+        }
+
+        uint32_t shift( uint32_t crc )const {
+          return byte[0][crc & 0xff] ^ byte[1][( crc >> 8 ) & 0xff] ^ byte[2][( crc >> 16 ) & 0xff] ^ byte[3][crc >> 24];
+        }
+      };
+
+#ifdef FC_CRC32C_SSE42
+      bool cpu_has_sse42() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports( "sse4.2" );
+      }
+      const bool has_sse42 = cpu_has_sse42();
+
+      // the crc32 instruction takes 3 cycles but issues every cycle, so three independent streams
+      // over neighbouring blocks keep it busy; their CRCs are then joined with the zeros tables
+      const size_t long_block = 8192;
+      const size_t short_block = 256;
+      constexpr zeros_table long_zeros( long_block );
+      constexpr zeros_table short_zeros( short_block );
+
+      inline uint64_t load64( const char* p ) {
+        uint64_t v;
+        memcpy( &v, p, sizeof( v ) );
+        return v;
+      }
+
+      template<size_t Block>
+      __attribute__((target("sse4.2")))
+      inline uint32_t extend_3way( uint32_t crc, const char*& p, size_t& size, const zeros_table& zeros ) {
+        while( size >= 3 * Block ) {
+          uint64_t a = crc, b = 0, c = 0;
+          for( size_t i = 0; i < Block; i += 8 ) {
+            a = __builtin_ia32_crc32di( a, load64( p + i ) );
+            b = __builtin_ia32_crc32di( b, load64( p + Block + i ) );
+            c = __builtin_ia32_crc32di( c, load64( p + 2 * Block + i ) );
+          }
+          crc = zeros.shift( zeros.shift( uint32_t( a ) ) ^ uint32_t( b ) ) ^ uint32_t( c );
+          p += 3 * Block;
+          size -= 3 * Block;
+        }
+        return crc;
+      }
+
+      // the raw CRC register, without the inversions
+      __attribute__((target("sse4.2")))
+      uint32_t extend_sse42( uint32_t crc, const char* p, size_t size ) {
+        for( ; size && ( uintptr_t( p ) & 7 ); --size )
+          crc = __builtin_ia32_crc32qi( crc, *p++ );
+        crc = extend_3way<long_block>( crc, p, size, long_zeros );
+        crc = extend_3way<short_block>( crc, p, size, short_zeros );
+
+        uint64_t wide = crc;
+        for( ; size >= 8; size -= 8, p += 8 )
+          wide = __builtin_ia32_crc32di( wide, load64( p ) );
+        crc = uint32_t( wide );
+        for( ; size; --size )
+          crc = __builtin_ia32_crc32qi( crc, *p++ );
+        return crc;
+      }
+
+      __attribute__((target("sse4.2")))
+      uint64_t crc32_u64_sse42( uint64_t crc, uint64_t v ) {
+        return __builtin_ia32_crc32di( uint32_t( crc ), v );
+      }
+#endif
+
+      inline uint32_t extend( uint32_t crc, const char* p, size_t size ) {
+#ifdef FC_CRC32C_SSE42
+        if( has_sse42 ) return extend_sse42( crc, p, size );
+#endif
+        return crc32cSlicingBy8( crc, p, size );
+      }
+    }
+
+    uint32_t crc32c( const char* data, size_t size, uint32_t crc ) {
+      return ~extend( ~crc, data, size );
+    }
+
+    uint32_t crc32c_combine( uint32_t crc_a, uint32_t crc_b, size_t size_b ) {
+      return multmodp( zeros_operator( size_b ), crc_a ) ^ crc_b;
+    }
+
+} // namespace fc
+
 #if !defined __SSE4_2__ || (defined __SSE4_2__ && !defined __x86_64__)
 
 
+// city.cpp's stand-in for the intrinsic when the build doesn't target SSE4.2; still uses the
+// instruction on CPUs that have it
 uint64_t _mm_crc32_u64(uint64_t a, uint64_t b )
 {
+#ifdef FC_CRC32C_SSE42
+    if( fc::has_sse42 ) return fc::crc32_u64_sse42( a, b );
+#endif
     return crc32cSlicingBy8(a, (unsigned char*)&b, sizeof(b)); 
 }
 /*
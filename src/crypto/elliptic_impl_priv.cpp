@@ -85,17 +85,22 @@ namespace fc { namespace ecc {
         return secp256k1_nonce_function_default( nonce32, msg32, key32, *extra, nullptr );
     }
 
-    compact_signature private_key::sign_compact( const fc::sha256& digest, bool require_canonical )const
+    compact_signature private_key::sign_compact( const fc::sha256& digest, bool require_canonical, uint32_t* attempts )const
     {
         FC_ASSERT( my->_key != empty_priv );
+        const secp256k1_context_t* ctx = detail::_get_context();
         compact_signature result;
         int recid;
         unsigned int counter = 0;
+        uint32_t tries = 0;
         do
         {
-            FC_ASSERT( secp256k1_ecdsa_sign_compact( detail::_get_context(), (unsigned char*) digest.data(), (unsigned char*) result.begin() + 1, (unsigned char*) my->_key.data(), extended_nonce_function, &counter, &recid ));
+            ++tries;
+            if( !secp256k1_ecdsa_sign_compact( ctx, (unsigned char*) digest.data(), (unsigned char*) result.begin() + 1, (unsigned char*) my->_key.data(), extended_nonce_function, &counter, &recid ) )
+                FC_THROW_EXCEPTION( exception, "Unable to sign" );
         } while( require_canonical && !public_key::is_canonical( result ) );
         result.begin()[0] = 27 + 4 + recid;
+        if( attempts ) *attempts = tries;
         return result;
     }
 
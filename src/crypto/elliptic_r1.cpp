@@ -26,9 +26,14 @@ namespace fc { namespace crypto { namespace r1 {
               EC_KEY_free(_key);
             }
           }
+          // public keys are never modified once built, so copies share the EC_KEY
           public_key_impl( const public_key_impl& cpy )
+          :_key(cpy._key)
           {
-            _key = cpy._key ? EC_KEY_dup( cpy._key ) : nullptr;
+            if( _key != nullptr )
+            {
+              EC_KEY_up_ref(_key);
+            }
           }
           EC_KEY* _key;
       };
@@ -53,6 +58,70 @@ namespace fc { namespace crypto { namespace r1 {
           }
           EC_KEY* _key;
       };
+
+      // The P-256 group and the values derived from it are fixed; build them once, with the
+      // precomputed multiples of the generator, and share them between threads read-only
+      class r1_curve
+      {
+        public:
+          static const r1_curve& get()
+          {
+            static const r1_curve curve;
+            return curve;
+          }
+
+          const EC_GROUP* group()const      { return _group; }
+          const BIGNUM*   order()const      { return _order; }
+          const BIGNUM*   half_order()const { return _half_order; }
+          const BIGNUM*   field()const      { return _field; }
+          int             degree()const     { return _degree; }
+          // every point on a curve with cofactor 1 lies in the prime-order subgroup
+          bool            prime_order()const { return _prime_order; }
+
+        private:
+          r1_curve()
+          {
+            init_openssl();
+            _group.obj = EC_GROUP_new_by_curve_name( NID_X9_62_prime256v1 );
+            if( !_group ) FC_THROW_EXCEPTION( exception, "Unable to create secp256r1 group" );
+
+            bn_ctx ctx(BN_CTX_new());
+            if( !EC_GROUP_get_order(_group, _order, ctx) ||
+                !BN_rshift1(_half_order, _order) ||
+                !EC_GROUP_get_curve_GFp(_group, _field, nullptr, nullptr, ctx) ||
+                !EC_GROUP_precompute_mult(_group, ctx) )
+              FC_THROW_EXCEPTION( exception, "Unable to set up secp256r1 group" );
+            _degree = EC_GROUP_get_degree(_group);
+
+            ssl_bignum cofactor;
+            _prime_order = EC_GROUP_get_cofactor(_group, cofactor, ctx) && BN_is_one(cofactor);
+          }
+
+          ec_group    _group;
+          ssl_bignum  _order;
+          ssl_bignum  _half_order;
+          ssl_bignum  _field;
+          int         _degree = 0;
+          bool        _prime_order = false;
+      };
+
+      // scratch bignums for the calling thread; every user brackets its work in BN_CTX_start/BN_CTX_end
+      BN_CTX* thread_bn_ctx()
+      {
+        static thread_local bn_ctx ctx(BN_CTX_new());
+        return ctx;
+      }
+
+      // a key on the shared group, without looking the curve up by name
+      EC_KEY* new_r1_key( const EC_POINT* pub )
+      {
+        const auto& curve = r1_curve::get();
+        EC_KEY* key = EC_KEY_new();
+        if( key && EC_KEY_set_group(key, curve.group()) && EC_KEY_set_public_key(key, pub) )
+          return key;
+        if( key ) EC_KEY_free(key);
+        return nullptr;
+      }
     }
     static void * ecies_key_derivation(const void *input, size_t ilen, void *output, size_t *olen)
     {
@@ -66,77 +135,64 @@ namespace fc { namespace crypto { namespace r1 {
     // Perform ECDSA key recovery (see SEC1 4.1.6) for curves over (mod p)-fields
     // recid selects which key is recovered
     // if check is non-zero, additional checks are performed
-    static int ECDSA_SIG_recover_key_GFp(EC_KEY *eckey, ECDSA_SIG *ecsig, const unsigned char *msg, int msglen, int recid, int check)
+    static int ECDSA_SIG_recover_key_GFp(const BIGNUM *r, const BIGNUM *s, const unsigned char *msg, int msglen, int recid, int check, EC_POINT *Q)
     {
-        if (!eckey) FC_THROW_EXCEPTION( exception, "null key" );
+        const auto& curve = detail::r1_curve::get();
+        const EC_GROUP *group = curve.group();
+        const BIGNUM *order = curve.order();
 
-        int ret = 0;
-        BN_CTX *ctx = NULL;
+        BN_CTX *ctx = detail::thread_bn_ctx();
+        if (ctx == NULL) return -1;
 
+        int ret = 0;
         BIGNUM *x = NULL;
         BIGNUM *e = NULL;
-        BIGNUM *order = NULL;
+        BIGNUM *rr = NULL;
         BIGNUM *sor = NULL;
         BIGNUM *eor = NULL;
-        BIGNUM *field = NULL;
         EC_POINT *R = NULL;
         EC_POINT *O = NULL;
-        EC_POINT *Q = NULL;
-        BIGNUM *rr = NULL;
-        BIGNUM *zero = NULL;
-        int n = 0;
+        int n = curve.degree();
         int i = recid / 2;
 
-        const BIGNUM *r, *s;
-        ECDSA_SIG_get0(ecsig, &r, &s);
-
-        const EC_GROUP *group = EC_KEY_get0_group(eckey);
-        if ((ctx = BN_CTX_new()) == NULL) { ret = -1; goto err; }
         BN_CTX_start(ctx);
-        order = BN_CTX_get(ctx);
-        if (!EC_GROUP_get_order(group, order, ctx)) { ret = -2; goto err; }
         x = BN_CTX_get(ctx);
+        e = BN_CTX_get(ctx);
+        rr = BN_CTX_get(ctx);
+        sor = BN_CTX_get(ctx);
+        eor = BN_CTX_get(ctx);
+        if (eor == NULL) { ret = -1; goto err; }
+
         if (!BN_copy(x, order)) { ret=-1; goto err; }
         if (!BN_mul_word(x, i)) { ret=-1; goto err; }
         if (!BN_add(x, x, r)) { ret=-1; goto err; }
-        field = BN_CTX_get(ctx);
-        if (!EC_GROUP_get_curve_GFp(group, field, NULL, NULL, ctx)) { ret=-2; goto err; }
-        if (BN_cmp(x, field) >= 0) { ret=0; goto err; }
+        if (BN_cmp(x, curve.field()) >= 0) { ret=0; goto err; }
         if ((R = EC_POINT_new(group)) == NULL) { ret = -2; goto err; }
         if (!EC_POINT_set_compressed_coordinates_GFp(group, R, x, recid % 2, ctx)) { ret=0; goto err; }
-        if (check)
+        // n*R is the point at infinity for any R on a prime-order curve, P-256 included
+        if (check && !curve.prime_order())
         {
             if ((O = EC_POINT_new(group)) == NULL) { ret = -2; goto err; }
             if (!EC_POINT_mul(group, O, NULL, R, order, ctx)) { ret=-2; goto err; }
             if (!EC_POINT_is_at_infinity(group, O)) { ret = 0; goto err; }
         }
-        if ((Q = EC_POINT_new(group)) == NULL) { ret = -2; goto err; }
-        n = EC_GROUP_get_degree(group);
-        e = BN_CTX_get(ctx);
         if (!BN_bin2bn(msg, msglen, e)) { ret=-1; goto err; }
         if (8*msglen > n) BN_rshift(e, e, 8-(n & 7));
-        zero = BN_CTX_get(ctx);
-        if (!BN_zero(zero)) { ret=-1; goto err; }
-        if (!BN_mod_sub(e, zero, e, order, ctx)) { ret=-1; goto err; }
-        rr = BN_CTX_get(ctx);
+        // e = -e mod order
+        if (!BN_nnmod(e, e, order, ctx)) { ret=-1; goto err; }
+        if (!BN_is_zero(e) && !BN_sub(e, order, e)) { ret=-1; goto err; }
         if (!BN_mod_inverse(rr, r, order, ctx)) { ret=-1; goto err; }
-        sor = BN_CTX_get(ctx);
         if (!BN_mod_mul(sor, s, rr, order, ctx)) { ret=-1; goto err; }
-        eor = BN_CTX_get(ctx);
         if (!BN_mod_mul(eor, e, rr, order, ctx)) { ret=-1; goto err; }
+        // eor * G uses the generator table precomputed in r1_curve
         if (!EC_POINT_mul(group, Q, eor, R, sor, ctx)) { ret=-2; goto err; }
-        if (!EC_KEY_set_public_key(eckey, Q)) { ret=-2; goto err; }
 
         ret = 1;
 
     err:
-        if (ctx) {
-            BN_CTX_end(ctx);
-            BN_CTX_free(ctx);
-        }
+        BN_CTX_end(ctx);
         if (R != NULL) EC_POINT_free(R);
         if (O != NULL) EC_POINT_free(O);
-        if (Q != NULL) EC_POINT_free(Q);
         return ret;
     }
 
@@ -149,12 +205,9 @@ namespace fc { namespace crypto { namespace r1 {
         BN_copy(s, sig_s);
 
         //want to always use the low S value
-        const EC_GROUP* group = EC_KEY_get0_group(key);
-        ssl_bignum order, halforder;
-        EC_GROUP_get_order(group, order, nullptr);
-        BN_rshift1(halforder, order);
-        if(BN_cmp(s, halforder) > 0)
-           BN_sub(s, order, s);
+        const auto& curve = detail::r1_curve::get();
+        if(BN_cmp(s, curve.half_order()) > 0)
+           BN_sub(s, curve.order(), s);
 
         compact_signature csig;
 
@@ -166,13 +219,14 @@ namespace fc { namespace crypto { namespace r1 {
         ECDSA_SIG_set0(sig, r, s);
 
         int nRecId = -1;
-        for (int i=0; i<4; i++)
+        ec_point Q(EC_POINT_new(curve.group()));
+        for (int i=0; Q && i<4; i++)
         {
-          public_key keyRec;
-          keyRec.my->_key = EC_KEY_new_by_curve_name( NID_X9_62_prime256v1 );
-          if (ECDSA_SIG_recover_key_GFp(keyRec.my->_key, sig, (unsigned char*)&d, sizeof(d), i, 1) == 1)
+          if (ECDSA_SIG_recover_key_GFp(r, s, (unsigned char*)&d, sizeof(d), i, 1, Q) == 1)
           {
-            if (keyRec.serialize() == pub_data )
+            public_key_data rec;
+            if (EC_POINT_point2oct(curve.group(), Q, POINT_CONVERSION_COMPRESSED, (unsigned char*)rec.data, sizeof(rec), detail::thread_bn_ctx()) == sizeof(rec) &&
+                rec == pub_data)
             {
               nRecId = i;
               break;
@@ -446,11 +500,9 @@ namespace fc { namespace crypto { namespace r1 {
     {
       public_key_data dat;
       if( !my->_key ) return dat;
-      EC_KEY_set_conv_form( my->_key, POINT_CONVERSION_COMPRESSED );
-      /*size_t nbytes = i2o_ECPublicKey( my->_key, nullptr ); */
-      /*FC_ASSERT( nbytes == 33 )*/
-      char* front = &dat.data[0];
-      i2o_ECPublicKey( my->_key, (unsigned char**)&front  );
+      // the EC_KEY may be shared with copies on other threads, so its conversion form is left alone
+      EC_POINT_point2oct( EC_KEY_get0_group( my->_key ), EC_KEY_get0_public_key( my->_key ), POINT_CONVERSION_COMPRESSED,
+                          (unsigned char*)dat.data, sizeof(dat), detail::thread_bn_ctx() );
       return dat;
       /*
        EC_POINT* pub   = EC_KEY_get0_public_key( my->_key );
@@ -462,9 +514,8 @@ namespace fc { namespace crypto { namespace r1 {
     {
       public_key_point_data dat;
       if( !my->_key ) return dat;
-      EC_KEY_set_conv_form( my->_key, POINT_CONVERSION_UNCOMPRESSED );
-      char* front = &dat.data[0];
-      i2o_ECPublicKey( my->_key, (unsigned char**)&front  );
+      EC_POINT_point2oct( EC_KEY_get0_group( my->_key ), EC_KEY_get0_public_key( my->_key ), POINT_CONVERSION_UNCOMPRESSED,
+                          (unsigned char*)dat.data, sizeof(dat), detail::thread_bn_ctx() );
       return dat;
     }
 
@@ -535,44 +586,46 @@ namespace fc { namespace crypto { namespace r1 {
         if (nV<27 || nV>=35)
             FC_THROW_EXCEPTION( exception, "unable to reconstruct public key from signature" );
 
-        ecdsa_sig sig = ECDSA_SIG_new();
-        BIGNUM *r = BN_new(), *s = BN_new();
+        const auto& curve = detail::r1_curve::get();
+        ssl_bignum r, s;
         BN_bin2bn(&c.data[1],32,r);
         BN_bin2bn(&c.data[33],32,s);
-        ECDSA_SIG_set0(sig, r, s);
 
-        my->_key = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
-
-        const EC_GROUP* group = EC_KEY_get0_group(my->_key);
-        ssl_bignum order, halforder;
-        EC_GROUP_get_order(group, order, nullptr);
-        BN_rshift1(halforder, order);
-        if(BN_cmp(s, halforder) > 0)
+        if(BN_cmp(s, curve.half_order()) > 0)
            FC_THROW_EXCEPTION( exception, "invalid high s-value encountered in r1 signature" );
 
         if (nV >= 31)
         {
-            EC_KEY_set_conv_form( my->_key, POINT_CONVERSION_COMPRESSED );
             nV -= 4;
 //            fprintf( stderr, "compressed\n" );
         }
 
-        if (ECDSA_SIG_recover_key_GFp(my->_key, sig, (unsigned char*)&digest, sizeof(digest), nV - 27, 0) == 1)
-            return;
+        ec_point Q(EC_POINT_new(curve.group()));
+        if (Q && ECDSA_SIG_recover_key_GFp(r, s, (unsigned char*)&digest, sizeof(digest), nV - 27, 0, Q) == 1)
+        {
+            my->_key = detail::new_r1_key(Q);
+            if (my->_key)
+                return;
+        }
         FC_THROW_EXCEPTION( exception, "unable to reconstruct public key from signature" );
     }
 
     compact_signature private_key::sign_compact( const fc::sha256& digest )const
+    {
+      FC_ASSERT( my->_key != nullptr );
+      return sign_compact( digest, get_public_key().serialize() );
+    }
+
+    compact_signature private_key::sign_compact( const fc::sha256& digest, const public_key_data& pub )const
     {
       try {
         FC_ASSERT( my->_key != nullptr );
-        auto my_pub_key = get_public_key().serialize(); // just for good measure
         ecdsa_sig sig = ECDSA_do_sign((unsigned char*)&digest, sizeof(digest), my->_key);
 
         if (sig==nullptr)
           FC_THROW_EXCEPTION( exception, "Unable to sign" );
 
-        return signature_from_ecdsa(my->_key, my_pub_key, sig, digest);
+        return signature_from_ecdsa(my->_key, pub, sig, digest);
       } FC_RETHROW_EXCEPTIONS( warn, "sign ${digest}", ("digest", digest)("private_key",*this) );
     }
 
@@ -615,11 +668,15 @@ namespace fc { namespace crypto { namespace r1 {
    }
    public_key& public_key::operator=( const public_key& pk )
    {
+     if( pk.my->_key )
+     {
+       EC_KEY_up_ref(pk.my->_key);
+     }
      if( my->_key )
      {
        EC_KEY_free(my->_key);
      }
-     my->_key = EC_KEY_dup(pk.my->_key);
+     my->_key = pk.my->_key;
      return *this;
    }
    private_key& private_key::operator=( const private_key& pk )
@@ -1,8 +1,108 @@
 #include <fc/crypto/hex.hpp>
 #include <fc/exception/exception.hpp>
 
+#include <algorithm>
+
+#if defined(__x86_64__) && ( defined(__GNUC__) || defined(__clang__) )
+#define FC_HEX_AVX2 1
+#include <immintrin.h>
+#endif
+
 namespace fc {
 
+    namespace {
+      constexpr const char* hex_digits = "0123456789abcdef";
+
+      // built at compile time, so hashes parsed by other static initializers can use it
+      struct hex_values {
+        int8_t value[256];
+
+        constexpr hex_values() : value{} {
+          for( int i = 0; i < 256; ++i ) value[i] = -1;
+          for( int i = 0; i < 10; ++i ) value['0' + i] = i;
+          for( int i = 0; i < 6; ++i ) value['a' + i] = value['A' + i] = 10 + i;
+        }
+      };
+      constexpr hex_values nibble_values;
+
+      inline uint8_t nibble( char c ) {
+        const int8_t v = nibble_values.value[uint8_t( c )];
+        if( v < 0 ) return from_hex( c ); // throws
+        return v;
+      }
+
+      inline void encode_scalar( const uint8_t* in, size_t size, char* out ) {
+        for( size_t i = 0; i < size; ++i ) {
+          out[2*i]   = hex_digits[in[i] >> 4];
+          out[2*i+1] = hex_digits[in[i] & 0x0f];
+        }
+      }
+
+      inline void decode_scalar( const char* in, size_t bytes, uint8_t* out ) {
+        for( size_t i = 0; i < bytes; ++i )
+          out[i] = nibble( in[2*i] ) << 4 | nibble( in[2*i+1] );
+      }
+
+#ifdef FC_HEX_AVX2
+      bool cpu_has_avx2() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports( "avx2" );
+      }
+      const bool has_avx2 = cpu_has_avx2();
+
+      // 32 bytes -> 64 chars per step; returns how many bytes were done
+      __attribute__((target("avx2")))
+      size_t encode_avx2( const uint8_t* in, size_t size, char* out ) {
+        const __m256i digits = _mm256_setr_epi8( '0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f',
+                                                 '0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f' );
+        const __m256i low_nibble = _mm256_set1_epi8( 0x0f );
+        size_t i = 0;
+        for( ; i + 32 <= size; i += 32 ) {
+          const __m256i bytes = _mm256_loadu_si256( (const __m256i*)( in + i ) );
+          const __m256i hi = _mm256_shuffle_epi8( digits, _mm256_and_si256( _mm256_srli_epi16( bytes, 4 ), low_nibble ) );
+          const __m256i lo = _mm256_shuffle_epi8( digits, _mm256_and_si256( bytes, low_nibble ) );
+          // unpacking works within 128-bit lanes, the permutes put the halves back in order
+          const __m256i first = _mm256_unpacklo_epi8( hi, lo );
+          const __m256i second = _mm256_unpackhi_epi8( hi, lo );
+          _mm256_storeu_si256( (__m256i*)( out + 2*i ), _mm256_permute2x128_si256( first, second, 0x20 ) );
+          _mm256_storeu_si256( (__m256i*)( out + 2*i + 32 ), _mm256_permute2x128_si256( first, second, 0x31 ) );
+        }
+        return i;
+      }
+
+      __attribute__((target("avx2")))
+      inline __m256i nibbles_avx2( __m256i chars, __m256i& valid ) {
+        const __m256i digit = _mm256_sub_epi8( chars, _mm256_set1_epi8( '0' ) );
+        const __m256i letter = _mm256_sub_epi8( _mm256_or_si256( chars, _mm256_set1_epi8( 0x20 ) ), _mm256_set1_epi8( 'a' ) );
+        const __m256i minus_one = _mm256_set1_epi8( -1 );
+        const __m256i is_digit = _mm256_and_si256( _mm256_cmpgt_epi8( digit, minus_one ),
+                                                   _mm256_cmpgt_epi8( _mm256_set1_epi8( 10 ), digit ) );
+        const __m256i is_letter = _mm256_and_si256( _mm256_cmpgt_epi8( letter, minus_one ),
+                                                    _mm256_cmpgt_epi8( _mm256_set1_epi8( 6 ), letter ) );
+        valid = _mm256_and_si256( valid, _mm256_or_si256( is_digit, is_letter ) );
+        return _mm256_blendv_epi8( _mm256_add_epi8( letter, _mm256_set1_epi8( 10 ) ), digit, is_digit );
+      }
+
+      // 64 chars -> 32 bytes per step; stops early at a chunk with a non-hex char and returns how many bytes were done
+      __attribute__((target("avx2")))
+      size_t decode_avx2( const char* in, size_t bytes, uint8_t* out ) {
+        const __m256i high_low = _mm256_set1_epi16( 0x0110 );
+        size_t i = 0;
+        for( ; i + 32 <= bytes; i += 32 ) {
+          __m256i valid = _mm256_set1_epi8( -1 );
+          const __m256i a = nibbles_avx2( _mm256_loadu_si256( (const __m256i*)( in + 2*i ) ), valid );
+          const __m256i b = nibbles_avx2( _mm256_loadu_si256( (const __m256i*)( in + 2*i + 32 ) ), valid );
+          if( _mm256_movemask_epi8( valid ) != -1 ) break;
+
+          // each pair of nibbles to a 16-bit hi * 16 + lo, then narrowed back to bytes
+          const __m256i packed = _mm256_packus_epi16( _mm256_maddubs_epi16( a, high_low ), _mm256_maddubs_epi16( b, high_low ) );
+          _mm256_storeu_si256( (__m256i*)( out + i ), _mm256_permute4x64_epi64( packed, 0xd8 ) );
+        }
+        return i;
+      }
+#endif
+    }
+
     uint8_t from_hex( char c ) {
       if( c >= '0' && c <= '9' )
         return c - '0';
@@ -14,33 +114,44 @@ namespace fc {
       return 0;
     }
 
-    std::string to_hex( const char* d, uint32_t s ) 
+    size_t to_hex( const char* d, size_t s, char* out )
     {
-        std::string r;
-        r.reserve(s * 2);
-        const static char* to_hex="0123456789abcdef";
-        uint8_t* c = (uint8_t*)d;
-        for( uint32_t i = 0; i < s; ++i ) {
-            r += to_hex[(c[i]>>4)];
-            r += to_hex[(c[i] &0x0f)];
-        }
+        auto in = (const uint8_t*)d;
+        size_t done = 0;
+#ifdef FC_HEX_AVX2
+        if( s >= 32 && has_avx2 ) done = encode_avx2( in, s, out );
+#endif
+        encode_scalar( in + done, s - done, out + 2 * done );
+        return 2 * s;
+    }
+
+    std::string to_hex( const char* d, uint32_t s )
+    {
+        std::string r( 2 * size_t(s), '\0' );
+        to_hex( d, s, &r[0] );
         return r;
     }
 
-    size_t from_hex( const fc::string& hex_str, char* out_data, size_t out_data_len ) {
-        fc::string::const_iterator i = hex_str.begin();
-        uint8_t* out_pos = (uint8_t*)out_data;
-        uint8_t* out_end = out_pos + out_data_len;
-        while( i != hex_str.end() && out_end != out_pos ) {
-          *out_pos = from_hex( *i ) << 4;   
-          ++i;
-          if( i != hex_str.end() )  {
-              *out_pos |= from_hex( *i );
-              ++i;
-          }
-          ++out_pos;
+    size_t from_hex( const char* hex, size_t hex_len, char* out_data, size_t out_data_len ) {
+        auto out = (uint8_t*)out_data;
+        const size_t whole = std::min( hex_len / 2, out_data_len );
+        size_t done = 0;
+#ifdef FC_HEX_AVX2
+        if( whole >= 32 && has_avx2 ) done = decode_avx2( hex, whole, out );
+#endif
+        // also the chunk the vector loop stopped at, which throws on its bad character
+        decode_scalar( hex + 2 * done, whole - done, out + done );
+
+        // a trailing odd character fills the high half of one more byte
+        if( whole < out_data_len && hex_len % 2 ) {
+          out[whole] = nibble( hex[hex_len - 1] ) << 4;
+          return whole + 1;
         }
-        return out_pos - (uint8_t*)out_data;
+        return whole;
+    }
+
+    size_t from_hex( const fc::string& hex_str, char* out_data, size_t out_data_len ) {
+        return from_hex( hex_str.data(), hex_str.size(), out_data, out_data_len );
     }
     std::string to_hex( const std::vector<char>& data )
     {
@@ -0,0 +1,162 @@
+#include <fc/crypto/merkle_tree.hpp>
+#include <fc/exception/exception.hpp>
+
+#include "_worker_pool.hpp"
+
+namespace fc {
+
+   namespace {
+      // below this many parents a level is cheaper to hash than to hand out to the workers
+      const size_t parallel_threshold = 4096;
+      const size_t parents_per_job = 1024;
+
+      sha256 hash_pair( const sha256& left, const sha256& right ) {
+         sha256 pair[2] = { left, right };
+         return sha256::hash( pair[0].data(), sizeof( pair ) );
+      }
+
+      struct level_job {
+         const std::vector<sha256>&  children;
+         std::vector<sha256>&        parents;
+         size_t                      first;
+         size_t                      end;
+
+         // parents [first + job * parents_per_job, ...) out of whole child pairs
+         void hash( size_t begin, size_t stop ) {
+            static_assert( sizeof( sha256 ) == 32, "child pairs are hashed straight out of the level" );
+            sha256::input inputs[64];
+            while( begin < stop ) {
+               const size_t n = std::min<size_t>( 64, stop - begin );
+               for( size_t i = 0; i < n; ++i )
+                  inputs[i] = sha256::input{ children[2 * ( begin + i )].data(), 2 * sizeof( sha256 ) };
+               sha256::hash_many( inputs, n, &parents[begin] );
+               begin += n;
+            }
+         }
+
+         static void apply( void* context, size_t job ) {
+            auto& self = *static_cast<level_job*>( context );
+            const size_t begin = self.first + job * parents_per_job;
+            self.hash( begin, std::min( begin + parents_per_job, self.end ) );
+         }
+      };
+   }
+
+   class merkle_tree::impl
+   {
+      public:
+         explicit impl( uint32_t threads )
+         {
+            if( threads != 1 ) _pool.reset( new detail::worker_pool( threads ) );
+            _levels.emplace_back();
+         }
+
+         // rehashes everything above leaves [first, size)
+         void update( size_t first )
+         {
+            for( size_t k = 0; _levels[k].size() > 1; ++k ) {
+               if( _levels.size() == k + 1 ) _levels.emplace_back();
+               const auto& children = _levels[k];
+               auto& parents = _levels[k + 1];
+
+               first /= 2;
+               parents.resize( ( children.size() + 1 ) / 2 );
+               const size_t whole = children.size() / 2;
+               if( first < whole ) hash_level( children, parents, first, whole );
+               if( whole < parents.size() ) parents[whole] = hash_pair( children.back(), children.back() );
+            }
+         }
+
+         void hash_level( const std::vector<sha256>& children, std::vector<sha256>& parents, size_t first, size_t end )
+         {
+            level_job job{ children, parents, first, end };
+            if( !_pool || _pool->threads() == 1 || end - first < parallel_threshold ) {
+               job.hash( first, end );
+               return;
+            }
+            _pool->run( ( end - first + parents_per_job - 1 ) / parents_per_job, &level_job::apply, &job );
+         }
+
+         // leaves first, the root level last
+         std::vector<std::vector<sha256>>     _levels;
+         std::unique_ptr<detail::worker_pool> _pool;
+   };
+
+   merkle_tree::merkle_tree( uint32_t threads )
+   :my( new impl( threads ) )
+   {
+   }
+
+   merkle_tree::merkle_tree( const std::vector<sha256>& leaves, uint32_t threads )
+   :my( new impl( threads ) )
+   {
+      append( leaves );
+   }
+
+   merkle_tree::~merkle_tree() = default;
+   merkle_tree::merkle_tree( merkle_tree&& ) = default;
+   merkle_tree& merkle_tree::operator = ( merkle_tree&& ) = default;
+
+   void merkle_tree::append( const sha256& leaf )
+   {
+      append( &leaf, 1 );
+   }
+
+   void merkle_tree::append( const sha256* leaves, size_t count )
+   {
+      if( !count ) return;
+      auto& bottom = my->_levels.front();
+      const size_t first = bottom.size();
+      bottom.insert( bottom.end(), leaves, leaves + count );
+      my->update( first );
+   }
+
+   void merkle_tree::append( const std::vector<sha256>& leaves )
+   {
+      append( leaves.data(), leaves.size() );
+   }
+
+   size_t merkle_tree::size()const
+   {
+      return my->_levels.front().size();
+   }
+
+   const sha256& merkle_tree::leaf( size_t index )const
+   {
+      FC_ASSERT( index < size(), "leaf ${i} of a tree with ${n} leaves", ("i", index)("n", size()) );
+      return my->_levels.front()[index];
+   }
+
+   sha256 merkle_tree::root()const
+   {
+      const auto& top = my->_levels.back();
+      return top.empty() ? sha256() : top.front();
+   }
+
+   merkle_tree::proof merkle_tree::prove( size_t index )const
+   {
+      FC_ASSERT( index < size(), "leaf ${i} of a tree with ${n} leaves", ("i", index)("n", size()) );
+      proof p;
+      p.index = index;
+      for( size_t k = 0; k + 1 < my->_levels.size(); ++k, index /= 2 ) {
+         const auto& level = my->_levels[k];
+         const size_t sibling = index ^ 1;
+         p.path.push_back( sibling < level.size() ? level[sibling] : level[index] );
+      }
+      return p;
+   }
+
+   bool merkle_tree::verify( const sha256& leaf, const proof& p, const sha256& root )
+   {
+      if( p.path.size() < 64 && ( p.index >> p.path.size() ) != 0 ) return false;
+
+      sha256 node = leaf;
+      uint64_t index = p.index;
+      for( const auto& sibling : p.path ) {
+         node = ( index & 1 ) ? hash_pair( sibling, node ) : hash_pair( node, sibling );
+         index >>= 1;
+      }
+      return node == root;
+   }
+
+} // namespace fc
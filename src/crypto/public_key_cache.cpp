@@ -0,0 +1,187 @@
+#include <fc/crypto/public_key_cache.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace fc { namespace crypto {
+
+   namespace {
+      struct cache_key {
+         signature   sig;
+         sha256      digest;
+         size_t      hash;
+
+         bool operator == ( const cache_key& other )const {
+            return hash == other.hash && digest == other.digest && sig == other.sig;
+         }
+      };
+
+      size_t hash_of( const signature& sig, const sha256& digest ) {
+         // both halves are effectively random; mix them so neither decides the shard on its own
+         uint64_t h = std::hash<signature>()( sig ) ^ ( std::hash<sha256>()( digest ) * 0x9e3779b97f4a7c15ull );
+         h ^= h >> 29;
+         h *= 0xbf58476d1ce4e5b9ull;
+         h ^= h >> 32;
+         return h;
+      }
+
+      struct entry {
+         cache_key   key;
+         public_key  value;
+         // recovered with the canonical check, so it also answers lookups which don't ask for it
+         bool        canonical;
+      };
+
+      struct key_ref_hash {
+         size_t operator()( const std::reference_wrapper<const cache_key>& k )const { return k.get().hash; }
+      };
+
+      struct key_ref_equal {
+         bool operator()( const std::reference_wrapper<const cache_key>& a, const std::reference_wrapper<const cache_key>& b )const {
+            return a.get() == b.get();
+         }
+      };
+
+      class shard {
+         public:
+            optional<public_key> find( const cache_key& key, bool check_canonical ) {
+               std::lock_guard<std::mutex> lock( _mutex );
+               auto itr = _index.find( std::cref( key ) );
+               if( itr == _index.end() || ( check_canonical && !itr->second->canonical ) ) {
+                  _misses.fetch_add( 1, std::memory_order_relaxed );
+                  return {};
+               }
+               _entries.splice( _entries.begin(), _entries, itr->second );
+               _hits.fetch_add( 1, std::memory_order_relaxed );
+               return itr->second->value;
+            }
+
+            void insert( cache_key&& key, const public_key& value, bool canonical, size_t capacity ) {
+               std::lock_guard<std::mutex> lock( _mutex );
+               auto itr = _index.find( std::cref( key ) );
+               if( itr != _index.end() ) {
+                  itr->second->canonical |= canonical;
+                  _entries.splice( _entries.begin(), _entries, itr->second );
+                  return;
+               }
+
+               if( _entries.size() >= capacity ) {
+                  _index.erase( std::cref( _entries.back().key ) );
+                  _entries.pop_back();
+                  _evictions.fetch_add( 1, std::memory_order_relaxed );
+               }
+               _entries.push_front( entry{ std::move( key ), value, canonical } );
+               _index.emplace( std::cref( _entries.front().key ), _entries.begin() );
+            }
+
+            void clear() {
+               std::lock_guard<std::mutex> lock( _mutex );
+               _index.clear();
+               _entries.clear();
+            }
+
+            void add_stats( public_key_cache::stats& s ) {
+               std::lock_guard<std::mutex> lock( _mutex );
+               s.hits += _hits.load( std::memory_order_relaxed );
+               s.misses += _misses.load( std::memory_order_relaxed );
+               s.evictions += _evictions.load( std::memory_order_relaxed );
+               s.size += _entries.size();
+            }
+
+         private:
+            std::mutex _mutex;
+            // most recently used first
+            std::list<entry> _entries;
+            std::unordered_map<std::reference_wrapper<const cache_key>, std::list<entry>::iterator,
+                               key_ref_hash, key_ref_equal> _index;
+
+            std::atomic<uint64_t> _hits{ 0 };
+            std::atomic<uint64_t> _misses{ 0 };
+            std::atomic<uint64_t> _evictions{ 0 };
+      };
+   }
+
+   class public_key_cache::impl
+   {
+      public:
+         impl( size_t capacity, uint32_t shards )
+         :_capacity( capacity )
+         ,_shards( shard_count( capacity, shards ) )
+         ,_shard_capacity( ( capacity + _shards.size() - 1 ) / _shards.size() )
+         {
+         }
+
+         static size_t shard_count( size_t capacity, uint32_t shards ) {
+            FC_ASSERT( capacity > 0, "cache capacity must be positive" );
+            size_t count = 1;
+            while( count < shards && count < capacity ) count <<= 1;
+            return count;
+         }
+
+         shard& shard_of( size_t hash ) {
+            // the low bits pick the bucket inside the shard's map
+            return _shards[ ( hash >> ( sizeof( size_t ) * 4 ) ) & ( _shards.size() - 1 ) ];
+         }
+
+         size_t               _capacity;
+         std::vector<shard>   _shards;
+         size_t               _shard_capacity;
+   };
+
+   public_key_cache::public_key_cache( size_t capacity, uint32_t shards )
+   :my( new impl( capacity, shards ) )
+   {
+   }
+
+   public_key_cache::~public_key_cache() = default;
+
+   public_key public_key_cache::recover( const signature& sig, const sha256& digest, bool check_canonical )
+   {
+      const auto hash = hash_of( sig, digest );
+      auto& s = my->shard_of( hash );
+      auto cached = s.find( cache_key{ sig, digest, hash }, check_canonical );
+      if( cached ) return std::move( *cached );
+
+      // recovered outside the shard lock; a racing thread may do the same work, the result is identical
+      public_key key( sig, digest, check_canonical );
+      s.insert( cache_key{ sig, digest, hash }, key, check_canonical, my->_shard_capacity );
+      return key;
+   }
+
+   optional<public_key> public_key_cache::find( const signature& sig, const sha256& digest, bool check_canonical )
+   {
+      const auto hash = hash_of( sig, digest );
+      return my->shard_of( hash ).find( cache_key{ sig, digest, hash }, check_canonical );
+   }
+
+   void public_key_cache::insert( const signature& sig, const sha256& digest, const public_key& key, bool check_canonical )
+   {
+      const auto hash = hash_of( sig, digest );
+      my->shard_of( hash ).insert( cache_key{ sig, digest, hash }, key, check_canonical, my->_shard_capacity );
+   }
+
+   void public_key_cache::clear()
+   {
+      for( auto& s : my->_shards )
+         s.clear();
+   }
+
+   size_t public_key_cache::capacity()const
+   {
+      return my->_capacity;
+   }
+
+   public_key_cache::stats public_key_cache::get_stats()const
+   {
+      stats res;
+      for( auto& s : my->_shards )
+         s.add_stats( res );
+      return res;
+   }
+
+} } // fc::crypto
@@ -0,0 +1,457 @@
+#include <fc/crypto/sha256.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) && ( defined(__GNUC__) || defined(__clang__) )
+#define FC_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace fc {
+
+   namespace {
+      alignas(64) const uint32_t k256[64] = {
+         0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+         0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+         0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+         0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+         0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+         0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+         0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+         0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+      };
+
+      const uint32_t initial_state[8] = {
+         0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+      };
+
+      /**
+       * The last one or two blocks of a message: what's left after its whole blocks, the 0x80
+       * terminator and the big-endian bit length.
+       */
+      struct padded_tail {
+         unsigned char  data[128];
+         uint32_t       blocks;
+
+         padded_tail() = default;
+         padded_tail( const char* message, size_t size ) { assign( message, size ); }
+
+         void assign( const char* message, size_t size ) {
+            const size_t rest = size % 64;
+            blocks = rest + 9 <= 64 ? 1 : 2;
+            memset( data, 0, sizeof(data) );
+            memcpy( data, message + size - rest, rest );
+            data[rest] = 0x80;
+            uint64_t bits = uint64_t(size) * 8;
+            for( int i = 0; i < 8; ++i )
+               data[blocks * 64 - 1 - i] = uint8_t( bits >> ( 8 * i ) );
+         }
+      };
+
+      void store_state( const uint32_t state[8], sha256& out ) {
+         auto* bytes = reinterpret_cast<unsigned char*>( out.data() );
+         for( int i = 0; i < 8; ++i ) {
+            bytes[4*i]   = uint8_t( state[i] >> 24 );
+            bytes[4*i+1] = uint8_t( state[i] >> 16 );
+            bytes[4*i+2] = uint8_t( state[i] >> 8 );
+            bytes[4*i+3] = uint8_t( state[i] );
+         }
+      }
+
+      void hash_many_scalar( const sha256::input* messages, size_t count, sha256* out ) {
+         // the one-shot SHA256() goes through EVP on OpenSSL 3, which costs more than a short message
+         SHA256_CTX ctx;
+         for( size_t i = 0; i < count; ++i ) {
+            SHA256_Init( &ctx );
+            SHA256_Update( &ctx, messages[i].data, messages[i].size );
+            SHA256_Final( reinterpret_cast<unsigned char*>( out[i].data() ), &ctx );
+         }
+      }
+
+#ifdef FC_SHA256_X86
+      bool cpu_has_shani() {
+         unsigned eax, ebx, ecx, edx;
+         if( !__get_cpuid( 1, &eax, &ebx, &ecx, &edx ) || !( ecx & bit_SSE4_1 ) || !( ecx & bit_SSSE3 ) )
+            return false;
+         if( !__get_cpuid_count( 7, 0, &eax, &ebx, &ecx, &edx ) )
+            return false;
+         return ebx & ( 1u << 29 );
+      }
+
+      bool cpu_has_avx2() {
+         __builtin_cpu_init();
+         return __builtin_cpu_supports( "avx2" );
+      }
+
+      /** A message as its runs of blocks: the whole blocks in place, then the padded tail */
+      struct block_runs {
+         const unsigned char* data[2];
+         size_t               blocks[2];
+         padded_tail          tail;
+
+         explicit block_runs( const sha256::input& m )
+         :tail( m.data, m.size )
+         {
+            data[0] = reinterpret_cast<const unsigned char*>( m.data );
+            blocks[0] = m.size / 64;
+            data[1] = tail.data;
+            blocks[1] = tail.blocks;
+         }
+      };
+
+      // the SHA instructions keep the state as ABEF / CDGH
+      __attribute__((target("sha,sse4.1")))
+      inline void load_shani_state( const uint32_t state[8], __m128i& abef, __m128i& cdgh ) {
+         const __m128i dcba = _mm_shuffle_epi32( _mm_loadu_si128( (const __m128i*)&state[0] ), 0xb1 );
+         const __m128i efgh = _mm_shuffle_epi32( _mm_loadu_si128( (const __m128i*)&state[4] ), 0x1b );
+         abef = _mm_alignr_epi8( dcba, efgh, 8 );
+         cdgh = _mm_blend_epi16( efgh, dcba, 0xf0 );
+      }
+
+      __attribute__((target("sha,sse4.1")))
+      inline void store_shani_state( __m128i abef, __m128i cdgh, uint32_t state[8] ) {
+         const __m128i feba = _mm_shuffle_epi32( abef, 0x1b );
+         const __m128i dchg = _mm_shuffle_epi32( cdgh, 0xb1 );
+         _mm_storeu_si128( (__m128i*)&state[0], _mm_blend_epi16( feba, dchg, 0xf0 ) );
+         _mm_storeu_si128( (__m128i*)&state[4], _mm_alignr_epi8( dchg, feba, 8 ) );
+      }
+
+      /**
+       * Compresses @p blocks blocks into each of the @p Streams states. Every round depends on the
+       * previous one, so a single stream leaves the SHA unit idle most of the time; interleaving
+       * independent messages fills those gaps.
+       */
+      template<int Streams>
+      __attribute__((target("sha,sse4.1")))
+      void compress_shani( uint32_t* const* states, const unsigned char* const* data, size_t blocks ) {
+         const __m128i byte_swap = _mm_set_epi64x( 0x0c0d0e0f08090a0bull, 0x0405060700010203ull );
+
+         __m128i state0[Streams], state1[Streams];
+         for( int j = 0; j < Streams; ++j )
+            load_shani_state( states[j], state0[j], state1[j] );
+
+         for( size_t b = 0; b < blocks; ++b ) {
+            __m128i abef[Streams], cdgh[Streams], w[Streams][4];
+            for( int j = 0; j < Streams; ++j ) {
+               abef[j] = state0[j];
+               cdgh[j] = state1[j];
+            }
+
+#pragma GCC unroll 16
+            for( int i = 0; i < 16; ++i ) {
+               const __m128i k = _mm_load_si128( (const __m128i*)&k256[4 * i] );
+               for( int j = 0; j < Streams; ++j ) {
+                  __m128i m;
+                  if( i < 4 ) {
+                     m = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)( data[j] + 64 * b + 16 * i ) ), byte_swap );
+                  } else {
+                     m = _mm_sha256msg1_epu32( w[j][i & 3], w[j][(i + 1) & 3] );
+                     m = _mm_add_epi32( m, _mm_alignr_epi8( w[j][(i + 3) & 3], w[j][(i + 2) & 3], 4 ) );
+                     m = _mm_sha256msg2_epu32( m, w[j][(i + 3) & 3] );
+                  }
+                  w[j][i & 3] = m;
+
+                  __m128i wk = _mm_add_epi32( m, k );
+                  state1[j] = _mm_sha256rnds2_epu32( state1[j], state0[j], wk );
+                  wk = _mm_shuffle_epi32( wk, 0x0e );
+                  state0[j] = _mm_sha256rnds2_epu32( state0[j], state1[j], wk );
+               }
+            }
+
+            for( int j = 0; j < Streams; ++j ) {
+               state0[j] = _mm_add_epi32( state0[j], abef[j] );
+               state1[j] = _mm_add_epi32( state1[j], cdgh[j] );
+            }
+         }
+
+         for( int j = 0; j < Streams; ++j )
+            store_shani_state( state0[j], state1[j], states[j] );
+      }
+
+      void compress_runs_shani( uint32_t state[8], const block_runs& m, int run, size_t done ) {
+         for( ; run < 2; ++run, done = 0 ) {
+            const unsigned char* data = m.data[run] + 64 * done;
+            compress_shani<1>( &state, &data, m.blocks[run] - done );
+         }
+      }
+
+      void hash_many_shani( const sha256::input* messages, size_t count, sha256* out ) {
+         size_t i = 0;
+         for( ; i + 1 < count; i += 2 ) {
+            uint32_t state[2][8];
+            memcpy( state[0], initial_state, sizeof(initial_state) );
+            memcpy( state[1], initial_state, sizeof(initial_state) );
+            uint32_t* states[2] = { state[0], state[1] };
+            block_runs m[2] = { block_runs( messages[i] ), block_runs( messages[i + 1] ) };
+
+            // walk both messages' runs together for as long as both have blocks left
+            int run[2] = { 0, 0 };
+            size_t done[2] = { 0, 0 };
+            for( ;; ) {
+               for( int j = 0; j < 2; ++j )
+                  while( run[j] < 2 && done[j] == m[j].blocks[run[j]] ) { ++run[j]; done[j] = 0; }
+               if( run[0] == 2 || run[1] == 2 ) break;
+
+               const size_t n = std::min( m[0].blocks[run[0]] - done[0], m[1].blocks[run[1]] - done[1] );
+               const unsigned char* data[2] = { m[0].data[run[0]] + 64 * done[0], m[1].data[run[1]] + 64 * done[1] };
+               compress_shani<2>( states, data, n );
+               done[0] += n;
+               done[1] += n;
+            }
+            for( int j = 0; j < 2; ++j ) {
+               compress_runs_shani( state[j], m[j], run[j], done[j] );
+               store_state( state[j], out[i + j] );
+            }
+         }
+         if( i < count ) {
+            uint32_t state[8];
+            memcpy( state, initial_state, sizeof(initial_state) );
+            compress_runs_shani( state, block_runs( messages[i] ), 0, 0 );
+            store_state( state, out[i] );
+         }
+      }
+
+      /** Eight messages side by side, one per 32-bit lane */
+      struct avx2_lanes {
+         static const int width = 8;
+
+         const unsigned char* whole[width];
+         size_t               whole_blocks[width];
+         padded_tail*         tails[width];
+         size_t               total_blocks[width];
+
+         const unsigned char* block( int lane, size_t index )const {
+            if( index < whole_blocks[lane] ) return whole[lane] + 64 * index;
+            return tails[lane]->data + 64 * ( index - whole_blocks[lane] );
+         }
+      };
+
+#define FC_SHA256_ROTR(x, n) _mm256_or_si256( _mm256_srli_epi32( x, n ), _mm256_slli_epi32( x, 32 - n ) )
+
+      /** Words [offset/4, offset/4 + 8) of eight blocks, big-endian, as one register per word */
+      __attribute__((target("avx2")))
+      inline void load_transposed( const unsigned char* const p[8], int offset, __m256i w[8] ) {
+         const __m256i byte_swap = _mm256_set_epi64x( 0x0c0d0e0f08090a0bull, 0x0405060700010203ull,
+                                                      0x0c0d0e0f08090a0bull, 0x0405060700010203ull );
+         __m256i r[8];
+         for( int lane = 0; lane < 8; ++lane )
+            r[lane] = _mm256_shuffle_epi8( _mm256_loadu_si256( (const __m256i*)( p[lane] + offset ) ), byte_swap );
+
+         // 8x8 transpose of 32-bit words
+         __m256i t[8];
+         for( int i = 0; i < 4; ++i ) {
+            t[2*i]     = _mm256_unpacklo_epi32( r[2*i], r[2*i + 1] );
+            t[2*i + 1] = _mm256_unpackhi_epi32( r[2*i], r[2*i + 1] );
+         }
+         for( int i = 0; i < 2; ++i ) {
+            r[4*i]     = _mm256_unpacklo_epi64( t[4*i],     t[4*i + 2] );
+            r[4*i + 1] = _mm256_unpackhi_epi64( t[4*i],     t[4*i + 2] );
+            r[4*i + 2] = _mm256_unpacklo_epi64( t[4*i + 1], t[4*i + 3] );
+            r[4*i + 3] = _mm256_unpackhi_epi64( t[4*i + 1], t[4*i + 3] );
+         }
+         for( int i = 0; i < 4; ++i ) {
+            w[i]     = _mm256_permute2x128_si256( r[i], r[i + 4], 0x20 );
+            w[i + 4] = _mm256_permute2x128_si256( r[i], r[i + 4], 0x31 );
+         }
+      }
+
+      __attribute__((target("avx2")))
+      void compress_avx2( const avx2_lanes& lanes, int used, uint32_t states[][8] ) {
+         __m256i s[8];
+         for( int j = 0; j < 8; ++j )
+            s[j] = _mm256_set_epi32( states[7][j], states[6][j], states[5][j], states[4][j],
+                                     states[3][j], states[2][j], states[1][j], states[0][j] );
+
+         size_t rounds = 0;
+         for( int lane = 0; lane < used; ++lane )
+            rounds = std::max( rounds, lanes.total_blocks[lane] );
+
+         static const unsigned char idle_block[64] = {};
+         for( size_t b = 0; b < rounds; ++b ) {
+            const unsigned char* p[8];
+            alignas(32) int32_t active[8];
+            for( int lane = 0; lane < 8; ++lane ) {
+               const bool live = lane < used && b < lanes.total_blocks[lane];
+               p[lane] = live ? lanes.block( lane, b ) : idle_block;
+               active[lane] = live ? -1 : 0;
+            }
+
+            __m256i w[16];
+            load_transposed( p, 0, w );
+            load_transposed( p, 32, w + 8 );
+
+            __m256i a = s[0], b_ = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+            for( int t = 0; t < 64; ++t ) {
+               __m256i wt;
+               if( t < 16 ) {
+                  wt = w[t];
+               } else {
+                  const __m256i w15 = w[(t - 15) & 15];
+                  const __m256i w2  = w[(t - 2) & 15];
+                  const __m256i s0 = _mm256_xor_si256( _mm256_xor_si256( FC_SHA256_ROTR( w15, 7 ), FC_SHA256_ROTR( w15, 18 ) ),
+                                                       _mm256_srli_epi32( w15, 3 ) );
+                  const __m256i s1 = _mm256_xor_si256( _mm256_xor_si256( FC_SHA256_ROTR( w2, 17 ), FC_SHA256_ROTR( w2, 19 ) ),
+                                                       _mm256_srli_epi32( w2, 10 ) );
+                  wt = _mm256_add_epi32( _mm256_add_epi32( w[t & 15], s0 ), _mm256_add_epi32( w[(t - 7) & 15], s1 ) );
+                  w[t & 15] = wt;
+               }
+
+               const __m256i S1 = _mm256_xor_si256( _mm256_xor_si256( FC_SHA256_ROTR( e, 6 ), FC_SHA256_ROTR( e, 11 ) ),
+                                                    FC_SHA256_ROTR( e, 25 ) );
+               const __m256i ch = _mm256_xor_si256( _mm256_and_si256( e, f ), _mm256_andnot_si256( e, g ) );
+               const __m256i t1 = _mm256_add_epi32( _mm256_add_epi32( h, S1 ),
+                                                    _mm256_add_epi32( ch, _mm256_add_epi32( wt, _mm256_set1_epi32( k256[t] ) ) ) );
+               const __m256i S0 = _mm256_xor_si256( _mm256_xor_si256( FC_SHA256_ROTR( a, 2 ), FC_SHA256_ROTR( a, 13 ) ),
+                                                    FC_SHA256_ROTR( a, 22 ) );
+               const __m256i maj = _mm256_or_si256( _mm256_and_si256( a, b_ ), _mm256_and_si256( c, _mm256_or_si256( a, b_ ) ) );
+               h = g; g = f; f = e;
+               e = _mm256_add_epi32( d, t1 );
+               d = c; c = b_; b_ = a;
+               a = _mm256_add_epi32( t1, _mm256_add_epi32( S0, maj ) );
+            }
+
+            // lanes whose message has already ended keep their state
+            const __m256i mask = _mm256_load_si256( (const __m256i*)active );
+            const __m256i next[8] = { a, b_, c, d, e, f, g, h };
+            for( int j = 0; j < 8; ++j )
+               s[j] = _mm256_blendv_epi8( s[j], _mm256_add_epi32( s[j], next[j] ), mask );
+         }
+
+         for( int j = 0; j < 8; ++j ) {
+            alignas(32) uint32_t v[8];
+            _mm256_store_si256( (__m256i*)v, s[j] );
+            for( int lane = 0; lane < used; ++lane )
+               states[lane][j] = v[lane];
+         }
+      }
+
+#undef FC_SHA256_ROTR
+
+      void hash_many_avx2( const sha256::input* messages, size_t count, sha256* out ) {
+         for( size_t first = 0; first < count; first += avx2_lanes::width ) {
+            const int used = int( std::min<size_t>( avx2_lanes::width, count - first ) );
+            avx2_lanes lanes;
+            padded_tail tails[avx2_lanes::width];
+            uint32_t states[avx2_lanes::width][8];
+
+            for( int lane = 0; lane < used; ++lane ) {
+               const auto& m = messages[first + lane];
+               lanes.whole[lane] = reinterpret_cast<const unsigned char*>( m.data );
+               lanes.whole_blocks[lane] = m.size / 64;
+               tails[lane].assign( m.data, m.size );
+               lanes.tails[lane] = &tails[lane];
+               lanes.total_blocks[lane] = lanes.whole_blocks[lane] + lanes.tails[lane]->blocks;
+               memcpy( states[lane], initial_state, sizeof(initial_state) );
+            }
+            for( int lane = used; lane < avx2_lanes::width; ++lane )
+               memcpy( states[lane], initial_state, sizeof(initial_state) );
+
+            compress_avx2( lanes, used, states );
+
+            for( int lane = 0; lane < used; ++lane )
+               store_state( states[lane], out[first + lane] );
+         }
+      }
+#endif
+
+      bool engine_supported( sha256::engine::type e ) {
+         switch( e ) {
+            case sha256::engine::automatic:
+            case sha256::engine::scalar:
+               return true;
+#ifdef FC_SHA256_X86
+            case sha256::engine::avx2: {
+               static const bool supported = cpu_has_avx2();
+               return supported;
+            }
+            case sha256::engine::shani: {
+               static const bool supported = cpu_has_shani();
+               return supported;
+            }
+#endif
+            default:
+               return false;
+         }
+      }
+
+      sha256::engine::type fastest_engine() {
+         // a single SHA-NI stream beats eight AVX2 lanes on every CPU that has both
+         if( engine_supported( sha256::engine::shani ) ) return sha256::engine::shani;
+         if( engine_supported( sha256::engine::avx2 ) ) return sha256::engine::avx2;
+         return sha256::engine::scalar;
+      }
+
+      std::atomic<sha256::engine::type>& current_engine() {
+         static std::atomic<sha256::engine::type> engine{ fastest_engine() };
+         return engine;
+      }
+   }
+
+   void sha256::hash_many( const input* messages, size_t count, sha256* out )
+   {
+      switch( current_engine().load( std::memory_order_relaxed ) ) {
+#ifdef FC_SHA256_X86
+         case engine::shani:
+            hash_many_shani( messages, count, out );
+            return;
+         case engine::avx2:
+            // a lone message would leave seven lanes idle
+            if( count > 1 ) {
+               hash_many_avx2( messages, count, out );
+               return;
+            }
+            break;
+#endif
+         default:
+            break;
+      }
+      hash_many_scalar( messages, count, out );
+   }
+
+   std::vector<sha256> sha256::hash_many( const std::vector<input>& messages )
+   {
+      std::vector<sha256> out( messages.size() );
+      hash_many( messages.data(), messages.size(), out.data() );
+      return out;
+   }
+
+   sha256 sha256::merkle_root( std::vector<sha256> leaves )
+   {
+      static_assert( sizeof( sha256 ) == 32, "neighbouring nodes are hashed straight out of the vector" );
+      if( leaves.empty() ) return sha256();
+
+      std::vector<input> pairs;
+      std::vector<sha256> parents;
+      while( leaves.size() > 1 ) {
+         if( leaves.size() % 2 ) leaves.push_back( leaves.back() );
+
+         pairs.resize( leaves.size() / 2 );
+         for( size_t i = 0; i < pairs.size(); ++i )
+            pairs[i] = input{ leaves[2 * i].data(), 2 * sizeof( sha256 ) };
+
+         parents.resize( pairs.size() );
+         hash_many( pairs.data(), pairs.size(), parents.data() );
+         std::swap( leaves, parents );
+      }
+      return leaves.front();
+   }
+
+   bool sha256::set_hash_many_engine( engine::type e )
+   {
+      if( !engine_supported( e ) ) return false;
+      current_engine().store( e == engine::automatic ? fastest_engine() : e, std::memory_order_relaxed );
+      return true;
+   }
+
+   sha256::engine::type sha256::hash_many_engine()
+   {
+      return current_engine().load( std::memory_order_relaxed );
+   }
+
+} // namespace fc
@@ -0,0 +1,108 @@
+#include <fc/crypto/signing_key.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/optional.hpp>
+
+#include "_worker_pool.hpp"
+
+namespace fc { namespace crypto {
+
+   class signing_key::impl : public fc::detail::worker_pool
+   {
+      public:
+         impl( const private_key& key, uint32_t threads )
+         :worker_pool( threads )
+         ,_key( key )
+         {
+            key._storage.visit( prepare_visitor( *this ) );
+         }
+
+         signature sign( const sha256& digest, bool require_canonical, uint32_t* attempts )const
+         {
+            if( _k1.valid() )
+               return signature( signature::storage_type( ecc::signature_shim( _k1->sign_compact( digest, require_canonical, attempts ) ) ) );
+
+            // OpenSSL's ECDSA is randomized and P-256 signatures are never checked for canonical form
+            if( attempts ) *attempts = 1;
+            return signature( signature::storage_type( r1::signature_shim( _r1->sign_compact( digest, _r1_public ) ) ) );
+         }
+
+         struct sign_job {
+            const impl&                key;
+            const sha256*              digests;
+            bool                       require_canonical;
+            uint32_t*                  attempts;
+            std::vector<signature>&    results;
+
+            static void apply( void* context, size_t i ) {
+               auto& self = *static_cast<sign_job*>( context );
+               self.results[i] = self.key.sign( self.digests[i], self.require_canonical,
+                                                self.attempts ? self.attempts + i : nullptr );
+            }
+         };
+
+         private_key                _key;
+         // derived from the parsed key, once
+         public_key                 _public;
+
+         // the key parsed for its own curve; exactly one is set
+         optional<ecc::private_key> _k1;
+         optional<r1::private_key>  _r1;
+         r1::public_key_data        _r1_public;
+
+      private:
+         struct prepare_visitor : visitor<void> {
+            explicit prepare_visitor( impl& self ) :self( self ) {}
+
+            void operator()( const ecc::private_key_shim& key )const {
+               self._k1 = ecc::private_key::regenerate( key._data );
+               self._public = public_key( public_key::storage_type( ecc::public_key_shim( self._k1->get_public_key().serialize() ) ) );
+            }
+            void operator()( const r1::private_key_shim& key )const {
+               self._r1 = r1::private_key::regenerate( key._data );
+               self._r1_public = self._r1->get_public_key().serialize();
+               self._public = public_key( public_key::storage_type( r1::public_key_shim( self._r1_public ) ) );
+            }
+
+            impl& self;
+         };
+   };
+
+   signing_key::signing_key( const private_key& key, uint32_t threads )
+   :my( new impl( key, threads ) )
+   {
+   }
+
+   signing_key::~signing_key() = default;
+   signing_key::signing_key( signing_key&& ) = default;
+   signing_key& signing_key::operator = ( signing_key&& ) = default;
+
+   const private_key& signing_key::get_private_key()const
+   {
+      return my->_key;
+   }
+
+   const public_key& signing_key::get_public_key()const
+   {
+      return my->_public;
+   }
+
+   signature signing_key::sign( const sha256& digest, bool require_canonical, uint32_t* attempts )const
+   {
+      return my->sign( digest, require_canonical, attempts );
+   }
+
+   std::vector<signature> signing_key::sign_many( const sha256* digests, size_t count, bool require_canonical,
+                                                  uint32_t* attempts )const
+   {
+      std::vector<signature> results( count );
+      impl::sign_job job{ *my, digests, require_canonical, attempts, results };
+      my->run( count, &impl::sign_job::apply, &job );
+      return results;
+   }
+
+   std::vector<signature> signing_key::sign_many( const std::vector<sha256>& digests, bool require_canonical )const
+   {
+      return sign_many( digests.data(), digests.size(), require_canonical );
+   }
+
+} } // fc::crypto
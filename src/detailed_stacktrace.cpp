@@ -1,19 +1,150 @@
 #undef  BOOST_STACKTRACE_LINK
 #undef  BOOST_STACKTRACE_DYN_LINK
 #undef  BOOST_STACKTRACE_USE_BACKTRACE
+#ifndef FC_HAVE_LIBBACKTRACE
 #define BOOST_STACKTRACE_USE_ADDR2LINE
+#endif
 
 #include <fc/stacktrace.hpp>
 
-#include <iostream>
+#ifdef FC_HAVE_LIBBACKTRACE
+#include <backtrace.h>
+#include <dlfcn.h>
+#include <boost/core/demangle.hpp>
+
+#include <cinttypes>
+#include <cstdio>
+#endif
+
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 
 namespace fc {
+    namespace detail {
+        namespace {
+#ifdef FC_HAVE_LIBBACKTRACE
+            // libbacktrace reads the symbol and DWARF line tables of every loaded module on the
+            // first lookup and keeps them for the life of the process, so the state is never freed
+            backtrace_state* backtrace_state_() {
+                static backtrace_state* state = backtrace_create_state(nullptr, 1 /*threaded*/, nullptr, nullptr);
+                return state;
+            }
+
+            struct frame_info {
+                string function;
+                string file;
+                int line = 0;
+            };
+
+            int pcinfo_callback_(void* data, uintptr_t, const char* file, int line, const char* function) {
+                auto& info = *static_cast<frame_info*>(data);
+                if (function) info.function = boost::core::demangle(function);
+                if (file) info.file = file;
+                info.line = line;
+                // the first call describes the innermost inlined function, which is what we want
+                return 1;
+            }
+
+            void syminfo_callback_(void* data, uintptr_t, const char* symbol, uintptr_t, uintptr_t) {
+                if (symbol) static_cast<frame_info*>(data)->function = boost::core::demangle(symbol);
+            }
+
+            void error_callback_(void*, const char*, int) {
+            }
+
+            string lookup_(const void* address) {
+                auto state = backtrace_state_();
+                auto pc = reinterpret_cast<uintptr_t>(address);
+
+                frame_info info;
+                if (state) {
+                    // frames hold return addresses; step back into the call instruction for the line lookup
+                    backtrace_pcinfo(state, pc - 1, &pcinfo_callback_, &error_callback_, &info);
+                    if (info.function.empty()) {
+                        backtrace_syminfo(state, pc, &syminfo_callback_, &error_callback_, &info);
+                    }
+                }
+
+                string res;
+                if (info.function.empty()) {
+                    char buf[2 + sizeof(void*) * 2 + 1];
+                    std::snprintf(buf, sizeof(buf), "0x%" PRIxPTR, pc);
+                    res = buf;
+                } else {
+                    res = std::move(info.function);
+                }
+
+                if (!info.file.empty()) {
+                    res += " at ";
+                    res += info.file;
+                    res += ':';
+                    res += fc::to_string(int64_t(info.line));
+                } else {
+                    Dl_info dli;
+                    if (dladdr(address, &dli) && dli.dli_fname && *dli.dli_fname) {
+                        res += " in ";
+                        res += dli.dli_fname;
+                    }
+                }
+                return res;
+            }
+#else
+            string lookup_(const void* address) {
+                namespace bs = boost::stacktrace;
+                return bs::detail::to_string_using_addr2line()(address);
+            }
+#endif
+
+            // Symbolized frames are cached per address: the same few hundred call sites show up
+            // in almost every trace a process logs
+            class symbol_cache {
+            public:
+                static constexpr std::size_t max_entries = 1 << 16;
+
+                string operator()(const void* address) {
+                    {
+                        std::shared_lock<std::shared_mutex> lock(_mutex);
+                        auto itr = _entries.find(address);
+                        if (itr != _entries.end()) return itr->second;
+                    }
+
+                    auto res = lookup_(address);
+
+                    std::unique_lock<std::shared_mutex> lock(_mutex);
+                    if (_entries.size() >= max_entries) _entries.clear();
+                    _entries.emplace(address, res);
+                    return res;
+                }
+
+            private:
+                std::shared_mutex _mutex;
+                std::unordered_map<const void*, string> _entries;
+            };
+
+            symbol_cache& symbol_cache_() {
+                static symbol_cache cache;
+                return cache;
+            }
+
+            struct to_string_using_cache {
+                string operator()(const void* address) const {
+                    return symbolize(address);
+                }
+            };
+        } // namespace
+
+        string symbolize(const void* address) { try {
+            return symbol_cache_()(address);
+        } catch (...) {
+            return {};
+        } }
+    } // namespace detail
+
     string to_detail_string(const stacktrace& strace) { try {
-        namespace bs = boost::stacktrace;
-        using to_string_type = bs::detail::to_string_impl_base<bs::detail::to_string_using_addr2line>;
-        return fc::detail::to_string_impl<to_string_type>(strace);
+        return fc::detail::to_string_impl<detail::to_string_using_cache>(strace);
     } catch (...) {
         return {};
     } }
 
-} // namespace fc
\ No newline at end of file
+} // namespace fc
@@ -4,6 +4,9 @@
 #include <fc/io/json.hpp>
 #include <fc/stacktrace.hpp>
 
+#include <boost/stacktrace/safe_dump_to.hpp>
+
+#include <atomic>
 #include <iostream>
 
 namespace fc
@@ -31,16 +34,85 @@ namespace fc
    namespace detail
    {
       static bool detailed_strace_ = false;
+      static std::atomic<exception::strace_policy::type> strace_policy_{ exception::strace_policy::always };
+      static std::atomic<uint32_t> strace_sample_every_{ 100 };
 
+      /**
+       *  Shared by copies of an exception, and only modified through exception::unique_impl(),
+       *  except for the symbolized stacktrace which is filled in once on first use.
+       */
       class exception_impl
       {
          public:
+            static constexpr size_t max_frames = 48;
+
+            exception_impl() = default;
+            exception_impl( const exception_impl& c )
+            :_name(c._name), _what(c._what), _code(c._code), _elog(c._elog), _frame_count(c._frame_count),
+             _slog( std::atomic_load( &c._slog ) )
+            {
+               std::copy( c._frames, c._frames + c._frame_count, _frames );
+            }
+            exception_impl& operator=( const exception_impl& ) = delete;
+
+            /** records the return addresses of the calling thread as the strace policy says */
+            void capture_strace()
+            {
+               switch( strace_policy_.load( std::memory_order_relaxed ) ) {
+                  case exception::strace_policy::never:
+                     return;
+                  case exception::strace_policy::sampled: {
+                     static thread_local uint32_t created = 0;
+                     if( created++ % strace_sample_every_.load( std::memory_order_relaxed ) )
+                        return;
+                     break;
+                  }
+                  case exception::strace_policy::always:
+                     break;
+               }
+               // null terminated, skipping this function
+               const size_t count = boost::stacktrace::safe_dump_to( 1, _frames, sizeof(_frames) );
+               _frame_count = count ? count - 1 : 0;
+            }
+
+            fc::stacktrace strace()const
+            {
+               return fc::stacktrace::from_dump( _frames, _frame_count * sizeof(_frames[0]) );
+            }
+
+            /** the stacktrace as a string, symbolized by the first caller when copies race for it */
+            const std::string& slog()const
+            {
+               auto slog = std::atomic_load( &_slog );
+               if( !slog ) {
+                  std::shared_ptr<const std::string> symbolized;
+                  if( !_frame_count )
+                     symbolized = std::make_shared<const std::string>();
+                  else if( detailed_strace_ )
+                     symbolized = std::make_shared<const std::string>( fc::to_detail_string( strace() ) );
+                  else
+                     symbolized = std::make_shared<const std::string>( fc::to_string( strace() ) );
+                  if( std::atomic_compare_exchange_strong( &_slog, &slog, symbolized ) )
+                     slog = std::move( symbolized );
+               }
+               return *slog;
+            }
+
+            void set_slog( std::string s )
+            {
+               std::atomic_store( &_slog, std::make_shared<const std::string>( std::move(s) ) );
+            }
+
             std::string     _name;
             std::string     _what;
             int64_t         _code;
             log_messages    _elog;
-            fc::stacktrace  _strace;
-            std::string     _slog;
+            size_t          _frame_count = 0;
+            const void*     _frames[max_frames];
+
+         private:
+            /// set once, the string stays valid as long as the impl
+            mutable std::shared_ptr<const std::string> _slog;
       };
    }
 
@@ -52,15 +124,36 @@ namespace fc
       return detail::detailed_strace_;
    }
 
+   void exception::set_strace_policy( strace_policy::type policy, uint32_t sample_every ) {
+      FC_ASSERT( sample_every > 0, "sample_every must be positive" );
+      detail::strace_sample_every_ = sample_every;
+      detail::strace_policy_ = policy;
+   }
+
+   exception::strace_policy::type exception::get_strace_policy() {
+      return detail::strace_policy_;
+   }
+
+   detail::exception_impl& exception::unique_impl() {
+      // only copies of this exception may hold references, and they cannot add one concurrently
+      if( my.use_count() > 1 )
+         my = std::make_shared<detail::exception_impl>( *my );
+      else
+         // the last reads through copies released on other threads happen before the writes to come
+         std::atomic_thread_fence( std::memory_order_acquire );
+      return *my;
+   }
+
    exception::exception( log_messages&& msgs, int64_t code,
                                     const std::string& name_value,
                                     const std::string& what_value )
-   :my( new detail::exception_impl() )
+   :my( std::make_shared<detail::exception_impl>() )
    {
       my->_code = code;
       my->_what = what_value;
       my->_name = name_value;
       my->_elog = fc::move(msgs);
+      my->capture_strace();
    }
 
    exception::exception(
@@ -68,12 +161,13 @@ namespace fc
       int64_t code,
       const std::string& name_value,
       const std::string& what_value )
-   :my( new detail::exception_impl() )
+   :my( std::make_shared<detail::exception_impl>() )
    {
       my->_code = code;
       my->_what = what_value;
       my->_name = name_value;
       my->_elog = msgs;
+      my->capture_strace();
    }
 
    unhandled_exception::unhandled_exception( log_message&& m, std::exception_ptr e )
@@ -87,7 +181,7 @@ namespace fc
    }
    unhandled_exception::unhandled_exception( log_messages m )
    :exception()
-   { my->_elog = fc::move(m); }
+   { unique_impl()._elog = fc::move(m); }
 
    std::exception_ptr unhandled_exception::get_inner_exception()const { return _inner; }
 
@@ -107,26 +201,28 @@ namespace fc
    exception::exception( int64_t code,
                          const std::string& name_value,
                          const std::string& what_value )
-   :my( new detail::exception_impl() )
+   :my( std::make_shared<detail::exception_impl>() )
    {
       my->_code = code;
       my->_what = what_value;
       my->_name = name_value;
+      my->capture_strace();
    }
 
    exception::exception( log_message&& msg,
                          int64_t code,
                          const std::string& name_value,
                          const std::string& what_value )
-   :my( new detail::exception_impl() )
+   :my( std::make_shared<detail::exception_impl>() )
    {
       my->_code = code;
       my->_what = what_value;
       my->_name = name_value;
       my->_elog.push_back( fc::move( msg ) );
+      my->capture_strace();
    }
    exception::exception( const exception& c )
-   :my( new detail::exception_impl(*c.my) )
+   :my( c.my )
    { }
    exception::exception( exception&& c )
    :my( fc::move(c.my) ){}
@@ -135,14 +231,7 @@ namespace fc
    const char*  exception::what() const throw() { return my->_what.c_str();  }
    int64_t      exception::code() const throw() { return my->_code;          }
    const char*  exception::strace()const throw() {
-       if (my->_slog.empty()) {
-          if (detail::detailed_strace_) {
-             my->_slog = fc::to_detail_string(my->_strace);
-          } else {
-             my->_slog = fc::to_string(my->_strace);
-          }
-       }
-       return my->_slog.c_str();
+       return my->slog().c_str();
    }
 
    exception::~exception(){}
@@ -159,22 +248,23 @@ namespace fc
    void          from_variant( const variant& v, exception& ll )
    {
       auto obj = v.get_object();
+      auto& impl = ll.unique_impl();
       if( obj.contains( "stack" ) )
-         ll.my->_elog =  obj["stack"].as<log_messages>();
+         impl._elog =  obj["stack"].as<log_messages>();
       if( obj.contains( "code" ) )
-         ll.my->_code = obj["code"].as_int64();
+         impl._code = obj["code"].as_int64();
       if( obj.contains( "name" ) )
-         ll.my->_name = obj["name"].as_string();
+         impl._name = obj["name"].as_string();
       if( obj.contains( "message" ) )
-         ll.my->_what = obj["message"].as_string();
+         impl._what = obj["message"].as_string();
       if (obj.contains( "strace"))
-         ll.my->_slog = obj["strace"].as_string();
+         impl.set_slog( obj["strace"].as_string() );
    }
 
    const log_messages&   exception::get_log()const { return my->_elog; }
    void                  exception::append_log( log_message m )
    {
-      my->_elog.emplace_back( fc::move(m) );
+      unique_impl()._elog.emplace_back( fc::move(m) );
    }
 
    /**
@@ -207,9 +297,9 @@ namespace fc
             }
             if( itr != my->_elog.end()) ss << "\n";
          }
-         strace();
-         if (!my->_slog.empty()) {
-            ss << "\nstacktrace:\n" << my->_slog;
+         const auto& slog = my->slog();
+         if (!slog.empty()) {
+            ss << "\nstacktrace:\n" << slog;
          }
       } catch( std::bad_alloc& ) {
          throw;
@@ -236,7 +326,7 @@ namespace fc
          }
          for( auto itr = my->_elog.begin(); itr != my->_elog.end(); ++itr ) {
             try {
-               ss << fc::format_string( itr->get_format(), itr->get_data()) << "\n";
+               ss << itr->get_message() << "\n";
                //      ss << "    " << itr->get_context().to_string() <<"\n";
             } catch( std::bad_alloc& ) {
                throw;
@@ -244,9 +334,9 @@ namespace fc
                ss << "<- exception in to_string.\n";
             }
          }
-         strace();
-         if (!my->_slog.empty()) {
-            ss << "\nstacktrace:\n" << my->_slog;
+         const auto& slog = my->slog();
+         if (!slog.empty()) {
+            ss << "\nstacktrace:\n" << slog;
          }
          return ss.str();
       } catch( std::bad_alloc& ) {
@@ -264,7 +354,7 @@ namespace fc
    {
       for( auto itr = my->_elog.begin(); itr != my->_elog.end(); ++itr )
       {
-         auto s = fc::format_string( itr->get_format(), itr->get_data() );
+         auto s = itr->get_message();
          if (!s.empty()) {
             return s;
          }
@@ -320,7 +410,7 @@ namespace fc
    }
    exception& exception::operator=( const exception& copy )
    {
-      *my = *copy.my;
+      my = copy.my;
       return *this;
    }
 
@@ -1,10 +1,34 @@
 #include <fc/interprocess/file_mapping.hpp>
 #include <boost/interprocess/file_mapping.hpp>
 #include <boost/interprocess/mapped_region.hpp>
+#include <fc/exception/exception.hpp>
 #include <fc/fwd_impl.hpp>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+// not in older headers; the kernel answers EINVAL where it doesn't know them
+#if defined(__linux__) && !defined(MADV_POPULATE_READ)
+#define MADV_POPULATE_READ 22
+#define MADV_POPULATE_WRITE 23
+#endif
+
 namespace fc {
 
+  namespace {
+    boost::interprocess::map_options_t to_map_options( uint32_t flags )
+    {
+#ifdef MAP_POPULATE
+      if( flags & mapped_region::prefault_map )
+        return MAP_POPULATE;
+#endif
+      return boost::interprocess::default_map_options;
+    }
+  }
+
 
   file_mapping::file_mapping( const char* file, mode_t m ) :
     my(file, m == read_only ? boost::interprocess::read_only : boost::interprocess::read_write )
@@ -18,6 +42,24 @@ namespace fc {
     my( *fm.my, m == read_only ? boost::interprocess::read_only : boost::interprocess::read_write  ,start, size) 
   {}
 
+  mapped_region::mapped_region( const file_mapping& fm, mode_t m, uint64_t start, size_t size, uint32_t flags )
+  {
+    // more arguments than fwd forwards
+    boost::interprocess::mapped_region r( *fm.my, m == read_only ? boost::interprocess::read_only : boost::interprocess::read_write,
+                                          start, size, nullptr, to_map_options( flags ) );
+    my->swap( r );
+    if( flags & huge_pages ) {
+#ifdef MADV_HUGEPAGE
+      ::madvise( get_address(), get_size(), MADV_HUGEPAGE );
+#endif
+    }
+#ifndef MAP_POPULATE
+    if( flags & prefault_map ) prefault( m != read_only );
+#endif
+    if( flags & locked_map )
+      FC_ASSERT( lock(), "Unable to lock ${n} bytes of mapped memory", ("n", get_size()) );
+  }
+
   mapped_region::mapped_region( const file_mapping& fm, mode_t m ) :
     my( *fm.my, m == read_only ? boost::interprocess::read_only : boost::interprocess::read_write) 
   {}
@@ -34,8 +76,74 @@ namespace fc {
     my->flush(); 
   }
 
+  void mapped_region::sync()
+  {
+    my->flush( 0, 0, false );
+  }
+
   size_t mapped_region::get_size() const 
   {
     return my->get_size();
   }
+
+  bool mapped_region::advise( advice_type a )
+  {
+    return advise( a, 0, get_size() );
+  }
+
+  bool mapped_region::advise( advice_type a, size_t offset, size_t size )
+  {
+#ifdef _WIN32
+    return false;
+#else
+    FC_ASSERT( offset <= get_size() && size <= get_size() - offset, "Advice past the end of the mapped region" );
+    // madvise wants the start on a page boundary; mappings always start on one
+    const size_t skew = offset % page_size();
+    char* start = (char*)get_address() + offset - skew;
+    size += skew;
+    int advice = MADV_NORMAL;
+    switch( a ) {
+      case normal_access:     advice = MADV_NORMAL; break;
+      case sequential_access: advice = MADV_SEQUENTIAL; break;
+      case random_access:     advice = MADV_RANDOM; break;
+      case will_need:         advice = MADV_WILLNEED; break;
+      case dont_need:         advice = MADV_DONTNEED; break;
+    }
+    return size == 0 || ::madvise( start, size, advice ) == 0;
+#endif
+  }
+
+  void mapped_region::prefault( bool for_write )
+  {
+#ifdef MADV_POPULATE_READ
+    if( ::madvise( get_address(), get_size(), for_write ? MADV_POPULATE_WRITE : MADV_POPULATE_READ ) == 0 )
+      return;
+#endif
+    // a read from every page maps it, without dirtying anything
+    const volatile char* p = (const volatile char*)get_address();
+    const size_t step = page_size();
+    for( size_t offset = 0; offset < get_size(); offset += step )
+      (void)p[offset];
+  }
+
+  bool mapped_region::lock()
+  {
+#ifdef _WIN32
+    return false;
+#else
+    return ::mlock( get_address(), get_size() ) == 0;
+#endif
+  }
+
+  void mapped_region::unlock()
+  {
+#ifndef _WIN32
+    ::munlock( get_address(), get_size() );
+#endif
+  }
+
+  size_t mapped_region::page_size()
+  {
+    return boost::interprocess::mapped_region::get_page_size();
+  }
 }
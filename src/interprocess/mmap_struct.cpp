@@ -1,42 +1,84 @@
 #include <fc/interprocess/mmap_struct.hpp>
 
+#include <fc/exception/exception.hpp>
 #include <fc/filesystem.hpp>
 
 #include <string.h>
 #include <fstream>
 #include <algorithm>
 
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
+
 namespace fc
 {
    namespace detail
    {
+      namespace
+      {
+         /** The huge page size when @p file is on hugetlbfs, where mappings have to be whole huge pages; 0 elsewhere */
+         size_t huge_page_size( const fc::path& file )
+         {
+#ifdef __linux__
+            const long hugetlbfs_magic = 0x958458f6;
+            struct statfs fs;
+            const fc::path dir = fc::exists( file ) ? file : file.parent_path();
+            if( ::statfs( dir.generic_string().c_str(), &fs ) == 0 && long( fs.f_type ) == hugetlbfs_magic )
+               return fs.f_bsize;
+#endif
+            return 0;
+         }
+
+         /**
+          *  Makes @p file @p s bytes of zeros: dropping what was there and setting the size is instant,
+          *  and reserving the blocks up front means a full disk fails here and not as a SIGBUS on first touch.
+          */
+         void create_file( const fc::path& file, size_t s )
+         {
+#ifndef _WIN32
+            const int fd = ::open( file.generic_string().c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666 );
+            FC_ASSERT( fd >= 0, "Unable to create ${f}: ${e}", ("f", file)("e", strerror( errno )) );
+            int error = 0;
+            if( ::ftruncate( fd, 0 ) != 0 || ::ftruncate( fd, s ) != 0 )
+               error = errno;
+#ifdef __linux__
+            // filesystems without fallocate keep a sparse file
+            if( !error && s && ::fallocate( fd, 0, 0, s ) != 0 && errno != EOPNOTSUPP && errno != ENOSYS )
+               error = errno;
+#endif
+            ::close( fd );
+            FC_ASSERT( !error, "Unable to size ${f} to ${s} bytes: ${e}", ("f", file)("s", s)("e", strerror( error )) );
+#else
+            { std::ofstream out( file.generic_string().c_str(), std::ios::trunc ); }
+            fc::resize_file( file, s );
+#endif
+         }
+      }
+
       size_t mmap_struct_base::size()const { return _mapped_region->get_size(); }
       void mmap_struct_base::flush() 
       { 
         _mapped_region->flush();  
       }
 
-      void mmap_struct_base::open( const fc::path& file, size_t s, bool create )
+      void mmap_struct_base::open( const fc::path& file, size_t s, bool create, uint32_t flags )
       {
+         if( const size_t huge = huge_page_size( file ) )
+            s = ( s + huge - 1 ) / huge * huge;
+
          if( !fc::exists( file ) || fc::file_size(file) != s )
-         {
-            std::ofstream out( file.generic_string().c_str() );
-            char buffer[1024];
-            memset( buffer, 0, sizeof(buffer) );
-
-            size_t bytes_left = s;
-            while( bytes_left > 0 )
-            {
-               size_t to_write = std::min<size_t>(bytes_left, sizeof(buffer) );
-               out.write( buffer, to_write );
-               bytes_left -= to_write;
-            }
-         }
+            create_file( file, s );
 
          std::string filePath = file.to_native_ansi_path(); 
 
          _file_mapping.reset( new fc::file_mapping( filePath.c_str(), fc::read_write ) );
-         _mapped_region.reset( new fc::mapped_region( *_file_mapping, fc::read_write, 0, s ) );
+         _mapped_region.reset( new fc::mapped_region( *_file_mapping, fc::read_write, 0, s, flags ) );
       }
    } // namespace fc
 
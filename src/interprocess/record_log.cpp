@@ -0,0 +1,414 @@
+#include <fc/interprocess/record_log.hpp>
+#include <fc/interprocess/file_mapping.hpp>
+
+#include <fc/crypto/crc32c.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/filesystem.hpp>
+
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fc
+{
+   namespace
+   {
+      constexpr char     log_magic[4]   = { 'f', 'c', 'R', 'L' };
+      constexpr char     index_magic[4] = { 'f', 'c', 'R', 'I' };
+      constexpr uint32_t format_version = 1;
+
+      // log: magic, version, then records of size, crc32c and content
+      constexpr size_t   log_header_size = 8;
+      constexpr size_t   record_header_size = 8;
+      // index: magic, version, the number of entries as of the last flush, then an offset per record
+      constexpr size_t   index_header_size = 16;
+      constexpr size_t   index_entry_size = 8;
+
+      constexpr size_t   min_log_capacity = 1024 * 1024;
+      constexpr size_t   min_index_capacity = 64 * 1024;
+      // files grow by doubling, but not by more than this at a time
+      constexpr size_t   max_growth = 256 * 1024 * 1024;
+
+      uint32_t read32_le( const char* p )
+      {
+         auto b = (const uint8_t*)p;
+         return uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 | uint32_t(b[3]) << 24;
+      }
+
+      void write32_le( char* p, uint32_t v )
+      {
+         p[0] = char(v);
+         p[1] = char(v >> 8);
+         p[2] = char(v >> 16);
+         p[3] = char(v >> 24);
+      }
+
+      uint64_t read64_le( const char* p )
+      {
+         return uint64_t( read32_le( p ) ) | uint64_t( read32_le( p + 4 ) ) << 32;
+      }
+
+      void write64_le( char* p, uint64_t v )
+      {
+         write32_le( p, uint32_t(v) );
+         write32_le( p + 4, uint32_t(v >> 32) );
+      }
+
+      /** The checksum of a record covers its size too, so that zeros are never a valid record */
+      uint32_t record_crc( const char* record, size_t size )
+      {
+         return crc32c( record + record_header_size, size, crc32c( record, 4 ) );
+      }
+
+      size_t grown( size_t capacity, size_t needed )
+      {
+         while( capacity < needed )
+            capacity += std::min( capacity, max_growth );
+         return capacity;
+      }
+
+      /**
+       *  Sets the size of @p file, keeping what fits; on growth the new blocks are reserved, so a
+       *  full disk fails here and not as a SIGBUS on the first write to the mapping.
+       */
+      void set_file_size( const fc::path& file, size_t s )
+      {
+#ifndef _WIN32
+         const int fd = ::open( file.generic_string().c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666 );
+         FC_ASSERT( fd >= 0, "Unable to open ${f}: ${e}", ("f", file)("e", strerror( errno )) );
+         int error = 0;
+         const off_t old_size = ::lseek( fd, 0, SEEK_END );
+         if( old_size < 0 || ::ftruncate( fd, s ) != 0 )
+            error = errno;
+#ifdef __linux__
+         // filesystems without fallocate stay sparse
+         if( !error && off_t( s ) > old_size && ::fallocate( fd, 0, old_size, s - old_size ) != 0
+             && errno != EOPNOTSUPP && errno != ENOSYS )
+            error = errno;
+#endif
+         ::close( fd );
+         FC_ASSERT( !error, "Unable to size ${f} to ${s} bytes: ${e}", ("f", file)("s", s)("e", strerror( error )) );
+#else
+         if( !fc::exists( file ) )
+         {
+            std::ofstream out( file.generic_string().c_str() );
+         }
+         fc::resize_file( file, s );
+#endif
+      }
+
+      /** A file, mapped whole */
+      struct mapped_file
+      {
+         fc::path                           path;
+         std::unique_ptr<fc::file_mapping>  mapping;
+         std::unique_ptr<fc::mapped_region> region;
+         char*                              data = nullptr;
+         size_t                             capacity = 0;
+
+         void open( const fc::path& p )
+         {
+            path = p;
+            if( !fc::exists( path ) )
+               set_file_size( path, 0 );
+            capacity = fc::file_size( path );
+            if( capacity )
+               map();
+         }
+
+         /** Sets the file's size, to @p s bytes, and maps it again */
+         void resize( size_t s )
+         {
+            unmap();
+            set_file_size( path, s );
+            capacity = s;
+            if( capacity )
+               map();
+         }
+
+         void map()
+         {
+            if( !mapping )
+               mapping.reset( new fc::file_mapping( path.to_native_ansi_path().c_str(), fc::read_write ) );
+            region.reset( new fc::mapped_region( *mapping, fc::read_write, 0, capacity ) );
+            data = (char*)region->get_address();
+         }
+
+         void unmap()
+         {
+            region.reset();
+            data = nullptr;
+         }
+
+         void close()
+         {
+            unmap();
+            mapping.reset();
+            capacity = 0;
+         }
+      };
+   }
+
+   class record_log::impl
+   {
+      public:
+        mapped_file     _log;
+        mapped_file     _index;
+        uint64_t        _count = 0;
+        uint64_t        _end = log_header_size;
+        bool            _open = false;
+
+        uint64_t offset( uint64_t seq )const
+        {
+           return read64_le( _index.data + index_header_size + seq * index_entry_size );
+        }
+
+        uint64_t synced()const
+        {
+           return read64_le( _index.data + 8 );
+        }
+
+        void set_synced( uint64_t count )
+        {
+           write64_le( _index.data + 8, count );
+        }
+
+        /** The size of the content of a whole, intact record at @p pos in the log, or -1 */
+        int64_t check_record( uint64_t pos )const
+        {
+           if( pos < log_header_size || pos > _log.capacity || _log.capacity - pos < record_header_size )
+              return -1;
+           const char* record = _log.data + pos;
+           const uint32_t size = read32_le( record );
+           if( size > max_record_size || _log.capacity - pos - record_header_size < size )
+              return -1;
+           if( record_crc( record, size ) != read32_le( record + 4 ) )
+              return -1;
+           return size;
+        }
+
+        void reserve_index( uint64_t count )
+        {
+           const size_t needed = index_header_size + count * index_entry_size;
+           if( needed > _index.capacity )
+              _index.resize( grown( std::max( _index.capacity, min_index_capacity ), needed ) );
+        }
+
+        void reserve_log( uint64_t end )
+        {
+           if( end > _log.capacity )
+              _log.resize( grown( std::max( _log.capacity, min_log_capacity ), end ) );
+        }
+
+        /** Finds where the records end, trusting the index up to its last flush and checking the rest */
+        void recover()
+        {
+           uint64_t count = 0;
+           if( _index.capacity >= index_header_size && memcmp( _index.data, index_magic, 4 ) == 0
+               && read32_le( _index.data + 4 ) == format_version )
+           {
+              count = synced();
+              if( count > ( _index.capacity - index_header_size ) / index_entry_size )
+                 count = 0;
+           }
+           _end = log_header_size;
+           if( count > 0 )
+           {
+              // an index from another log, or ahead of a log cut short, is thrown away
+              const uint64_t last = offset( count - 1 );
+              const int64_t size = check_record( last );
+              if( offset( 0 ) != log_header_size || size < 0 )
+                 count = 0;
+              else
+                 _end = last + record_header_size + size;
+           }
+           if( _index.capacity < index_header_size )
+              _index.resize( min_index_capacity );
+           memcpy( _index.data, index_magic, 4 );
+           write32_le( _index.data + 4, format_version );
+           set_synced( count );
+
+           _count = count;
+           for( int64_t size; ( size = check_record( _end ) ) >= 0; _end += record_header_size + size )
+           {
+              reserve_index( _count + 1 );
+              write64_le( _index.data + index_header_size + _count++ * index_entry_size, _end );
+           }
+        }
+
+        /** Drops whatever follows the last record, so that a torn one can't come back after a shorter append */
+        void cut_tail()
+        {
+           _log.resize( _end );
+           _log.resize( grown( min_log_capacity, _end ) );
+        }
+
+        void flush()
+        {
+           _log.region->sync();
+           _index.region->sync();
+           set_synced( _count );
+           _index.region->sync();
+        }
+   };
+
+   record_log::record_log()
+   :my( new impl() )
+   {
+   }
+
+   record_log::record_log( const fc::path& file )
+   :record_log()
+   {
+      open( file );
+   }
+
+   record_log::~record_log()
+   {
+      try
+      {
+         close();
+      }
+      catch( ... )
+      {
+      }
+   }
+
+   void record_log::open( const fc::path& file )
+   {
+      FC_ASSERT( !my->_open, "The record log is already open" );
+      try
+      {
+         auto& log = my->_log;
+         log.open( file );
+         if( log.capacity < log_header_size )
+         {
+            // new, or torn before the header was written
+            log.resize( min_log_capacity );
+            memcpy( log.data, log_magic, 4 );
+            write32_le( log.data + 4, format_version );
+         }
+         else if( memcmp( log.data, log_magic, 4 ) != 0 )
+            FC_THROW_EXCEPTION( parse_error_exception, "Not a record log" );
+         else if( read32_le( log.data + 4 ) != format_version )
+            FC_THROW_EXCEPTION( parse_error_exception, "Unsupported record log version ${v}", ("v", read32_le( log.data + 4 )) );
+
+         my->_index.open( file.generic_string() + ".index" );
+         my->recover();
+         my->cut_tail();
+         my->flush();
+         my->_open = true;
+      }
+      catch( ... )
+      {
+         my->_log.close();
+         my->_index.close();
+         my->_count = 0;
+         my->_end = log_header_size;
+         my->_open = false;
+         throw;
+      }
+   }
+
+   void record_log::close()
+   {
+      if( !my->_open ) return;
+      my->flush();
+      my->_log.resize( my->_end );
+      my->_index.resize( index_header_size + my->_count * index_entry_size );
+      my->_log.close();
+      my->_index.close();
+      my->_count = 0;
+      my->_end = log_header_size;
+      my->_open = false;
+   }
+
+   bool record_log::is_open()const
+   {
+      return my->_open;
+   }
+
+   uint64_t record_log::size()const
+   {
+      return my->_count;
+   }
+
+   uint64_t record_log::bytes()const
+   {
+      return my->_open ? my->_end : 0;
+   }
+
+   char* record_log::begin_append( size_t size )
+   {
+      FC_ASSERT( my->_open, "The record log is not open" );
+      FC_ASSERT( size <= max_record_size, "Record of ${n} bytes is too large", ("n", size) );
+      my->reserve_log( my->_end + record_header_size + size );
+      my->reserve_index( my->_count + 1 );
+      return my->_log.data + my->_end + record_header_size;
+   }
+
+   uint64_t record_log::end_append( size_t size )
+   {
+      char* record = my->_log.data + my->_end;
+      write32_le( record, uint32_t(size) );
+      write32_le( record + 4, record_crc( record, size ) );
+      write64_le( my->_index.data + index_header_size + my->_count * index_entry_size, my->_end );
+      my->_end += record_header_size + size;
+      return my->_count++;
+   }
+
+   uint64_t record_log::append( const char* data, size_t size )
+   {
+      char* p = begin_append( size );
+      if( size ) memcpy( p, data, size );
+      return end_append( size );
+   }
+
+   datastream<const char*> record_log::read( uint64_t seq )const
+   {
+      if( seq >= my->_count )
+         FC_THROW_EXCEPTION( out_of_range_exception, "Record ${n} of ${c}", ("n", seq)("c", my->_count) );
+      const char* record = my->_log.data + my->offset( seq );
+      return datastream<const char*>( record + record_header_size, read32_le( record ) );
+   }
+
+   bool record_log::verify( uint64_t seq )const
+   {
+      if( seq >= my->_count )
+         FC_THROW_EXCEPTION( out_of_range_exception, "Record ${n} of ${c}", ("n", seq)("c", my->_count) );
+      return my->check_record( my->offset( seq ) ) >= 0;
+   }
+
+   void record_log::advise_sequential( uint64_t first )const
+   {
+      const uint64_t begin = my->offset( first );
+      my->_log.region->advise( mapped_region::sequential_access, begin, my->_end - begin );
+   }
+
+   void record_log::truncate( uint64_t count )
+   {
+      FC_ASSERT( my->_open, "The record log is not open" );
+      if( count >= my->_count ) return;
+      // the index has to stop trusting the dropped records before they go
+      if( my->synced() > count )
+      {
+         my->set_synced( count );
+         my->_index.region->sync();
+      }
+      my->_end = my->offset( count );
+      my->_count = count;
+      my->cut_tail();
+   }
+
+   void record_log::flush()
+   {
+      FC_ASSERT( my->_open, "The record log is not open" );
+      my->flush();
+   }
+}
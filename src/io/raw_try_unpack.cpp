@@ -0,0 +1,54 @@
+#include <fc/io/raw_try_unpack.hpp>
+
+namespace fc { namespace raw {
+
+   const char* to_string( unpack_status::error_kind kind )
+   {
+      switch( kind )
+      {
+         case unpack_status::ok:            return "ok";
+         case unpack_status::out_of_range:  return "out of range";
+         case unpack_status::too_large:     return "too large";
+         case unpack_status::invalid_value: return "invalid value";
+         case unpack_status::exception:     return "exception";
+      }
+      return "unknown";
+   }
+
+   std::string unpack_status::type_path()const
+   {
+      std::string path;
+      if( _root )
+         path = _root();
+      const uint32_t stored = std::min<uint32_t>( _depth, _frames.size() );
+      if( stored < _depth )
+         path += "...";
+      for( uint32_t i = stored; i-- > 0; ) {
+         const auto& f = _frames[i];
+         if( f.field ) {
+            path += '.';
+            path += f.field;
+         } else {
+            path += '[';
+            path += std::to_string( f.index );
+            path += ']';
+         }
+      }
+      if( _leaf ) {
+         if( !path.empty() )
+            path += ' ';
+         path += '(';
+         path += _leaf();
+         path += ')';
+      }
+      return path;
+   }
+
+   std::string unpack_status::to_string()const
+   {
+      if( _kind == ok )
+         return raw::to_string( _kind );
+      return std::string( raw::to_string( _kind ) ) + " at byte " + std::to_string( _offset ) + " in " + type_path();
+   }
+
+} } // namespace fc::raw
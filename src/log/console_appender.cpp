@@ -9,9 +9,9 @@
 #define COLOR_CONSOLE 1
 #include "console_defines.h"
 #include <fc/exception/exception.hpp>
-#include <iomanip>
+#include <cinttypes>
+#include <ctime>
 #include <mutex>
-#include <sstream>
 
 
 namespace fc {
@@ -21,7 +21,9 @@ namespace fc {
      config                      cfg;
      std::mutex                  log_mutex;
      color::type                 lc[log_level::off+1];
-     bool                        use_syslog_header{getenv("JOURNAL_STREAM")};
+     bool                        use_syslog_header{getenv("JOURNAL_STREAM") != nullptr};
+     FILE*                       out = stderr;
+     bool                        is_tty = false;
 #ifdef WIN32
      HANDLE                      console_handle;
 #endif
@@ -39,7 +41,10 @@ namespace fc {
       configure( cfg );
    }
    console_appender::console_appender()
-   :my(new impl){}
+   :my(new impl)
+   {
+      configure( config() );
+   }
 
 
    void console_appender::configure( const config& console_appender_config )
@@ -55,6 +60,12 @@ namespace fc {
            my->console_handle = GetStdHandle(STD_OUTPUT_HANDLE);
 #endif
 
+#ifndef WIN32
+         // isatty() is a syscall, the stream doesn't change between lines
+         my->out = my->cfg.stream == stream::std_error ? stderr : stdout;
+         my->is_tty = isatty( fileno( my->out ) );
+#endif
+
          for( int i = 0; i < log_level::off+1; ++i )
             my->lc[i] = color::console_default;
          for( auto itr = my->cfg.level_colors.begin(); itr != my->cfg.level_colors.end(); ++itr )
@@ -83,31 +94,85 @@ namespace fc {
       }
    }
 
-   string fixed_size( size_t s, const string& str ) {
-      if( str.size() == s ) return str;
-      if( str.size() > s ) return str.substr( 0, s );
-      string tmp = str;
-      tmp.append( s - str.size(), ' ' );
-      return tmp;
-   }
+   namespace detail {
+      /// appends @p str truncated or padded with spaces to exactly @p width characters
+      static void append_fixed( std::string& out, const char* str, size_t size, size_t width ) {
+         if( size >= width ) {
+            out.append( str, width );
+         } else {
+            out.append( str, size );
+            out.append( width - size, ' ' );
+         }
+      }
 
-   void console_appender::log( const log_message& m ) {
-      //fc::string message = fc::format_string( m.get_format(), m.get_data() );
-      //fc::variant lmsg(m);
+      static void append_fixed( std::string& out, const std::string& str, size_t width ) {
+         append_fixed( out, str.data(), str.size(), width );
+      }
 
-      FILE* out = stream::std_error ? stderr : stdout;
+      /// "YYYY-MM-DDTHH:MM:SS.mmm", the same as fc::string(time_point)
+      static void append_timestamp( std::string& out, time_point t ) {
+         // formatting the date only changes once a second, keep it around
+         static thread_local int64_t cached_second = -1;
+         static thread_local char    cached_prefix[24];
+         static thread_local size_t  cached_prefix_size = 0;
+
+         const int64_t count = t.time_since_epoch().count();
+         if( count < 0 ) {
+            out += string( t );
+            return;
+         }
+         const int64_t second = count / 1000000;
+         if( second != cached_second ) {
+            time_t tt = second;
+            struct tm tm_utc;
+#ifdef WIN32
+            gmtime_s( &tm_utc, &tt );
+#else
+            gmtime_r( &tt, &tm_utc );
+#endif
+            cached_prefix_size = strftime( cached_prefix, sizeof(cached_prefix), "%Y-%m-%dT%H:%M:%S", &tm_utc );
+            cached_second = second;
+         }
+         out.append( cached_prefix, cached_prefix_size );
+
+         const unsigned msec = (count % 1000000) / 1000;
+         char ms[4] = { '.', char('0' + msec / 100), char('0' + msec / 10 % 10), char('0' + msec % 10) };
+         out.append( ms, sizeof(ms) );
+      }
+
+      static void append_level( std::string& out, log_level level ) {
+         switch( level ) {
+            case log_level::all:   out += "all  "; break;
+            case log_level::debug: out += "debug"; break;
+            case log_level::info:  out += "info "; break;
+            case log_level::warn:  out += "warn "; break;
+            case log_level::error: out += "error"; break;
+            case log_level::off:   out += "off  "; break;
+            default:               out += "unkno"; break;
+         }
+      }
+
+      /** Through stdio, so that the line keeps its place among what the application printed to the same stream */
+      static void write_line( FILE* out, const std::string& line, bool flush ) {
+         fwrite( line.data(), 1, line.size(), out );
+         if( flush ) fflush( out );
+      }
+   }
 
-      //fc::string fmt_str = fc::format_string( cfg.format, mutable_variant_object(m.get_context())( "message", message)  );
+   void console_appender::log( const log_message& m ) {
+      // every line is rendered into this buffer and handed to stdio with a single fwrite()
+      static thread_local std::string line;
+      line.clear();
 
       const log_context context = m.get_context();
-      std::string file_line = context.get_file().substr( 0, 22 );
-      file_line += ':';
-      file_line += fixed_size(  6, fc::to_string( context.get_line_number() ) );
+      const log_level level = context.get_log_level();
+
+#ifndef WIN32
+      if( my->is_tty ) line += get_console_color( my->lc[level] );
+#endif
 
-      std::string line;
-      line.reserve( 256 );
       if(my->use_syslog_header) {
-         switch(m.get_context().get_log_level()) {
+         switch(level) {
             case log_level::error:
                line += "<3>";
                break;
@@ -122,57 +187,69 @@ namespace fc {
                break;
          }
       }
-      line += fixed_size(  5, context.get_log_level().to_string() ); line += ' ';
+      detail::append_level( line, level ); line += ' ';
       // use now() instead of context.get_timestamp() because log_message construction can include user provided long running calls
-      line += string( time_point::now() ); line += ' ';
-      line += fixed_size(  9, context.get_thread_name() ); line += ' ';
-      line += fixed_size( 29, file_line ); line += ' ';
-
-      auto me = context.get_method();
+      detail::append_timestamp( line, time_point::now() ); line += ' ';
+      detail::append_fixed( line, context.get_thread_name(), 9 ); line += ' ';
+
+      // "file:line" padded to 29, the file name truncated to 22 and the line number padded to 6
+      const auto file_line_start = line.size();
+      const auto file = context.get_file_view();
+      line.append( file.data(), std::min<size_t>( file.size(), 22 ) );
+      line += ':';
+      char line_number[24];
+      int line_number_size = snprintf( line_number, sizeof(line_number), "%" PRIu64, context.get_line_number() );
+      detail::append_fixed( line, line_number, line_number_size, 6 );
+      line.append( 29 - (line.size() - file_line_start), ' ' );
+      line += ' ';
+
+      const auto method = context.get_method_view();
       // strip all leading scopes...
-      if( me.size() ) {
-         uint32_t p = 0;
-         for( uint32_t i = 0;i < me.size(); ++i ) {
-             if( me[i] == ':' ) p = i;
-         }
-
-         if( me[p] == ':' ) ++p;
-         line += fixed_size( 20, context.get_method().substr( p, 20 ) ); line += ' ';
+      if( method.size() ) {
+         auto p = method.rfind( ':' );
+         p = p == std::string_view::npos ? 0 : p + 1;
+         detail::append_fixed( line, method.data() + p, std::min<size_t>( method.size() - p, 20 ), 20 ); line += ' ';
       }
       line += "] ";
-      line += fc::format_string( m.get_format(), m.get_data() );
-
-      std::unique_lock<std::mutex> lock(my->log_mutex);
+      m.append_message( line );
 
-      print( line, my->lc[context.get_log_level()] );
+#ifndef WIN32
+      if( my->is_tty ) line += CONSOLE_DEFAULT;
+      line += '\n';
 
+      std::unique_lock<std::mutex> lock(my->log_mutex);
+      detail::write_line( my->out, line, my->cfg.flush );
+#else
+      std::unique_lock<std::mutex> lock(my->log_mutex);
+      print( line, my->lc[level] );
+      FILE* out = my->cfg.stream == stream::std_error ? stderr : stdout;
       fprintf( out, "\n" );
-
       if( my->cfg.flush ) fflush( out );
+#endif
    }
 
    void console_appender::print( const std::string& text, color::type text_color )
    {
-      FILE* out = stream::std_error ? stderr : stdout;
-
       #ifdef WIN32
+         FILE* out = my->cfg.stream == stream::std_error ? stderr : stdout;
+
          if (my->console_handle != INVALID_HANDLE_VALUE)
            SetConsoleTextAttribute(my->console_handle, get_console_color(text_color));
-      #else
-         if(isatty(fileno(out))) fprintf( out, "%s", get_console_color( text_color ) );
-      #endif
 
-      if( text.size() )
-         fprintf( out, "%s", text.c_str() ); //fmt_str.c_str() );
+         if( text.size() )
+            fprintf( out, "%s", text.c_str() ); //fmt_str.c_str() );
 
-      #ifdef WIN32
-      if (my->console_handle != INVALID_HANDLE_VALUE)
-        SetConsoleTextAttribute(my->console_handle, CONSOLE_DEFAULT);
+         if (my->console_handle != INVALID_HANDLE_VALUE)
+           SetConsoleTextAttribute(my->console_handle, CONSOLE_DEFAULT);
+
+         if( my->cfg.flush ) fflush( out );
       #else
-      if(isatty(fileno(out))) fprintf( out, "%s", CONSOLE_DEFAULT );
+         std::string line;
+         if( my->is_tty ) line += get_console_color( text_color );
+         line += text;
+         if( my->is_tty ) line += CONSOLE_DEFAULT;
+         detail::write_line( my->out, line, my->cfg.flush );
       #endif
-
-      if( my->cfg.flush ) fflush( out );
    }
 
 }
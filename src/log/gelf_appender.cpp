@@ -1,21 +1,26 @@
-#include <fc/network/udp_socket.hpp>
+#include <boost/asio.hpp>
 #include <fc/network/ip.hpp>
 #include <fc/network/resolve.hpp>
 #include <fc/exception/exception.hpp>
 #include <fc/log/gelf_appender.hpp>
 #include <fc/reflect/variant.hpp>
 #include <fc/variant.hpp>
-#include <fc/io/json.hpp>
 #include <fc/crypto/city.hpp>
 #include <fc/compress/zlib.hpp>
 
 #include <boost/lexical_cast.hpp>
-#include <iomanip>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
 #include <iostream>
 #include <mutex>
-#include <queue>
-#include <sstream>
-#include <iostream>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
 
 namespace fc
 {
@@ -25,24 +30,382 @@ namespace fc
     {
       return boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4(e.get_address()), e.port() );
     }
+
+    /// appends @p s as a quoted JSON string, escaping the same characters as fc::json
+    static void append_json_string( std::string& out, std::string_view s )
+    {
+      static const char hex_digits[] = "0123456789abcdef";
+      out += '"';
+      for( char c : s )
+      {
+        switch( c )
+        {
+          case '\b': out += "\\b"; break;
+          case '\f': out += "\\f"; break;
+          case '\n': out += "\\n"; break;
+          case '\r': out += "\\r"; break;
+          case '\t': out += "\\t"; break;
+          case '\\': out += "\\\\"; break;
+          case '"':  out += "\\\""; break;
+          default:
+            if( (unsigned char)c < 0x20 )
+            {
+              out += "\\u00";
+              out += hex_digits[(unsigned char)c >> 4];
+              out += hex_digits[(unsigned char)c & 0xf];
+            }
+            else
+              out += c;
+        }
+      }
+      out += '"';
+    }
+
+    template<typename T>
+    static void append_number( std::string& out, T value )
+    {
+      char buf[24];
+      auto res = std::to_chars(buf, buf + sizeof(buf), value);
+      out.append(buf, res.ptr);
+    }
+
+    static void append_field( std::string& out, const char* key, std::string_view value )
+    {
+      out += ",\"";
+      out += key;
+      out += "\":";
+      append_json_string(out, value);
+    }
+
+    template<typename T>
+    static void append_number_field( std::string& out, const char* key, T value )
+    {
+      out += ",\"";
+      out += key;
+      out += "\":";
+      append_number(out, value);
+    }
   }
 
   class gelf_appender::impl
   {
   public:
-    config                                    cfg;
-    optional<boost::asio::ip::udp::endpoint>  gelf_endpoint;
-    udp_socket                                gelf_socket;
-    std::mutex                                gelf_log_mutex;
+    // GELF limits: 2 bytes magic, 8 bytes message id, sequence number and sequence count
+    static constexpr unsigned chunk_header_length = 2 + 8 + 1 + 1;
+    static constexpr unsigned max_chunks = 128;
+    // buffers larger than this go back to the allocator instead of the pool
+    static constexpr size_t max_pooled_buffer_size = 64 * 1024;
+
+    config                                        cfg;
+    optional<boost::asio::ip::udp::endpoint>      gelf_endpoint;
+    std::unique_ptr<boost::asio::ip::udp::socket> udp_socket;
+    // the sender thread's own, so that it can give up on a stalled connect or write
+    boost::asio::io_context                       tcp_io;
+    std::unique_ptr<boost::asio::ip::tcp::socket> tcp_socket;
+    time_point                                    last_connect_attempt;
+
+    std::mutex                                    queue_mutex;
+    std::condition_variable                       queue_cond;
+    std::vector<std::string>                      pending;      // rendered messages waiting for the sender thread
+    std::vector<std::string>                      free_buffers; // sent messages, reused by the logging threads
+    uint64_t                                      dropped = 0;
+    bool                                          stopping = false;
+    std::thread                                   sender;
+
+    std::atomic<uint64_t>                         log_counter{0};
+
+    // owned by the sender thread
+    std::vector<std::vector<char>>                compressed;
+    std::vector<std::array<unsigned char, chunk_header_length>> chunk_headers;
 
     impl(const config& c) :
       cfg(c)
     {
+      FC_ASSERT(cfg.max_payload_size > chunk_header_length && cfg.max_payload_size <= 65507,
+                "max_payload_size must fit a chunk header and be a valid UDP datagram size");
     }
 
     ~impl()
     {
+      stop();
+    }
+
+    void start()
+    {
+      if (!sender.joinable())
+        sender = std::thread([this]{ run(); });
+    }
+
+    void stop()
+    {
+      {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+      }
+      queue_cond.notify_one();
+      if (sender.joinable())
+        sender.join();
+    }
+
+    void enqueue(std::string& message)
+    {
+      {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (stopping || pending.size() >= cfg.max_queue_size)
+        {
+          ++dropped;
+          return;
+        }
+        if (free_buffers.empty())
+          pending.emplace_back();
+        else
+        {
+          pending.emplace_back(std::move(free_buffers.back()));
+          free_buffers.pop_back();
+        }
+        // the caller keeps the recycled buffer (and its capacity) for the next message
+        pending.back().swap(message);
+      }
+      queue_cond.notify_one();
+    }
+
+    void run()
+    {
+      std::vector<std::string> batch;
+      std::unique_lock<std::mutex> lock(queue_mutex);
+      while (true)
+      {
+        queue_cond.wait(lock, [this]{ return stopping || !pending.empty(); });
+        if (pending.empty())
+        {
+          if (dropped)
+            std::cerr << "GELF appender dropped " << dropped << " messages\n";
+          break;
+        }
+        batch.swap(pending);
+        uint64_t dropped_messages = dropped;
+        dropped = 0;
+        lock.unlock();
+
+        if (dropped_messages)
+          std::cerr << "GELF appender dropped " << dropped_messages << " messages\n";
+        uint64_t unsent = 0;
+        try
+        {
+          if (cfg.transport == transport::tcp)
+            unsent = send_tcp(batch);
+          else
+            send_udp(batch);
+        }
+        catch (const std::exception& e)
+        {
+          std::cerr << "error sending GELF messages to endpoint " << cfg.endpoint << ": " << e.what() << "\n";
+        }
+        catch (...)
+        {
+          std::cerr << "error sending GELF messages to endpoint " << cfg.endpoint << "\n";
+        }
+
+        lock.lock();
+        // reported with the next batch
+        dropped += unsent;
+        for (auto& buffer : batch)
+          if (free_buffers.size() < cfg.max_queue_size && buffer.capacity() <= max_pooled_buffer_size)
+            free_buffers.emplace_back(std::move(buffer));
+        batch.clear();
+      }
+    }
+
+    /// runs the operation just started on tcp_io to completion, closing the socket if it takes longer than the timeout
+    void run_tcp_io(const bool& done, boost::system::error_code& ec)
+    {
+      tcp_io.restart();
+      tcp_io.run_for(std::chrono::milliseconds(cfg.tcp_timeout_ms));
+      if (!done)
+      {
+        // closing cancels the operation, whose handler still has to run
+        boost::system::error_code ignored;
+        tcp_socket->close(ignored);
+        tcp_io.restart();
+        tcp_io.run();
+        ec = boost::asio::error::timed_out;
+      }
+    }
+
+    /// @return the number of messages that couldn't be sent
+    uint64_t send_tcp(const std::vector<std::string>& batch)
+    {
+      if (!tcp_socket->is_open())
+      {
+        // don't hammer an unreachable server, drop what was logged meanwhile instead
+        auto now = time_point::now();
+        if (now - last_connect_attempt < fc::seconds(1))
+          return batch.size();
+        last_connect_attempt = now;
+
+        boost::system::error_code ec;
+        bool done = false;
+        tcp_socket->async_connect(boost::asio::ip::tcp::endpoint(gelf_endpoint->address(), gelf_endpoint->port()),
+                                  [&](const boost::system::error_code& e) { ec = e; done = true; });
+        run_tcp_io(done, ec);
+        if (ec)
+        {
+          boost::system::error_code ignored;
+          tcp_socket->close(ignored);
+          std::cerr << "error connecting GELF socket to endpoint " << cfg.endpoint << ": " << ec.message() << "\n";
+          return batch.size();
+        }
+      }
+
+      // every message already carries its null delimiter
+      std::vector<boost::asio::const_buffer> buffers;
+      buffers.reserve(batch.size());
+      for (const auto& message : batch)
+        buffers.emplace_back(message.data(), message.size());
+
+      boost::system::error_code ec;
+      bool done = false;
+      boost::asio::async_write(*tcp_socket, buffers,
+                               [&](const boost::system::error_code& e, size_t) { ec = e; done = true; });
+      run_tcp_io(done, ec);
+      if (ec)
+      {
+        boost::system::error_code ignored;
+        tcp_socket->close(ignored);
+        std::cerr << "error writing to GELF socket " << cfg.endpoint << ": " << ec.message() << "\n";
+        // how much of the batch got through is unknown
+        return batch.size();
+      }
+      return 0;
     }
+
+    /// a datagram is an optional chunk header followed by a slice of the payload
+    struct datagram
+    {
+      int         header; // index into chunk_headers, -1 for unchunked messages
+      const char* data;
+      size_t      size;
+    };
+
+    void send_udp(const std::vector<std::string>& batch)
+    {
+      if (compressed.size() < batch.size())
+        compressed.resize(batch.size());
+      chunk_headers.clear();
+
+      std::vector<datagram> datagrams;
+      datagrams.reserve(batch.size());
+
+      const unsigned body_length = cfg.max_payload_size - chunk_header_length;
+      for (size_t i = 0; i < batch.size(); ++i)
+      {
+        const char* payload = batch[i].data();
+        size_t payload_size = batch[i].size();
+        if (cfg.compress)
+        {
+          auto& out = compressed[i];
+          zlib_compress(batch[i].data(), batch[i].size(), out);
+
+          // graylog2 expects the zlib header to be 0x78 0x9c
+          // but miniz.c generates 0x78 0x01 (indicating
+          // low compression instead of default compression)
+          // so change that here
+          FC_ASSERT(out.size() >= 2 && out[0] == (char)0x78);
+          if (out[1] == (char)0x01 || out[1] == (char)0xda)
+            out[1] = (char)0x9c;
+          FC_ASSERT(out[1] == (char)0x9c);
+          payload = out.data();
+          payload_size = out.size();
+        }
+
+        if (payload_size <= cfg.max_payload_size)
+        {
+          datagrams.push_back({-1, payload, payload_size});
+          continue;
+        }
+
+        unsigned total_number_of_packets = (payload_size + body_length - 1) / body_length;
+        if (total_number_of_packets > max_chunks)
+        {
+          std::cerr << "GELF message of " << payload_size << " bytes exceeds " << max_chunks << " chunks, dropped\n";
+          continue;
+        }
+
+        // we need to generate an 8-byte ID for this message.
+        // city hash should do, mixed with the sequence so repeated messages don't collide
+        uint64_t message_id = city_hash64(payload, payload_size) ^ log_counter.load(std::memory_order_relaxed) ^ i;
+        for (unsigned seq = 0; seq < total_number_of_packets; ++seq)
+        {
+          std::array<unsigned char, chunk_header_length> header;
+          // magic number for chunked message
+          header[0] = 0x1e;
+          header[1] = 0x0f;
+          memcpy(header.data() + 2, (char*)&message_id, sizeof(message_id));
+          header[10] = seq;
+          header[11] = total_number_of_packets;
+          chunk_headers.push_back(header);
+
+          size_t offset = size_t(seq) * body_length;
+          datagrams.push_back({int(chunk_headers.size() - 1), payload + offset, std::min<size_t>(body_length, payload_size - offset)});
+        }
+      }
+
+      send_datagrams(datagrams);
+    }
+
+#ifdef __linux__
+    // one syscall for up to 64 datagrams
+    void send_datagrams(const std::vector<datagram>& datagrams)
+    {
+      static constexpr size_t max_batch = 64;
+      std::array<mmsghdr, max_batch> msgs;
+      std::array<iovec, max_batch * 2> iovs;
+
+      const int fd = udp_socket->native_handle();
+      size_t next = 0;
+      while (next < datagrams.size())
+      {
+        const size_t count = std::min(max_batch, datagrams.size() - next);
+        for (size_t i = 0; i < count; ++i)
+        {
+          const datagram& d = datagrams[next + i];
+          iovec* iov = &iovs[i * 2];
+          size_t iovlen = 0;
+          if (d.header >= 0)
+            iov[iovlen++] = { chunk_headers[d.header].data(), chunk_header_length };
+          iov[iovlen++] = { const_cast<char*>(d.data), d.size };
+
+          msgs[i] = {};
+          msgs[i].msg_hdr.msg_name = gelf_endpoint->data();
+          msgs[i].msg_hdr.msg_namelen = gelf_endpoint->size();
+          msgs[i].msg_hdr.msg_iov = iov;
+          msgs[i].msg_hdr.msg_iovlen = iovlen;
+        }
+
+        int sent = sendmmsg(fd, msgs.data(), count, 0);
+        if (sent < 0 && errno == EINTR)
+          continue;
+        // sendmmsg stops at the first datagram that fails, drop that one and carry on.
+        // Depend on the local log to catch anything that doesn't make it across the network.
+        next += sent > 0 ? sent : 1;
+      }
+    }
+#else
+    void send_datagrams(const std::vector<datagram>& datagrams)
+    {
+      for (const auto& d : datagrams)
+      {
+        std::array<boost::asio::const_buffer, 2> buffers;
+        size_t count = 0;
+        if (d.header >= 0)
+          buffers[count++] = boost::asio::const_buffer(chunk_headers[d.header].data(), chunk_header_length);
+        buffers[count++] = boost::asio::const_buffer(d.data, d.size);
+
+        boost::system::error_code ec;
+        udp_socket->send_to(boost::asio::buffer(buffers.data(), count), *gelf_endpoint, 0, ec);
+      }
+    }
+#endif
   };
 
   gelf_appender::gelf_appender(const variant& args) :
@@ -84,144 +447,104 @@ namespace fc
         }
       }
 
-      if (my->gelf_endpoint)
+      if (my->gelf_endpoint && !my->sender.joinable())
       {
-        my->gelf_socket.initialize(io_service);
-        my->gelf_socket.open();
+        // the sockets are only used by the sender thread
+        if (my->cfg.transport == transport::tcp)
+        {
+          // connected lazily by the sender thread
+          my->tcp_socket.reset(new boost::asio::ip::tcp::socket(my->tcp_io));
+        }
+        else
+        {
+          my->udp_socket.reset(new boost::asio::ip::udp::socket(io_service));
+          my->udp_socket->open(boost::asio::ip::udp::v4());
+        }
+        my->start();
         std::cerr << "opened GELF socket to endpoint " << my->cfg.endpoint << "\n";
       }
     }
     catch (...)
     {
+      my->gelf_endpoint.reset();
       std::cerr << "error opening GELF socket to endpoint " << my->cfg.endpoint << "\n";
     }
   }
 
   gelf_appender::~gelf_appender()
-  {}
+  {
+    // flushes everything logged so far
+    my->stop();
+  }
 
   void gelf_appender::log(const log_message& message)
   {
     if (!my->gelf_endpoint)
       return;
 
+    // rendered in place, the sender thread hands back a pooled buffer in exchange
+    static thread_local std::string gelf_message;
+    gelf_message.clear();
+
     log_context context = message.get_context();
 
-    mutable_variant_object gelf_message;
-    gelf_message["version"] = "1.1";
-    gelf_message["host"] = my->cfg.host;
-    gelf_message["short_message"] = format_string(message.get_format(), message.get_data());
+    gelf_message += "{\"version\":\"1.1\"";
+    detail::append_field(gelf_message, "host", my->cfg.host);
+    // the message is rendered into a per-thread scratch buffer first, it's JSON-escaped below
+    static thread_local std::string short_message;
+    short_message.clear();
+    message.append_message(short_message);
+    detail::append_field(gelf_message, "short_message", short_message);
 
     // use now() instead of context.get_timestamp() because log_message construction can include user provided long running calls
     const auto time_ns = time_point::now().time_since_epoch().count();
-    gelf_message["timestamp"] = time_ns / 1000000.;
-    gelf_message["_timestamp_ns"] = time_ns;
+    char timestamp[32];
+    int timestamp_size = snprintf(timestamp, sizeof(timestamp), "%.6f", time_ns / 1000000.);
+    gelf_message += ",\"timestamp\":";
+    gelf_message.append(timestamp, timestamp_size);
+    detail::append_number_field(gelf_message, "_timestamp_ns", time_ns);
 
-    static uint64_t gelf_log_counter;
-    gelf_message["_log_id"] = fc::to_string(++gelf_log_counter);
+    gelf_message += ",\"_log_id\":\"";
+    detail::append_number(gelf_message, ++my->log_counter);
+    gelf_message += '"';
 
+    int level = 6; // info
     switch (context.get_log_level())
     {
     case log_level::debug:
-      gelf_message["level"] = 7; // debug
+      level = 7; // debug
       break;
     case log_level::info:
-      gelf_message["level"] = 6; // info
+      level = 6; // info
       break;
     case log_level::warn:
-      gelf_message["level"] = 4; // warning
+      level = 4; // warning
       break;
     case log_level::error:
-      gelf_message["level"] = 3; // error
+      level = 3; // error
       break;
     case log_level::all:
     case log_level::off:
       // these shouldn't be used in log messages, but do something deterministic just in case
-      gelf_message["level"] = 6; // info
+      level = 6; // info
       break;
     }
+    detail::append_number_field(gelf_message, "level", level);
 
     if (!context.get_context().empty())
-      gelf_message["context"] = context.get_context();
-    gelf_message["_line"] = context.get_line_number();
-    gelf_message["_file"] = context.get_file();
-    gelf_message["_method_name"] = context.get_method();
-    gelf_message["_thread_name"] = context.get_thread_name();
+      detail::append_field(gelf_message, "context", context.get_context());
+    detail::append_number_field(gelf_message, "_line", context.get_line_number());
+    detail::append_field(gelf_message, "_file", context.get_file_view());
+    detail::append_field(gelf_message, "_method_name", context.get_method_view());
+    detail::append_field(gelf_message, "_thread_name", context.get_thread_name());
     if (!context.get_task_name().empty())
-      gelf_message["_task_name"] = context.get_task_name();
-
-    string gelf_message_as_string = json::to_string(gelf_message, json::legacy_generator); // GELF 1.1 specifies unstringified numbers
-    //unsigned uncompressed_size = gelf_message_as_string.size();
-    gelf_message_as_string = zlib_compress(gelf_message_as_string);
-
-    // graylog2 expects the zlib header to be 0x78 0x9c
-    // but miniz.c generates 0x78 0x01 (indicating
-    // low compression instead of default compression)
-    // so change that here
-    FC_ASSERT(gelf_message_as_string[0] == (char)0x78);
-    if (gelf_message_as_string[1] == (char)0x01 ||
-        gelf_message_as_string[1] == (char)0xda)
-      gelf_message_as_string[1] = (char)0x9c;
-    FC_ASSERT(gelf_message_as_string[1] == (char)0x9c);
-
-    std::unique_lock<std::mutex> lock(my->gelf_log_mutex);
-
-    // packets are sent by UDP, and they tend to disappear if they
-    // get too large.  It's hard to find any solid numbers on how
-    // large they can be before they get dropped -- datagrams can
-    // be up to 64k, but anything over 512 is not guaranteed.
-    // You can play with this number, intermediate values like
-    // 1400 and 8100 are likely to work on most intranets.
-    const unsigned max_payload_size = 512;
-
-    if (gelf_message_as_string.size() <= max_payload_size)
-    {
-      // no need to split
-      std::shared_ptr<char> send_buffer(new char[gelf_message_as_string.size()],
-                                        [](char* p){ delete[] p; });
-      memcpy(send_buffer.get(), gelf_message_as_string.c_str(),
-             gelf_message_as_string.size());
-
-      my->gelf_socket.send_to(send_buffer, gelf_message_as_string.size(),
-                              *my->gelf_endpoint);
-    }
-    else
-    {
-      // split the message
-      // we need to generate an 8-byte ID for this message.
-      // city hash should do
-      uint64_t message_id = city_hash64(gelf_message_as_string.c_str(), gelf_message_as_string.size());
-      const unsigned header_length = 2 /* magic */ + 8 /* msg id */ + 1 /* seq */ + 1 /* count */;
-      const unsigned body_length = max_payload_size - header_length;
-      unsigned total_number_of_packets = (gelf_message_as_string.size() + body_length - 1) / body_length;
-      unsigned bytes_sent = 0;
-      unsigned number_of_packets_sent = 0;
-      while (bytes_sent < gelf_message_as_string.size())
-      {
-        unsigned bytes_to_send = std::min((unsigned)gelf_message_as_string.size() - bytes_sent,
-                                          body_length);
-
-        std::shared_ptr<char> send_buffer(new char[max_payload_size],
-                                          [](char* p){ delete[] p; });
-        char* ptr = send_buffer.get();
-        // magic number for chunked message
-        *(unsigned char*)ptr++ = 0x1e;
-        *(unsigned char*)ptr++ = 0x0f;
-
-        // message id
-        memcpy(ptr, (char*)&message_id, sizeof(message_id));
-        ptr += sizeof(message_id);
-
-        *(unsigned char*)(ptr++) = number_of_packets_sent;
-        *(unsigned char*)(ptr++) = total_number_of_packets;
-        memcpy(ptr, gelf_message_as_string.c_str() + bytes_sent,
-               bytes_to_send);
-        my->gelf_socket.send_to(send_buffer, header_length + bytes_to_send,
-                                *my->gelf_endpoint);
-        ++number_of_packets_sent;
-        bytes_sent += bytes_to_send;
-      }
-      FC_ASSERT(number_of_packets_sent == total_number_of_packets);
-    }
+      detail::append_field(gelf_message, "_task_name", context.get_task_name());
+    gelf_message += '}';
+
+    // GELF over TCP frames messages with a null byte
+    if (my->cfg.transport == transport::tcp)
+      gelf_message += '\0';
+
+    my->enqueue(gelf_message);
   }
 } // fc
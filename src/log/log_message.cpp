@@ -13,15 +13,23 @@ namespace fc
       class log_context_impl
       {
          public:
+            log_context_impl() = default;
+            // file and method may point into the storage below
+            log_context_impl( const log_context_impl& ) = delete;
+            log_context_impl& operator=( const log_context_impl& ) = delete;
+
             log_level level;
-            string       file;
+            std::string_view file;   ///< into file_storage, unless made with log_context::static_strings
             uint64_t     line;
-            string       method;
+            std::string_view method; ///< into method_storage, unless made with log_context::static_strings
             string       thread_name;
             string       task_name;
             string       hostname;
             string       context;
             time_point   timestamp;
+
+            string       file_storage;
+            string       method_storage;
       };
 
       class log_message_impl
@@ -34,6 +42,7 @@ namespace fc
             log_context     context;
             string          format;
             variant_object  args;
+            const void*     format_key = nullptr; ///< where format was copied from, only a cache key, see append_format_string()
       };
    }
 
@@ -47,7 +56,21 @@ namespace fc
    :my( std::make_shared<detail::log_context_impl>() )
    {
       my->level       = ll;
-      my->file        = fc::path(file).filename().generic_string(); // TODO truncate filename
+      my->file_storage = fc::path(file).filename().generic_string(); // TODO truncate filename
+      my->file        = my->file_storage;
+      my->line        = line;
+      my->method_storage = method;
+      my->method      = my->method_storage;
+      my->timestamp   = time_point::now();
+      my->thread_name = fc::get_thread_name();
+   }
+
+   log_context::log_context( static_strings_t, log_level ll, const char* file, uint64_t line,
+                                            const char* method )
+   :my( std::make_shared<detail::log_context_impl>() )
+   {
+      my->level       = ll;
+      my->file        = file;
       my->line        = line;
       my->method      = method;
       my->timestamp   = time_point::now();
@@ -59,9 +82,11 @@ namespace fc
    {
        auto obj = v.get_object();
        my->level        = obj["level"].as<log_level>();
-       my->file         = obj["file"].as_string();
+       my->file_storage = obj["file"].as_string();
+       my->file         = my->file_storage;
        my->line         = obj["line"].as_uint64();
-       my->method       = obj["method"].as_string();
+       my->method_storage = obj["method"].as_string();
+       my->method       = my->method_storage;
        my->hostname     = obj["hostname"].as_string();
        my->thread_name  = obj["thread_name"].as_string();
        if (obj.contains("task_name"))
@@ -73,7 +98,14 @@ namespace fc
 
    fc::string log_context::to_string()const
    {
-      return my->thread_name + "  " + my->file + ":" + fc::to_string(my->line) + " " + my->method;
+      fc::string result = my->thread_name;
+      result += "  ";
+      result.append( my->file.data(), my->file.size() );
+      result += ':';
+      result += fc::to_string( my->line );
+      result += ' ';
+      result.append( my->method.data(), my->method.size() );
+      return result;
 
    }
 
@@ -165,24 +197,26 @@ namespace fc
       return "unknown";
    }
 
-   string     log_context::get_file()const       { return my->file; }
+   string     log_context::get_file()const       { return string( my->file ); }
    uint64_t   log_context::get_line_number()const { return my->line; }
-   string     log_context::get_method()const     { return my->method; }
-   string     log_context::get_thread_name()const { return my->thread_name; }
-   string     log_context::get_task_name()const { return my->task_name; }
-   string     log_context::get_host_name()const   { return my->hostname; }
+   string     log_context::get_method()const     { return string( my->method ); }
+   const string& log_context::get_thread_name()const { return my->thread_name; }
+   const string& log_context::get_task_name()const { return my->task_name; }
+   const string& log_context::get_host_name()const   { return my->hostname; }
    time_point  log_context::get_timestamp()const  { return my->timestamp; }
    log_level  log_context::get_log_level()const{ return my->level;   }
-   string     log_context::get_context()const   { return my->context; }
+   const string& log_context::get_context()const   { return my->context; }
+   std::string_view log_context::get_file_view()const   { return my->file; }
+   std::string_view log_context::get_method_view()const { return my->method; }
 
 
    variant log_context::to_variant()const
    {
       mutable_variant_object o;
               o( "level",        variant(my->level)      )
-               ( "file",         my->file                )
+               ( "file",         string( my->file )      )
                ( "line",         my->line                )
-               ( "method",       my->method              )
+               ( "method",       string( my->method )    )
                ( "hostname",     my->hostname            )
                ( "thread_name",  my->thread_name         )
                ( "timestamp",    variant(my->timestamp)  );
@@ -204,6 +238,14 @@ namespace fc
       my->args    = std::move(args);
    }
 
+   log_message::log_message( log_context ctx, const char* static_format, size_t size, variant_object args )
+   :my( std::make_shared<detail::log_message_impl>(std::move(ctx)) )
+   {
+      my->format.assign( static_format, size );
+      my->args          = std::move(args);
+      my->format_key    = static_format;
+   }
+
    log_message::log_message( const variant& v )
    :my( std::make_shared<detail::log_message_impl>( log_context( v.get_object()["context"] ) ) )
    {
@@ -218,19 +260,34 @@ namespace fc
                           ( "data",    my->args   );
    }
 
-   log_context          log_message::get_context()const { return my->context; }
-   string              log_message::get_format()const  { return my->format;  }
-   variant_object log_message::get_data()const    { return my->args;    }
+   log_context           log_message::get_context()const { return my->context; }
+   const string&         log_message::get_format()const  { return my->format;  }
+   const variant_object& log_message::get_data()const    { return my->args;    }
 
    string        log_message::get_message()const
    {
-      return format_string( my->format, my->args );
+      string result;
+      append_message( result );
+      return result;
    }
 
    string        log_message::get_limited_message()const
    {
       const bool minimize = true;
-      return format_string( my->format, my->args, minimize );
+      string result;
+      if( my->format_key )
+         append_format_string( result, my->format_key, my->format, my->args, minimize );
+      else
+         append_format_string( result, my->format, my->args, minimize );
+      return result;
+   }
+
+   void          log_message::append_message( std::string& out )const
+   {
+      if( my->format_key )
+         append_format_string( out, my->format_key, my->format, my->args );
+      else
+         append_format_string( out, my->format, my->args );
    }
 
 
@@ -4,6 +4,8 @@
 #include <fc/filesystem.hpp>
 #include <unordered_map>
 #include <string>
+#include <chrono>
+#include <time.h>
 #include <fc/log/logger_config.hpp>
 
 namespace fc {
@@ -102,6 +104,43 @@ namespace fc {
         return my->_appenders;
     }
 
+    int64_t detail::coarse_seconds() {
+#ifdef CLOCK_MONOTONIC_COARSE
+       // served from the vDSO without a syscall, with jiffy resolution
+       timespec ts;
+       clock_gettime( CLOCK_MONOTONIC_COARSE, &ts );
+       return ts.tv_sec;
+#else
+       return std::chrono::duration_cast<std::chrono::seconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+    }
+
+    bool log_rate_limit::next_second( uint64_t& suppressed ) {
+       const int64_t now = detail::coarse_seconds();
+       int64_t second = _second.load( std::memory_order_relaxed );
+       if( second != now && _second.compare_exchange_strong( second, now, std::memory_order_relaxed ) ) {
+          // this message is the first of the new second
+          const uint64_t count = _count.exchange( 1, std::memory_order_relaxed );
+          suppressed = count > _max ? count - _max : 0;
+          return _max > 0;
+       }
+       // another thread started the new second
+       return _count.fetch_add( 1, std::memory_order_relaxed ) < _max;
+    }
+
+    void log_sample::report( uint64_t n, uint64_t& suppressed ) {
+       const int64_t now = detail::coarse_seconds();
+       int64_t last = _last_report.load( std::memory_order_relaxed );
+       if( last == now || !_last_report.compare_exchange_strong( last, now, std::memory_order_relaxed ) )
+          return;
+       // messages are let through at multiples of _every, so both ends are
+       const uint64_t reported = _reported.exchange( n, std::memory_order_relaxed );
+       if( n > reported ) {
+          const uint64_t skipped_over = n - reported;
+          suppressed = skipped_over - skipped_over / _every;
+       }
+    }
+
    bool configure_logging( const logging_config& cfg );
    bool do_default_config      = configure_logging( logging_config::default_config() );
 
@@ -4,9 +4,19 @@
 #undef BOOST_STACKTRACE_USE_ADDR2LINE
 
 #include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/syscall.h>
 
+#include <atomic>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <sstream>
+#include <vector>
 
 #include <fc/stacktrace.hpp>
 #include <fc/filesystem.hpp>
@@ -21,12 +31,315 @@ namespace fc {
     } }
 
     namespace {
+        constexpr char btrace_magic_[4] = {'F', 'C', 'B', 'T'};
+        constexpr uint16_t btrace_version_ = 1;
+
+        constexpr std::size_t max_threads_ = 256;
+        constexpr std::size_t max_frames_ = 64;
+        // how long the crashed thread waits for the others to record their stacks
+        constexpr long capture_timeout_ms_ = 500;
+
+        struct btrace_header {
+            char     magic[4];
+            uint16_t version;
+            uint16_t signal;
+            uint32_t pid;
+            uint32_t thread_count;
+        };
+
+        struct btrace_thread {
+            uint32_t tid;
+            uint32_t frame_count;
+        };
+
+        struct thread_frames {
+            std::atomic<bool> ready;
+            uint32_t tid;
+            uint32_t count;
+            const void* frames[max_frames_ + 1];
+        };
+
         static path dumpname_ = "./backtrace.dump";
+        // the handlers can't touch dumpname_, which allocates on conversion
+        static char dumpname_buf_[PATH_MAX];
+
+        static int capture_signal_ = 0;
+        static std::atomic<bool> crashing_{false};
+        static std::atomic<uint32_t> claimed_{0};
+        static std::atomic<uint32_t> captured_{0};
+        static thread_frames threads_[max_threads_];
+
+        static char altstack_[64 * 1024];
+
+        uint32_t gettid_() {
+            return static_cast<uint32_t>(::syscall(SYS_gettid));
+        }
+
+        // called straight from the signal handlers so that skipping one frame drops the handler itself
+        #define FC_RECORD_FRAMES(slot) \
+            do { \
+                (slot).tid = gettid_(); \
+                /* the result counts the terminating null */ \
+                auto count = boost::stacktrace::safe_dump_to(1, (slot).frames, sizeof((slot).frames)); \
+                (slot).count = count ? static_cast<uint32_t>(count - 1) : 0; \
+                (slot).ready.store(true, std::memory_order_release); \
+            } while (0)
+
+        bool write_all_(int fd, const void* data, std::size_t size) {
+            auto p = static_cast<const char*>(data);
+            while (size) {
+                auto n = ::write(fd, p, size);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                p += n;
+                size -= n;
+            }
+            return true;
+        }
+
+        long elapsed_ms_(const timespec& since) {
+            timespec now;
+            ::clock_gettime(CLOCK_MONOTONIC, &now);
+            return (now.tv_sec - since.tv_sec) * 1000 + (now.tv_nsec - since.tv_nsec) / 1000000;
+        }
+
+        // Interrupts every other thread of the process with capture_signal_, returns how many were signalled
+        uint32_t signal_other_threads_(uint32_t self) {
+            int dir = ::open("/proc/self/task", O_RDONLY | O_DIRECTORY);
+            if (dir < 0) return 0;
+
+            struct linux_dirent64 {
+                uint64_t       d_ino;
+                int64_t        d_off;
+                unsigned short d_reclen;
+                unsigned char  d_type;
+                char           d_name[];
+            };
+
+            const auto pid = ::getpid();
+            uint32_t sent = 0;
+            alignas(linux_dirent64) char buf[4096];
+            for (;;) {
+                auto n = ::syscall(SYS_getdents64, dir, buf, sizeof(buf));
+                if (n <= 0) break;
+                for (long pos = 0; pos < n;) {
+                    auto entry = reinterpret_cast<linux_dirent64*>(buf + pos);
+                    pos += entry->d_reclen;
+
+                    uint32_t tid = 0;
+                    const char* c = entry->d_name;
+                    for (; *c >= '0' && *c <= '9'; ++c) tid = tid * 10 + (*c - '0');
+                    if (*c || !tid || tid == self) continue;
+
+                    if (sent + 1 >= max_threads_) break;
+                    if (::syscall(SYS_tgkill, pid, tid, capture_signal_) == 0) ++sent;
+                }
+            }
+            ::close(dir);
+            return sent;
+        }
+
+        void write_dump_(int signum) {
+            int fd = ::open(dumpname_buf_, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) return;
+
+            // a thread which answered after the timeout may still be filling its slot; leave it out
+            uint32_t claimed = claimed_.load(std::memory_order_relaxed);
+            if (claimed > max_threads_) claimed = max_threads_;
+            uint32_t count = 0;
+            for (uint32_t i = 0; i < claimed; ++i) {
+                count += threads_[i].ready.load(std::memory_order_acquire);
+            }
+
+            btrace_header header;
+            std::memcpy(header.magic, btrace_magic_, sizeof(header.magic));
+            header.version = btrace_version_;
+            header.signal = static_cast<uint16_t>(signum);
+            header.pid = static_cast<uint32_t>(::getpid());
+            header.thread_count = count;
+            bool ok = write_all_(fd, &header, sizeof(header));
+
+            for (uint32_t i = 0; ok && i < claimed; ++i) {
+                auto& slot = threads_[i];
+                if (!slot.ready.load(std::memory_order_acquire)) continue;
+                btrace_thread thread = {slot.tid, slot.count};
+                ok = write_all_(fd, &thread, sizeof(thread));
+                for (uint32_t f = 0; ok && f < slot.count; ++f) {
+                    uint64_t address = reinterpret_cast<uintptr_t>(slot.frames[f]);
+                    ok = write_all_(fd, &address, sizeof(address));
+                }
+            }
+
+            int maps = ok ? ::open("/proc/self/maps", O_RDONLY | O_CLOEXEC) : -1;
+            if (maps >= 0) {
+                char buf[4096];
+                for (;;) {
+                    auto n = ::read(maps, buf, sizeof(buf));
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0 || !write_all_(fd, buf, n)) break;
+                }
+                ::close(maps);
+            }
+            ::close(fd);
+        }
+
+        void capture_signal_handler_(int, siginfo_t*, void*) {
+            if (!crashing_.load(std::memory_order_acquire)) return;
+
+            const int saved_errno = errno;
+            auto index = claimed_.fetch_add(1, std::memory_order_relaxed);
+            if (index < max_threads_) {
+                FC_RECORD_FRAMES(threads_[index]);
+            }
+            captured_.fetch_add(1, std::memory_order_release);
+            errno = saved_errno;
+        }
+
+        void crash_signal_handler_(int signum, siginfo_t*, void*) {
+            if (crashing_.exchange(true, std::memory_order_acq_rel)) {
+                // another thread is already writing the dump and will take the process down
+                for (;;) ::pause();
+            }
+
+            claimed_.store(1, std::memory_order_relaxed);
+            FC_RECORD_FRAMES(threads_[0]);
+            captured_.store(1, std::memory_order_release);
+
+            if (capture_signal_) {
+                const uint32_t expected = 1 + signal_other_threads_(threads_[0].tid);
 
-        void stacktrace_signal_handler_(int signum) {
+                timespec started;
+                ::clock_gettime(CLOCK_MONOTONIC, &started);
+                const timespec pause = {0, 1000000};
+                while (captured_.load(std::memory_order_acquire) < expected && elapsed_ms_(started) < capture_timeout_ms_) {
+                    ::nanosleep(&pause, nullptr);
+                }
+            }
+
+            write_dump_(signum);
+
+            // delivered as soon as the handler returns, with the default action this time
             ::signal(signum, SIG_DFL);
-            boost::stacktrace::safe_dump_to(dumpname_.string().c_str());
-            ::raise(SIGABRT);
+            ::raise(signum);
+        }
+
+        struct mapping {
+            uint64_t start = 0;
+            uint64_t end = 0;
+            uint64_t offset = 0;
+            string   file;
+        };
+
+        // executable file-backed mappings from the text of /proc/<pid>/maps
+        std::vector<mapping> parse_maps_(const string& text) {
+            std::vector<mapping> res;
+            std::istringstream in(text);
+            string line;
+            while (std::getline(in, line)) {
+                char perms[8] = {};
+                unsigned long long start = 0, end = 0, offset = 0;
+                int file_pos = 0;
+                if (std::sscanf(line.c_str(), "%llx-%llx %7s %llx %*s %*s %n", &start, &end, perms, &offset, &file_pos) < 4) continue;
+                if (!file_pos || perms[2] != 'x' || line.c_str()[file_pos] != '/') continue;
+                res.push_back({start, end, offset, line.substr(file_pos)});
+            }
+            return res;
+        }
+
+        string read_self_maps_() {
+            std::ifstream in("/proc/self/maps");
+            return string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+
+        const mapping* find_mapping_(const std::vector<mapping>& maps, uint64_t address) {
+            for (auto& m : maps) {
+                if (address >= m.start && address < m.end) return &m;
+            }
+            return nullptr;
+        }
+
+        // Renders the frames of a dump written by crash_signal_handler_, relocating every address
+        // into the modules loaded by this process
+        string symbolize_dump_(const std::vector<char>& dump) {
+            btrace_header header;
+            if (dump.size() < sizeof(header)) return {};
+            std::memcpy(&header, dump.data(), sizeof(header));
+            if (header.version != btrace_version_) return {};
+
+            struct thread_dump {
+                btrace_thread thread;
+                std::vector<uint64_t> frames;
+            };
+
+            std::vector<thread_dump> threads;
+            std::size_t pos = sizeof(header);
+            for (uint32_t i = 0; i < header.thread_count; ++i) {
+                thread_dump t;
+                if (dump.size() - pos < sizeof(t.thread)) return {};
+                std::memcpy(&t.thread, dump.data() + pos, sizeof(t.thread));
+                pos += sizeof(t.thread);
+
+                if ((dump.size() - pos) / sizeof(uint64_t) < t.thread.frame_count) return {};
+                t.frames.resize(t.thread.frame_count);
+                std::memcpy(t.frames.data(), dump.data() + pos, t.frames.size() * sizeof(uint64_t));
+                pos += t.frames.size() * sizeof(uint64_t);
+
+                threads.push_back(std::move(t));
+            }
+
+            const auto crashed_maps = parse_maps_(string(dump.data() + pos, dump.size() - pos));
+            const auto own_maps = parse_maps_(read_self_maps_());
+
+            string res;
+            for (std::size_t t = 0; t < threads.size(); ++t) {
+                res += "Thread ";
+                res += fc::to_string(uint64_t(threads[t].thread.tid));
+                if (t == 0) {
+                    res += " (crashed with signal ";
+                    res += fc::to_string(uint64_t(header.signal));
+                    res += ')';
+                }
+                res += ":\n";
+
+                auto& frames = threads[t].frames;
+                for (std::size_t i = 0; i < frames.size(); ++i) {
+                    if (i < 10) res += ' ';
+                    res += fc::to_string(uint64_t(i));
+                    res += "# ";
+
+                    auto crashed = find_mapping_(crashed_maps, frames[i]);
+                    if (!crashed) {
+                        char buf[32];
+                        std::snprintf(buf, sizeof(buf), "0x%llx", static_cast<unsigned long long>(frames[i]));
+                        res += buf;
+                        res += '\n';
+                        continue;
+                    }
+
+                    const uint64_t file_offset = frames[i] - crashed->start + crashed->offset;
+                    const void* relocated = nullptr;
+                    for (auto& m : own_maps) {
+                        if (m.file == crashed->file && file_offset >= m.offset && file_offset < m.offset + (m.end - m.start)) {
+                            relocated = reinterpret_cast<const void*>(m.start + (file_offset - m.offset));
+                            break;
+                        }
+                    }
+
+                    if (relocated) {
+                        res += detail::symbolize(relocated);
+                    } else {
+                        // not loaded here; enough for `addr2line -e <file>` when the segment is mapped at its file offset
+                        char buf[32];
+                        std::snprintf(buf, sizeof(buf), "+0x%llx", static_cast<unsigned long long>(file_offset));
+                        res += crashed->file;
+                        res += buf;
+                    }
+                    res += '\n';
+                }
+            }
+            return res;
         }
     }
 
@@ -42,11 +355,16 @@ namespace fc {
         if (!has_btrace(filename)) return {};
 
         // there is a btrace
-        auto stream = std::ifstream(filename.string());
-        auto btrace = stacktrace::from_dump(stream);
-
-        // cleaning up
+        std::ifstream stream(filename.string(), std::ios::binary);
+        std::vector<char> dump((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
         stream.close();
+
+        if (dump.size() >= sizeof(btrace_magic_) && !std::memcmp(dump.data(), btrace_magic_, sizeof(btrace_magic_))) {
+            return symbolize_dump_(dump);
+        }
+
+        // a plain boost::stacktrace dump, as written by earlier versions
+        auto btrace = stacktrace::from_dump(dump.data(), dump.size());
         return to_detail_string(btrace);
     } catch (...) {
         return {};
@@ -72,6 +390,8 @@ namespace fc {
         installed = true;
 
         dumpname_ = filename;
+        std::strncpy(dumpname_buf_, dumpname_.string().c_str(), sizeof(dumpname_buf_) - 1);
+
         if (has_btrace()) {
             std::cerr
                 << std::endl
@@ -82,7 +402,29 @@ namespace fc {
             remove_btrace();
         }
 
-        ::signal(SIGSEGV, &stacktrace_signal_handler_);
-        ::signal(SIGABRT, &stacktrace_signal_handler_);
+        // lets the installing thread report a stack overflow
+        stack_t altstack = {};
+        altstack.ss_sp = altstack_;
+        altstack.ss_size = sizeof(altstack_);
+        ::sigaltstack(&altstack, nullptr);
+
+        struct sigaction action = {};
+        ::sigemptyset(&action.sa_mask);
+
+        // the other threads are only walked if nobody else claimed the signal
+        struct sigaction current = {};
+        if (::sigaction(SIGRTMIN + 5, nullptr, &current) == 0 && current.sa_handler == SIG_DFL) {
+            action.sa_sigaction = &capture_signal_handler_;
+            action.sa_flags = SA_SIGINFO | SA_RESTART;
+            if (::sigaction(SIGRTMIN + 5, &action, nullptr) == 0) {
+                capture_signal_ = SIGRTMIN + 5;
+            }
+        }
+
+        action.sa_sigaction = &crash_signal_handler_;
+        action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+        for (int signum : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT}) {
+            ::sigaction(signum, &action, nullptr);
+        }
     }
-}
\ No newline at end of file
+}
@@ -1,6 +1,10 @@
 #include <algorithm>
+#include <charconv>
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <limits>
+#include <unordered_map>
 
 #include <boost/scoped_array.hpp>
 
@@ -729,89 +733,253 @@ void from_variant( const variant& v, UInt<64>& n ) { n = v.as_uint64(); }
 constexpr size_t minimize_max_size = 1024;
 constexpr size_t minimize_sub_max_size = minimize_max_size / 4;
 
-string format_string( const string& frmt, const variant_object& args, bool minimize )
-{
-   std::string result;
-   const string& format = ( minimize && frmt.size() > minimize_max_size ) ?
-         frmt.substr( 0, minimize_max_size ) + "..." : frmt;
-   result.reserve( minimize_sub_max_size );
-   size_t prev = 0;
-   size_t next = format.find( '$' );
-   while( prev != string::npos && prev < format.size() ) {
-      if( next != string::npos ) {
-         result += format.substr( prev, next - prev );
-      } else {
-         result += format.substr( prev );
+namespace detail {
+
+   /**
+    *  A run of literal text of a format string and what follows it.  Every '$' in the
+    *  format ends a segment; '${key}' is a placeholder, a '$' followed by anything else
+    *  is dropped and the next segment starts right after it.
+    */
+   struct format_segment {
+      enum kind_type : uint8_t {
+         end,         ///< nothing follows the literal
+         check,       ///< a '$' that's not a placeholder, only the minimize limit is checked
+         placeholder, ///< a '${key}'
+         terminator   ///< a trailing '$', which has always produced a '\0'
+      };
+
+      uint32_t  literal_begin = 0;
+      uint32_t  literal_size  = 0;
+      uint32_t  key_begin     = 0;
+      uint32_t  key_size      = 0;
+      kind_type kind          = end;
+      uint32_t  slot_hint     = 0; ///< where the key was found in the args last time
+   };
+
+   /**
+    *  Splits @p format into segments, calling @p visit for each one until it returns false.
+    *  The segments refer to @p format, which must stay alive while they are used.
+    */
+   template<typename Visitor>
+   void parse_format( std::string_view format, Visitor&& visit ) {
+      size_t prev = 0;
+      size_t next = format.find( '$' );
+      while( prev < format.size() ) {
+         format_segment seg;
+         seg.literal_begin = prev;
+         seg.literal_size = (next == string::npos ? format.size() : next) - prev;
+         if( next == string::npos ) {
+            visit( seg );
+            return;
+         }
+
+         prev = next + 1;
+         if( prev < format.size() && format[prev] == '{' ) {
+            next = format.find( '}', prev );
+            if( next != string::npos ) {
+               seg.kind = format_segment::placeholder;
+               seg.key_begin = prev + 1;
+               seg.key_size = next - prev - 1;
+               if( !visit( seg ) ) return;
+               prev = next + 1;
+               next = format.find( '$', prev );
+            } else {
+               // an unterminated '${' drops the '$' and keeps the rest as is
+               seg.kind = format_segment::check;
+               if( !visit( seg ) ) return;
+            }
+         } else {
+            seg.kind = format_segment::check;
+            if( !visit( seg ) ) return;
+            if( prev == format.size() ) {
+               format_segment terminator;
+               terminator.literal_begin = prev;
+               terminator.kind = format_segment::terminator;
+               visit( terminator );
+               return;
+            }
+            // the character after '$' starts the next literal
+            next = format.find( '$', prev + 1 );
+         }
       }
+   }
 
-      // if we got to the end, return it.
-      if( next == string::npos ) {
-         return result;
-      } else if( minimize && result.size() > minimize_max_size ) {
-         result += "...";
-         return result;
+   static const variant_object::entry* find_arg( const variant_object& args, std::string_view key, uint32_t& hint ) {
+      const size_t size = args.size();
+      // arguments usually come in the same order every time a format is used
+      if( hint < size ) {
+         const auto& e = args.begin()[hint];
+         if( e.key() == key ) return &e;
+      }
+      for( size_t i = 0; i < size; ++i ) {
+         const auto& e = args.begin()[i];
+         if( e.key() == key ) {
+            hint = i;
+            return &e;
+         }
       }
+      return nullptr;
+   }
 
-      // if we are not at the end, then update the start
-      prev = next + 1;
-
-      if( format[prev] == '{' ) {
-         // if the next char is a open, then find close
-         next = format.find( '}', prev );
-         // if we found close...
-         if( next != string::npos ) {
-            // the key is between prev and next
-            string key = format.substr( prev + 1, (next - prev - 1) );
-
-            auto val = args.find( key );
-            bool replaced = true;
-            if( val != args.end() ) {
-               if( val->value().is_object() || val->value().is_array() ) {
-                  if( minimize ) {
-                     replaced = false;
-                  } else {
-                     result += json::to_string( val->value() );
-                  }
-               } else if( val->value().is_blob() ) {
-                  if( minimize && val->value().get_blob().data.size() > minimize_sub_max_size ) {
-                     replaced = false;
-                  } else {
-                     result += val->value().as_string();
-                  }
-               } else if( val->value().is_string() ) {
-                  if( minimize && val->value().get_string().size() > minimize_sub_max_size ) {
-                     auto sz = std::min( minimize_sub_max_size, minimize_max_size - result.size() );
-                     result += val->value().get_string().substr( 0, sz );
-                     result += "...";
-                  } else {
-                     result += val->value().get_string();
-                  }
-               } else {
-                  result += val->value().as_string();
-               }
+   /// @return false if the value is left out and the placeholder should be kept instead
+   static bool append_arg( std::string& out, size_t start, const variant& v, bool minimize ) {
+      switch( v.get_type() ) {
+         case variant::type_id::object_type:
+         case variant::type_id::array_type:
+            if( minimize ) return false;
+            out += json::to_string( v );
+            return true;
+         case variant::type_id::blob_type:
+            if( minimize && v.get_blob().data.size() > minimize_sub_max_size ) return false;
+            out += v.as_string();
+            return true;
+         case variant::type_id::string_type: {
+            const auto& str = v.get_string();
+            if( minimize && str.size() > minimize_sub_max_size ) {
+               auto sz = std::min( minimize_sub_max_size, minimize_max_size - (out.size() - start) );
+               out.append( str, 0, sz );
+               out += "...";
             } else {
-               replaced = false;
+               out += str;
             }
-            if( !replaced ) {
-               result += "${";
-               result += key;
-               result += "}";
-            }
-            prev = next + 1;
-            // find the next $
-            next = format.find( '$', prev );
-         } else {
-            // we didn't find it.. continue to while...
+            return true;
+         }
+         case variant::type_id::int64_type:
+         case variant::type_id::uint64_type: {
+            char buf[24];
+            auto res = v.get_type() == variant::type_id::int64_type ? std::to_chars( buf, buf + sizeof(buf), v.as_int64() )
+                                                           : std::to_chars( buf, buf + sizeof(buf), v.as_uint64() );
+            out.append( buf, res.ptr );
+            return true;
+         }
+         default:
+            out += v.as_string();
+            return true;
+      }
+   }
+
+   /// @return false once the output is complete
+   static bool append_segment( std::string& out, size_t start, const char* format, format_segment& seg,
+                               const variant_object& args, bool minimize ) {
+      out.append( format + seg.literal_begin, seg.literal_size );
+      if( seg.kind == format_segment::end )
+         return false;
+      if( seg.kind == format_segment::terminator ) {
+         out += '\0';
+         return false;
+      }
+      if( minimize && out.size() - start > minimize_max_size ) {
+         out += "...";
+         return false;
+      }
+      if( seg.kind == format_segment::placeholder ) {
+         std::string_view key( format + seg.key_begin, seg.key_size );
+         auto arg = find_arg( args, key, seg.slot_hint );
+         if( !arg || !append_arg( out, start, arg->value(), minimize ) ) {
+            out += "${";
+            out.append( key.data(), key.size() );
+            out += "}";
          }
-      } else {
-         result += format[prev];
-         ++prev;
-         next = format.find( '$', prev );
       }
+      return true;
    }
+
+   static void append_format( std::string& out, std::string_view format, const variant_object& args, bool minimize ) {
+      const size_t start = out.size();
+      string truncated;
+      if( minimize && format.size() > minimize_max_size ) {
+         truncated.assign( format.data(), minimize_max_size );
+         truncated += "...";
+         format = truncated;
+      }
+      parse_format( format, [&]( format_segment& seg ) {
+         return append_segment( out, start, format.data(), seg, args, minimize );
+      } );
+   }
+
+   /// a format string split into segments once and reused for every message using it
+   struct compiled_format {
+      string                      format; ///< a copy, the segments refer to it
+      std::vector<format_segment> segments;
+
+      void compile( const char* f, size_t size ) {
+         format.assign( f, size );
+         segments.clear();
+         parse_format( format, [&]( const format_segment& seg ) {
+            segments.push_back( seg );
+            return true;
+         } );
+      }
+
+      void append( std::string& out, const variant_object& args, bool minimize ) {
+         const size_t start = out.size();
+         for( auto& seg : segments )
+            if( !append_segment( out, start, format.c_str(), seg, args, minimize ) )
+               return;
+      }
+   };
+
+   // bounds the cache in case it's fed formats that aren't literals
+   constexpr size_t max_compiled_formats = 4096;
+
+   /// @return the compiled @p format, cached under @p key, nullptr if it can't be cached
+   static compiled_format* get_compiled_format( const void* key, const char* format, size_t size ) {
+      // per thread, so formatting never takes a lock
+      static thread_local std::unordered_map<const void*, compiled_format> cache;
+
+      auto itr = cache.find( key );
+      if( itr != cache.end() ) {
+         auto& compiled = itr->second;
+         // the same address can hold a different string, e.g. a char array on the stack
+         if( compiled.format.size() != size || memcmp( compiled.format.data(), format, size ) != 0 )
+            compiled.compile( format, size );
+         return &compiled;
+      }
+      if( cache.size() >= max_compiled_formats )
+         return nullptr;
+
+      auto& compiled = cache[key];
+      compiled.compile( format, size );
+      return &compiled;
+   }
+
+   static void append_cached_format( std::string& out, const void* key, const char* format, size_t size,
+                                     const variant_object& args, bool minimize ) {
+      // the truncated form of long formats is not worth caching
+      if( !(minimize && size > minimize_max_size) ) {
+         if( auto compiled = get_compiled_format( key, format, size ) ) {
+            compiled->append( out, args, minimize );
+            return;
+         }
+      }
+      append_format( out, std::string_view( format, size ), args, minimize );
+   }
+
+} // namespace detail
+
+string format_string( const string& frmt, const variant_object& args, bool minimize )
+{
+   std::string result;
+   result.reserve( frmt.size() + 64 );
+   detail::append_format( result, frmt, args, minimize );
    return result;
 }
 
+void append_format_string( std::string& out, const string& format, const variant_object& args, bool minimize )
+{
+   detail::append_format( out, format, args, minimize );
+}
+
+void append_format_string( std::string& out, const char* format, size_t size, const variant_object& args, bool minimize )
+{
+   detail::append_cached_format( out, format, format, size, args, minimize );
+}
+
+void append_format_string( std::string& out, const void* key, const string& format, const variant_object& args, bool minimize )
+{
+   detail::append_cached_format( out, key, format.data(), format.size(), args, minimize );
+}
+
    #ifdef __APPLE__
    #elif !defined(_MSC_VER)
    void to_variant( long long int s, variant& v ) { v = variant( int64_t(s) ); }
@@ -298,6 +298,13 @@ namespace fc
        reserve(100);
    }
 
+   mutable_variant_object mutable_variant_object::with_capacity( size_t capacity )
+   {
+      std::unique_ptr<std::vector<entry>> key_value( new std::vector<entry>() );
+      key_value->reserve( capacity );
+      return mutable_variant_object( std::move(key_value) );
+   }
+
    mutable_variant_object::mutable_variant_object( string key, variant val )
       : _key_value(new std::vector<entry>())
    {
@@ -0,0 +1,736 @@
+#define BOOST_TEST_MODULE compress
+#include <boost/test/included/unit_test.hpp>
+
+#include <fc/compress/dictionary.hpp>
+#include <fc/compress/lz4.hpp>
+#include <fc/compress/parallel_zlib.hpp>
+#include <fc/compress/zlib.hpp>
+#include <fc/crypto/crc32c.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/time.hpp>
+
+#include <iostream>
+#include <thread>
+
+using namespace fc;
+
+namespace compress_test {
+   struct action {
+      uint64_t                  account = 0;
+      uint64_t                  name = 0;
+      std::vector<uint64_t>     authorization;
+      std::vector<char>         data;
+   };
+
+   struct transaction {
+      fc::time_point_sec        expiration;
+      uint16_t                  ref_block_num = 0;
+      uint32_t                  ref_block_prefix = 0;
+      std::vector<action>       actions;
+      std::string               memo;
+   };
+
+   uint64_t next_random( uint64_t& x ) {
+      x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+      return x;
+   }
+
+   std::vector<char> random_bytes( size_t size, uint64_t seed = 0x9e3779b97f4a7c15ull ) {
+      std::vector<char> data( size );
+      for( auto& c : data ) c = char( next_random( seed ) );
+      return data;
+   }
+
+   // raw::pack'd transactions, the kind of data that goes into snapshots and block logs
+   std::vector<transaction> make_transactions( size_t count ) {
+      static const char* memos[] = { "transfer", "payout for post", "", "vesting withdrawal", "daily reward" };
+      std::vector<transaction> trxs( count );
+      uint64_t seed = 42;
+      for( size_t i = 0; i < count; ++i ) {
+         auto& trx = trxs[i];
+         trx.expiration = fc::time_point_sec( 1500000000 + uint32_t( i / 10 ) );
+         trx.ref_block_num = uint16_t( i / 20 );
+         trx.ref_block_prefix = uint32_t( next_random( seed ) );
+         trx.memo = memos[i % 5];
+         for( size_t a = 0; a <= i % 3; ++a ) {
+            action act;
+            act.account = 0x5530ea0000000000ull + next_random( seed ) % 16;
+            act.name = 0xcd4d7a8000000000ull + a;
+            act.authorization = { act.account };
+            act.data.resize( 16 + i % 48 );
+            for( size_t b = 0; b < act.data.size(); ++b )
+               act.data[b] = b < 8 ? char( next_random( seed ) ) : char( 'a' + b % 7 );
+            trx.actions.push_back( std::move( act ) );
+         }
+      }
+      return trxs;
+   }
+
+   std::vector<char> make_corpus( size_t count ) {
+      return fc::raw::pack( make_transactions( count ) );
+   }
+
+   // GELF records as the logger would send them, a few hundred bytes each
+   std::vector<std::string> make_log_records( size_t count, uint64_t seed = 99 ) {
+      static const char* hosts[] = { "node-1.golos.io", "node-2.golos.io", "seed.cyberway.io" };
+      static const char* messages[] = { "block applied", "transaction pushed", "peer connected", "peer disconnected",
+                                        "signature verified", "producing block" };
+      static const char* files[] = { "chain_controller.cpp", "net_plugin.cpp", "producer_plugin.cpp" };
+      std::vector<std::string> records;
+      for( size_t i = 0; i < count; ++i ) {
+         records.push_back( std::string( "{\"version\":\"1.1\",\"host\":\"" ) + hosts[next_random( seed ) % 3] +
+                            "\",\"short_message\":\"" + messages[next_random( seed ) % 6] + " #" + std::to_string( next_random( seed ) % 100000 ) +
+                            "\",\"timestamp\":" + std::to_string( 1500000000 + i ) + "." + std::to_string( next_random( seed ) % 1000 ) +
+                            ",\"level\":" + std::to_string( next_random( seed ) % 8 ) +
+                            ",\"_thread_name\":\"thread-" + std::to_string( next_random( seed ) % 4 ) +
+                            "\",\"_file\":\"" + files[next_random( seed ) % 3] + "\",\"_line\":" + std::to_string( next_random( seed ) % 2000 ) +
+                            ",\"_method_name\":\"apply_block\",\"_task_name\":\"application\"}" );
+      }
+      return records;
+   }
+}
+
+FC_REFLECT( compress_test::action, (account)(name)(authorization)(data) )
+FC_REFLECT( compress_test::transaction, (expiration)(ref_block_num)(ref_block_prefix)(actions)(memo) )
+
+using namespace compress_test;
+
+BOOST_AUTO_TEST_SUITE(compress_test_suite)
+
+BOOST_AUTO_TEST_CASE(zlib_round_trip) try {
+   const auto corpus = make_corpus( 2000 );
+   const auto noise = random_bytes( 100000 );
+   for( const auto* input : { &corpus, &noise } ) {
+      for( int level = 0; level <= 10; ++level ) {
+         std::vector<char> compressed, decompressed;
+         zlib_compress( input->data(), input->size(), compressed, level );
+         zlib_decompress( compressed.data(), compressed.size(), decompressed );
+         BOOST_CHECK( decompressed == *input );
+      }
+   }
+
+   std::vector<char> compressed, decompressed;
+   zlib_compress( nullptr, 0, compressed );
+   zlib_decompress( compressed.data(), compressed.size(), decompressed );
+   BOOST_CHECK( decompressed.empty() );
+
+   const std::string text = "the quick brown fox jumps over the lazy dog, the quick brown fox jumps over the lazy dog";
+   BOOST_CHECK_EQUAL( zlib_decompress( zlib_compress( text ) ), text );
+   BOOST_CHECK_LT( zlib_compress( text ).size(), text.size() );
+   BOOST_CHECK_THROW( zlib_compress( text.data(), text.size(), compressed, 11 ), fc::assert_exception );
+
+   // straight into a buffer of known size
+   zlib_compress( corpus.data(), corpus.size(), compressed );
+   decompressed.resize( corpus.size() );
+   BOOST_CHECK_EQUAL( zlib_decompress( compressed.data(), compressed.size(), decompressed.data(), decompressed.size() ), corpus.size() );
+   BOOST_CHECK( decompressed == corpus );
+   BOOST_CHECK_THROW( zlib_decompress( compressed.data(), compressed.size(), decompressed.data(), corpus.size() - 1 ),
+                      fc::parse_error_exception );
+   BOOST_CHECK_THROW( zlib_decompress( compressed.data(), compressed.size() / 2, decompressed.data(), decompressed.size() ),
+                      fc::eof_exception );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(zlib_streaming) try {
+   const auto corpus = make_corpus( 3000 );
+   uint64_t seed = 7;
+
+   // pieces of every size in, with a flush now and then
+   zlib_compressor compressor( 3 );
+   std::vector<char> compressed;
+   for( size_t pos = 0; pos < corpus.size(); ) {
+      const size_t n = std::min<size_t>( next_random( seed ) % 5000, corpus.size() - pos );
+      compressor.write( corpus.data() + pos, n, compressed );
+      pos += n;
+      if( next_random( seed ) % 8 == 0 ) compressor.flush( compressed );
+   }
+   compressor.finish( compressed );
+   BOOST_CHECK_THROW( compressor.write( corpus.data(), 1, compressed ), fc::assert_exception );
+
+   std::vector<char> decompressed;
+   zlib_decompress( compressed.data(), compressed.size(), decompressed );
+   BOOST_CHECK( decompressed == corpus );
+
+   // and out, including a byte at a time
+   zlib_decompressor decompressor;
+   for( size_t step : { size_t( 1 ), size_t( 333 ), compressed.size() } ) {
+      decompressor.reset();
+      decompressed.clear();
+      bool done = false;
+      for( size_t pos = 0; pos < compressed.size(); pos += step ) {
+         BOOST_REQUIRE( !done );
+         done = decompressor.write( compressed.data() + pos, std::min( step, compressed.size() - pos ), decompressed );
+      }
+      BOOST_CHECK( done && decompressor.finished() );
+      BOOST_CHECK( decompressed == corpus );
+   }
+
+   // a flush makes everything written so far decompressible
+   compressor.reset( zlib_default_level );
+   compressed.clear();
+   compressor.write( corpus.data(), 1000, compressed );
+   compressor.flush( compressed );
+   decompressor.reset();
+   decompressed.clear();
+   BOOST_CHECK( !decompressor.write( compressed.data(), compressed.size(), decompressed ) );
+   BOOST_CHECK( decompressed == std::vector<char>( corpus.begin(), corpus.begin() + 1000 ) );
+
+   // compress() starts over, even in the middle of a stream
+   compressor.compress( corpus.data(), corpus.size(), compressed );
+   zlib_decompress( compressed.data(), compressed.size(), decompressed );
+   BOOST_CHECK( decompressed == corpus );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(zlib_pack_stream) try {
+   const auto trxs = make_transactions( 500 );
+   std::vector<char> compressed;
+   zlib_compress_stream stream( compressed, 1 );
+   fc::raw::pack( stream, trxs );
+   stream.finish();
+
+   std::vector<char> packed;
+   zlib_decompress( compressed.data(), compressed.size(), packed );
+   BOOST_CHECK( packed == fc::raw::pack( trxs ) );
+   BOOST_CHECK_LT( compressed.size(), packed.size() / 2 );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(zlib_bad_input) try {
+   const auto corpus = make_corpus( 500 );
+   std::vector<char> compressed, out;
+   zlib_compress( corpus.data(), corpus.size(), compressed );
+
+   BOOST_CHECK_THROW( zlib_decompress( compressed.data(), compressed.size() - 10, out ), fc::eof_exception );
+
+   auto corrupt = compressed;
+   corrupt[corrupt.size() / 2] ^= 0x55;
+   BOOST_CHECK_THROW( zlib_decompress( corrupt.data(), corrupt.size(), out ), fc::exception );
+   corrupt = compressed;
+   corrupt.back() ^= 1; // the adler32 trailer
+   BOOST_CHECK_THROW( zlib_decompress( corrupt.data(), corrupt.size(), out ), fc::parse_error_exception );
+
+   zlib_decompressor decompressor;
+   BOOST_CHECK( decompressor.write( compressed.data(), compressed.size(), out ) );
+   BOOST_CHECK( decompressor.write( compressed.data(), 0, out ) );
+   BOOST_CHECK_THROW( decompressor.write( compressed.data(), 1, out ), fc::assert_exception );
+
+   const auto noise = random_bytes( 1000 );
+   BOOST_CHECK_THROW( zlib_decompress( noise.data(), noise.size(), out ), fc::exception );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(zlib_size_limit) try {
+   // a few KB that inflate past MAX_SIZE_OF_BYTE_ARRAYS
+   const std::vector<char> zeros( MAX_SIZE_OF_BYTE_ARRAYS + 1024 * 1024, 0 );
+   std::vector<char> bomb, out;
+   zlib_compress( zeros.data(), zeros.size(), bomb, 9 );
+   BOOST_REQUIRE_LT( bomb.size(), 64 * 1024u );
+   BOOST_CHECK_THROW( zlib_decompress( bomb.data(), bomb.size(), out ), fc::parse_error_exception );
+   BOOST_CHECK( out.empty() );
+   BOOST_CHECK_LE( out.capacity(), size_t( MAX_SIZE_OF_BYTE_ARRAYS ) );
+   BOOST_CHECK_THROW( zlib_decompress( std::string( bomb.data(), bomb.size() ) ), fc::parse_error_exception );
+   zlib_decompress( bomb.data(), bomb.size(), out, zeros.size() );
+   BOOST_CHECK( out == zeros );
+
+   zlib_decompressor decompressor;
+   out.clear();
+   BOOST_CHECK_THROW( decompressor.write( bomb.data(), bomb.size(), out ), fc::parse_error_exception );
+   BOOST_CHECK_LE( out.size(), size_t( MAX_SIZE_OF_BYTE_ARRAYS ) );
+
+   // the limit is on the whole stream, however it is fed in
+   std::vector<char> compressed;
+   zlib_compress( zeros.data(), 100000, compressed );
+   zlib_decompressor limited( 99999 );
+   out.clear();
+   BOOST_CHECK_THROW( for( size_t pos = 0; pos < compressed.size(); ++pos ) limited.write( compressed.data() + pos, 1, out ),
+                      fc::parse_error_exception );
+   BOOST_CHECK_THROW( limited.decompress( compressed.data(), compressed.size(), out ), fc::parse_error_exception );
+   limited = zlib_decompressor( 100000 );
+   limited.decompress( compressed.data(), compressed.size(), out );
+   BOOST_CHECK_EQUAL( out.size(), 100000u );
+   limited.reset();
+   out.clear();
+   BOOST_CHECK( limited.write( compressed.data(), compressed.size(), out ) );
+   BOOST_CHECK_EQUAL( out.size(), 100000u );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(zlib_benchmark, * boost::unit_test::disabled()) try {
+   const auto corpus = make_corpus( 100000 );
+   std::cerr << "corpus: " << corpus.size() << " bytes of packed transactions\n";
+
+   std::vector<char> compressed, decompressed;
+   for( int level : { 0, 1, 3, 6, 9 } ) {
+      const int rounds = 3;
+      auto start = time_point::now();
+      for( int i = 0; i < rounds; ++i )
+         zlib_compress( corpus.data(), corpus.size(), compressed, level );
+      auto deflate = time_point::now() - start;
+
+      start = time_point::now();
+      for( int i = 0; i < rounds; ++i )
+         zlib_decompress( compressed.data(), compressed.size(), decompressed );
+      auto inflate = time_point::now() - start;
+      BOOST_CHECK( decompressed == corpus );
+
+      std::cerr << "level " << level << ": ratio " << double( corpus.size() ) / compressed.size()
+                << ", compress " << double( rounds * corpus.size() ) / deflate.count() << " MB/s"
+                << ", decompress " << double( rounds * corpus.size() ) / inflate.count() << " MB/s\n";
+   }
+
+   // many small messages, where setting up the compressor state used to dominate
+   const size_t messages = 20000;
+   auto start = time_point::now();
+   for( size_t i = 0; i < messages; ++i )
+      zlib_compress( corpus.data() + i * 37, 512, compressed, 1 );
+   std::cerr << "512-byte messages at level 1: " << ( time_point::now() - start ).count() * 1000.0 / messages << " ns each\n";
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(lz4_block_round_trip) try {
+   std::vector<std::vector<char>> inputs = { make_corpus( 2000 ), random_bytes( 100000 ), std::vector<char>( 100000, 'x' ) };
+   // runs with every short period, which the decoder copies specially
+   for( size_t period = 1; period <= 20; ++period ) {
+      std::vector<char> run( 1000 );
+      for( size_t i = 0; i < run.size(); ++i ) run[i] = char( 'a' + i % period );
+      inputs.push_back( run );
+   }
+   for( size_t size = 0; size < 40; ++size )
+      inputs.emplace_back( inputs[0].begin(), inputs[0].begin() + size );
+
+   for( const auto& input : inputs ) {
+      std::vector<char> compressed( lz4_block_bound( input.size() ) ), decompressed( input.size() );
+      compressed.resize( lz4_compress_block( input.data(), input.size(), compressed.data() ) );
+      BOOST_REQUIRE_EQUAL( lz4_decompress_block( compressed.data(), compressed.size(), decompressed.data(), decompressed.size() ),
+                           input.size() );
+      BOOST_CHECK( decompressed == input );
+      if( input.size() > 1 )
+         BOOST_CHECK_THROW( lz4_decompress_block( compressed.data(), compressed.size(), decompressed.data(), input.size() - 1 ),
+                            fc::parse_error_exception );
+   }
+   BOOST_CHECK_LT( lz4_block_bound( 0 ), 20u );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(lz4_block_format) try {
+   // written by hand from the format description: one 'a', a 15 byte match one back, five literals
+   const char block[] = { 0x1b, 'a', 0x01, 0x00, 0x50, 'a', 'a', 'a', 'a', 'a' };
+   char out[32];
+   BOOST_REQUIRE_EQUAL( lz4_decompress_block( block, sizeof(block), out, sizeof(out) ), 21u );
+   BOOST_CHECK_EQUAL( std::string( out, 21 ), std::string( 21, 'a' ) );
+
+   // offsets before the start, offset 0 and blocks cut short
+   const char before_start[] = { 0x10, 'a', 0x02, 0x00, 0x00 };
+   BOOST_CHECK_THROW( lz4_decompress_block( before_start, sizeof(before_start), out, sizeof(out) ), fc::parse_error_exception );
+   const char zero_offset[] = { 0x10, 'a', 0x00, 0x00, 0x00 };
+   BOOST_CHECK_THROW( lz4_decompress_block( zero_offset, sizeof(zero_offset), out, sizeof(out) ), fc::parse_error_exception );
+   // (cut right after the first literal it would still be a valid block)
+   for( size_t size : { 0, 1, 3, 4, 5, 8 } )
+      BOOST_CHECK_THROW( lz4_decompress_block( block, size, out, sizeof(out) ), fc::parse_error_exception );
+
+   // whatever a damaged block decodes to, it stays inside the output
+   const auto corpus = make_corpus( 300 );
+   std::vector<char> compressed( lz4_block_bound( corpus.size() ) ), decompressed( corpus.size() );
+   compressed.resize( lz4_compress_block( corpus.data(), corpus.size(), compressed.data() ) );
+   uint64_t seed = 3;
+   for( int i = 0; i < 2000; ++i ) {
+      auto damaged = compressed;
+      damaged[next_random( seed ) % damaged.size()] ^= char( 1 + next_random( seed ) % 255 );
+      try {
+         BOOST_CHECK_LE( lz4_decompress_block( damaged.data(), damaged.size(), decompressed.data(), decompressed.size() ),
+                         decompressed.size() );
+      } catch( const fc::parse_error_exception& ) {
+      }
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(lz4_frame_round_trip) try {
+   const auto corpus = make_corpus( 5000 );
+   const auto noise = random_bytes( 200000 );
+   for( const auto* input : { &corpus, &noise } ) {
+      for( size_t block_size : { lz4_default_block_size, size_t( 1 ) << 20, lz4_max_block_size } ) {
+         std::vector<char> compressed, decompressed;
+         lz4_compress( input->data(), input->size(), compressed, block_size );
+         lz4_decompress( compressed.data(), compressed.size(), decompressed );
+         BOOST_CHECK( decompressed == *input );
+      }
+   }
+
+   // blocks that don't shrink are stored, so noise costs a few bytes per block
+   std::vector<char> compressed, decompressed;
+   lz4_compress( noise.data(), noise.size(), compressed );
+   BOOST_CHECK_LE( compressed.size(), noise.size() + 6 + 4 * 8 + 8 );
+   lz4_compress( corpus.data(), corpus.size(), compressed );
+   BOOST_CHECK_LT( compressed.size(), corpus.size() / 2 );
+
+   lz4_compress( nullptr, 0, compressed );
+   BOOST_CHECK_EQUAL( compressed.size(), 6u + 8u );
+   lz4_decompress( compressed.data(), compressed.size(), decompressed );
+   BOOST_CHECK( decompressed.empty() );
+
+   BOOST_CHECK_THROW( lz4_compressor( 1000 ), fc::assert_exception );
+   BOOST_CHECK_THROW( lz4_compressor( 8 << 20 ), fc::assert_exception );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(lz4_streaming) try {
+   const auto corpus = make_corpus( 3000 );
+   uint64_t seed = 11;
+
+   lz4_compressor compressor;
+   std::vector<char> compressed;
+   for( size_t pos = 0; pos < corpus.size(); ) {
+      const size_t n = std::min<size_t>( next_random( seed ) % 100000, corpus.size() - pos );
+      compressor.write( corpus.data() + pos, n, compressed );
+      pos += n;
+      if( next_random( seed ) % 8 == 0 ) compressor.flush( compressed );
+   }
+   compressor.finish( compressed );
+   BOOST_CHECK_THROW( compressor.write( corpus.data(), 1, compressed ), fc::assert_exception );
+
+   std::vector<char> decompressed;
+   lz4_decompress( compressed.data(), compressed.size(), decompressed );
+   BOOST_CHECK( decompressed == corpus );
+
+   lz4_decompressor decompressor;
+   for( size_t step : { size_t( 1 ), size_t( 333 ), size_t( 70000 ), compressed.size() } ) {
+      decompressor.reset();
+      decompressed.clear();
+      bool done = false;
+      for( size_t pos = 0; pos < compressed.size(); pos += step ) {
+         BOOST_REQUIRE( !done );
+         done = decompressor.write( compressed.data() + pos, std::min( step, compressed.size() - pos ), decompressed );
+      }
+      BOOST_CHECK( done && decompressor.finished() );
+      BOOST_CHECK( decompressed == corpus );
+   }
+
+   // a flush makes everything written so far decompressible
+   compressor.reset();
+   compressed.clear();
+   compressor.write( corpus.data(), 1000, compressed );
+   compressor.flush( compressed );
+   decompressor.reset();
+   decompressed.clear();
+   BOOST_CHECK( !decompressor.write( compressed.data(), compressed.size(), decompressed ) );
+   BOOST_CHECK( decompressed == std::vector<char>( corpus.begin(), corpus.begin() + 1000 ) );
+
+   compressor.compress( corpus.data(), corpus.size(), compressed );
+   lz4_decompress( compressed.data(), compressed.size(), decompressed );
+   BOOST_CHECK( decompressed == corpus );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(lz4_bad_input) try {
+   const auto corpus = make_corpus( 2000 );
+   std::vector<char> compressed, out;
+   lz4_compress( corpus.data(), corpus.size(), compressed );
+
+   for( size_t size : { size_t( 0 ), size_t( 3 ), size_t( 6 ), size_t( 100 ), compressed.size() - 4, compressed.size() - 1 } )
+      BOOST_CHECK_THROW( lz4_decompress( compressed.data(), size, out ), fc::eof_exception );
+
+   auto corrupt = compressed;
+   corrupt[0] = 'x';
+   BOOST_CHECK_THROW( lz4_decompress( corrupt.data(), corrupt.size(), out ), fc::parse_error_exception );
+   corrupt = compressed;
+   corrupt[5] = 30; // block size
+   BOOST_CHECK_THROW( lz4_decompress( corrupt.data(), corrupt.size(), out ), fc::parse_error_exception );
+   corrupt = compressed;
+   corrupt[corrupt.size() / 2] ^= 0x55;
+   BOOST_CHECK_THROW( lz4_decompress( corrupt.data(), corrupt.size(), out ), fc::parse_error_exception );
+   corrupt = compressed;
+   corrupt.back() ^= 1; // the content checksum
+   BOOST_CHECK_THROW( lz4_decompress( corrupt.data(), corrupt.size(), out ), fc::parse_error_exception );
+
+   auto trailing = compressed;
+   trailing.push_back( 0 );
+   BOOST_CHECK_THROW( lz4_decompress( trailing.data(), trailing.size(), out ), fc::assert_exception );
+   lz4_decompressor decompressor;
+   BOOST_CHECK( decompressor.write( compressed.data(), compressed.size(), out ) );
+   BOOST_CHECK( decompressor.write( compressed.data(), 0, out ) );
+   BOOST_CHECK_THROW( decompressor.write( compressed.data(), 1, out ), fc::assert_exception );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(lz4_benchmark, * boost::unit_test::disabled()) try {
+   const auto corpus = make_corpus( 100000 );
+   std::cerr << "corpus: " << corpus.size() << " bytes of packed transactions\n";
+
+   auto report = [&]( const char* name, auto&& compress, auto&& decompress ) {
+      std::vector<char> compressed, decompressed;
+      const int rounds = 5;
+      auto start = time_point::now();
+      for( int i = 0; i < rounds; ++i ) compress( compressed );
+      auto deflate = time_point::now() - start;
+      start = time_point::now();
+      for( int i = 0; i < rounds; ++i ) decompress( compressed, decompressed );
+      auto inflate = time_point::now() - start;
+      BOOST_CHECK( decompressed == corpus );
+      std::cerr << name << ": ratio " << double( corpus.size() ) / compressed.size()
+                << ", compress " << double( rounds * corpus.size() ) / deflate.count() << " MB/s"
+                << ", decompress " << double( rounds * corpus.size() ) / inflate.count() << " MB/s\n";
+   };
+
+   for( size_t block_size : { lz4_default_block_size, lz4_max_block_size } ) {
+      report( block_size == lz4_default_block_size ? "lz4, 64 KB blocks" : "lz4, 4 MB blocks",
+              [&]( auto& c ) { lz4_compress( corpus.data(), corpus.size(), c, block_size ); },
+              [&]( auto& c, auto& d ) { lz4_decompress( c.data(), c.size(), d ); } );
+   }
+   for( int level : { 1, 6 } ) {
+      report( level == 1 ? "zlib level 1" : "zlib level 6",
+              [&]( auto& c ) { zlib_compress( corpus.data(), corpus.size(), c, level ); },
+              [&]( auto& c, auto& d ) { zlib_decompress( c.data(), c.size(), d ); } );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(parallel_zlib_round_trip) try {
+   const auto corpus = make_corpus( 3000 );
+   parallel_zlib_decompressor decompressor( 3 );
+   BOOST_CHECK_EQUAL( decompressor.threads(), 3u );
+   for( uint32_t threads : { 1, 3 } ) {
+      for( size_t chunk_size : { size_t( 1000 ), size_t( 65536 ), corpus.size(), parallel_zlib_default_chunk_size } ) {
+         parallel_zlib_compressor compressor( threads, 1, chunk_size );
+         std::vector<char> compressed, decompressed;
+         compressor.compress( corpus.data(), corpus.size(), compressed );
+         decompressor.decompress( compressed.data(), compressed.size(), decompressed );
+         BOOST_CHECK( decompressed == corpus );
+      }
+   }
+
+   // chunks are plain zlib streams behind an 8 byte header
+   parallel_zlib_compressor compressor( 2, zlib_default_level, 100000 );
+   std::vector<char> compressed, decompressed;
+   compressor.compress( corpus.data(), corpus.size(), compressed );
+   std::vector<char> first( 100000 );
+   BOOST_CHECK_EQUAL( zlib_decompress( compressed.data() + 5 + 8, compressed.size() - 5 - 8, first.data(), first.size() ), 100000u );
+   BOOST_CHECK( std::equal( first.begin(), first.end(), corpus.begin() ) );
+
+   // and cost little over a single stream, even this small
+   std::vector<char> single;
+   zlib_compress( corpus.data(), corpus.size(), single );
+   BOOST_CHECK_LT( compressed.size(), single.size() * 102 / 100 );
+
+   compressor.compress( nullptr, 0, compressed );
+   BOOST_CHECK_EQUAL( compressed.size(), 5u + 4u );
+   decompressor.decompress( compressed.data(), compressed.size(), decompressed );
+   BOOST_CHECK( decompressed.empty() );
+
+   BOOST_CHECK_THROW( parallel_zlib_compressor( 1, 11 ), fc::assert_exception );
+   BOOST_CHECK_THROW( parallel_zlib_compressor( 1, 6, 0 ), fc::assert_exception );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(parallel_zlib_streaming) try {
+   const auto corpus = make_corpus( 3000 );
+   parallel_zlib_compressor compressor( 3, 1, 4096 );
+   std::vector<char> whole;
+   compressor.compress( corpus.data(), corpus.size(), whole );
+
+   // the chunks fall in the same places however the input is cut up, so the frame is the same
+   uint64_t seed = 5;
+   std::vector<char> compressed;
+   compressor.reset();
+   for( size_t pos = 0; pos < corpus.size(); ) {
+      const size_t n = std::min<size_t>( next_random( seed ) % 60000, corpus.size() - pos );
+      compressor.write( corpus.data() + pos, n, compressed );
+      pos += n;
+   }
+   compressor.finish( compressed );
+   BOOST_CHECK( compressed == whole );
+   BOOST_CHECK_THROW( compressor.write( corpus.data(), 1, compressed ), fc::assert_exception );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(parallel_zlib_bad_input) try {
+   const auto corpus = make_corpus( 2000 );
+   parallel_zlib_compressor compressor( 2, 1, 10000 );
+   parallel_zlib_decompressor decompressor( 2 );
+   std::vector<char> compressed, out;
+   compressor.compress( corpus.data(), corpus.size(), compressed );
+
+   for( size_t size : { size_t( 0 ), size_t( 4 ), size_t( 5 ), size_t( 9 ), size_t( 1000 ), compressed.size() - 1 } )
+      BOOST_CHECK_THROW( decompressor.decompress( compressed.data(), size, out ), fc::eof_exception );
+
+   auto corrupt = compressed;
+   corrupt[0] = 'x';
+   BOOST_CHECK_THROW( decompressor.decompress( corrupt.data(), corrupt.size(), out ), fc::parse_error_exception );
+   // a chunk claiming far more than its compressed size could hold
+   corrupt = compressed;
+   corrupt[5 + 3] = 0x7f;
+   BOOST_CHECK_THROW( decompressor.decompress( corrupt.data(), corrupt.size(), out ), fc::parse_error_exception );
+   // damage inside a chunk is reported from whichever thread inflated it
+   corrupt = compressed;
+   corrupt[corrupt.size() - 20] ^= 0x55;
+   BOOST_CHECK_THROW( decompressor.decompress( corrupt.data(), corrupt.size(), out ), fc::exception );
+   BOOST_CHECK( out.empty() );
+
+   auto trailing = compressed;
+   trailing.push_back( 0 );
+   BOOST_CHECK_THROW( decompressor.decompress( trailing.data(), trailing.size(), out ), fc::assert_exception );
+
+   decompressor.decompress( compressed.data(), compressed.size(), out );
+   BOOST_CHECK( out == corpus );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(parallel_zlib_benchmark, * boost::unit_test::disabled()) try {
+   const auto corpus = make_corpus( 200000 );
+   const uint32_t cores = std::max( 1u, std::thread::hardware_concurrency() );
+   std::cerr << "corpus: " << corpus.size() << " bytes of packed transactions, " << cores << " cores\n";
+
+   std::vector<char> compressed, decompressed;
+   auto start = time_point::now();
+   zlib_compress( corpus.data(), corpus.size(), compressed );
+   std::cerr << "single stream: ratio " << double( corpus.size() ) / compressed.size()
+             << ", compress " << double( corpus.size() ) / ( time_point::now() - start ).count() << " MB/s\n";
+
+   for( uint32_t threads : { 1u, 2u, 4u, 8u, cores } ) {
+      parallel_zlib_compressor compressor( threads );
+      parallel_zlib_decompressor decompressor( threads );
+      start = time_point::now();
+      compressor.compress( corpus.data(), corpus.size(), compressed );
+      auto deflate = time_point::now() - start;
+      start = time_point::now();
+      decompressor.decompress( compressed.data(), compressed.size(), decompressed );
+      auto inflate = time_point::now() - start;
+      BOOST_CHECK( decompressed == corpus );
+      std::cerr << threads << " threads: ratio " << double( corpus.size() ) / compressed.size()
+                << ", compress " << double( corpus.size() ) / deflate.count() << " MB/s"
+                << ", decompress " << double( corpus.size() ) / inflate.count() << " MB/s\n";
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(dictionary_round_trip) try {
+   const auto records = make_log_records( 1000 );
+   const auto dict = compression_dictionary::train( std::vector<std::string>( records.begin(), records.begin() + 500 ) );
+   BOOST_CHECK_LE( dict.content().size(), compression_dictionary::default_size );
+   BOOST_CHECK_GT( dict.content().size(), 1000u );
+
+   std::vector<char> compressed, decompressed;
+   size_t with = 0, without = 0;
+   for( size_t i = 500; i < records.size(); ++i ) {
+      dictionary_compress( dict, records[i].data(), records[i].size(), compressed );
+      with += compressed.size();
+      dictionary_decompress( dict, compressed.data(), compressed.size(), decompressed );
+      BOOST_REQUIRE_EQUAL( std::string( decompressed.data(), decompressed.size() ), records[i] );
+
+      dictionary_compress( compression_dictionary(), records[i].data(), records[i].size(), compressed );
+      without += compressed.size();
+   }
+   // records are too short to compress much on their own
+   BOOST_CHECK_LT( with * 3, without );
+
+   // any size, including larger than the dictionary itself
+   const auto corpus = make_corpus( 2000 );
+   for( size_t size : { 0, 1, 7, 13, 100, 1000, 100000 } ) {
+      dictionary_compress( dict, corpus.data(), size, compressed );
+      dictionary_decompress( dict, compressed.data(), compressed.size(), decompressed );
+      BOOST_CHECK( decompressed == std::vector<char>( corpus.begin(), corpus.begin() + size ) );
+   }
+
+   // a fixed table works the same; taking turns between dictionaries too
+   const std::string table = "{\"version\":\"1.1\",\"host\":\",\"short_message\":\",\"timestamp\":,\"level\":";
+   const compression_dictionary fixed( table.data(), table.size() );
+   for( const auto* d : { &fixed, &dict, &fixed } ) {
+      dictionary_compress( *d, records[0].data(), records[0].size(), compressed );
+      dictionary_decompress( *d, compressed.data(), compressed.size(), decompressed );
+      BOOST_CHECK_EQUAL( std::string( decompressed.data(), decompressed.size() ), records[0] );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(dictionary_training) try {
+   const auto records = make_log_records( 300 );
+   const auto dict = compression_dictionary::train( records, 4096 );
+   BOOST_CHECK_LE( dict.content().size(), 4096u );
+   BOOST_CHECK_EQUAL( compression_dictionary::train( records, 4096 ).id(), dict.id() );
+   BOOST_CHECK_EQUAL( dict.id(), crc32c( dict.content().data(), dict.content().size() ) );
+   BOOST_CHECK_NE( compression_dictionary::train( records, 2048 ).id(), dict.id() );
+
+   // fewer samples than the dictionary would hold are taken whole
+   const std::vector<std::string> few( records.begin(), records.begin() + 3 );
+   const auto small = compression_dictionary::train( few );
+   BOOST_CHECK_EQUAL( std::string( small.content().data(), small.content().size() ), few[0] + few[1] + few[2] );
+   BOOST_CHECK( compression_dictionary::train( std::vector<std::string>() ).content().empty() );
+   BOOST_CHECK_EQUAL( compression_dictionary::train( records, 10 ).content().size(), 10u );
+
+   // packed transactions
+   std::vector<std::vector<char>> trxs;
+   for( const auto& trx : make_transactions( 1000 ) )
+      trxs.push_back( fc::raw::pack( trx ) );
+   const auto trx_dict = compression_dictionary::train( std::vector<std::vector<char>>( trxs.begin(), trxs.begin() + 500 ) );
+   size_t with = 0, without = 0;
+   std::vector<char> compressed;
+   for( size_t i = 500; i < trxs.size(); ++i ) {
+      dictionary_compress( trx_dict, trxs[i].data(), trxs[i].size(), compressed );
+      with += compressed.size();
+      dictionary_compress( compression_dictionary(), trxs[i].data(), trxs[i].size(), compressed );
+      without += compressed.size();
+   }
+   BOOST_CHECK_LT( with * 4, without * 3 );
+
+   const compression_dictionary large( std::vector<char>( 100000, 'x' ) );
+   BOOST_CHECK_EQUAL( large.content().size(), compression_dictionary::max_size );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(dictionary_bad_input) try {
+   const auto records = make_log_records( 200 );
+   const auto dict = compression_dictionary::train( records );
+   std::vector<char> compressed, out;
+   dictionary_compress( dict, records[0].data(), records[0].size(), compressed );
+
+   BOOST_CHECK_THROW( dictionary_decompress( dict, compressed.data(), 0, out ), fc::parse_error_exception );
+   BOOST_CHECK_THROW( dictionary_decompress( dict, compressed.data(), compressed.size() - 1, out ), fc::parse_error_exception );
+   // the matches reach into a dictionary that isn't there
+   BOOST_CHECK_THROW( dictionary_decompress( compression_dictionary(), compressed.data(), compressed.size(), out ),
+                      fc::parse_error_exception );
+
+   const char huge[] = { char( 0xff ), char( 0xff ), char( 0xff ), char( 0xff ), 0x0f, 0x00 };
+   BOOST_CHECK_THROW( dictionary_decompress( dict, huge, sizeof(huge), out ), fc::parse_error_exception );
+   const char endless[] = { char( 0x80 ), char( 0x80 ), char( 0x80 ), char( 0x80 ), char( 0x80 ), char( 0x80 ), char( 0x80 ),
+                            char( 0x80 ), char( 0x80 ), char( 0x80 ), 0x01 };
+   BOOST_CHECK_THROW( dictionary_decompress( dict, endless, sizeof(endless), out ), fc::parse_error_exception );
+   auto longer = compressed;
+   longer[0] += 1;
+   BOOST_CHECK_THROW( dictionary_decompress( dict, longer.data(), longer.size(), out ), fc::parse_error_exception );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(dictionary_benchmark, * boost::unit_test::disabled()) try {
+   auto records = make_log_records( 20000 );
+   std::vector<std::string> trxs;
+   for( const auto& trx : make_transactions( 20000 ) ) {
+      const auto packed = fc::raw::pack( trx );
+      trxs.emplace_back( packed.begin(), packed.end() );
+   }
+
+   for( const auto* messages : { &records, &trxs } ) {
+      const std::vector<std::string> samples( messages->begin(), messages->begin() + 2000 );
+      auto start = time_point::now();
+      const auto dict = compression_dictionary::train( samples );
+      std::cerr << ( messages == &records ? "GELF records" : "packed transactions" ) << ", "
+                << dict.content().size() << " byte dictionary trained in " << ( time_point::now() - start ).count() / 1000 << " ms\n";
+
+      size_t raw = 0;
+      for( size_t i = 2000; i < messages->size(); ++i ) raw += (*messages)[i].size();
+      const size_t count = messages->size() - 2000;
+
+      auto report = [&]( const char* name, auto&& compress, auto&& decompress ) {
+         std::vector<std::vector<char>> compressed( count );
+         std::vector<char> decompressed;
+         size_t total = 0;
+         auto start = time_point::now();
+         for( size_t i = 0; i < count; ++i ) {
+            compress( (*messages)[2000 + i], compressed[i] );
+            total += compressed[i].size();
+         }
+         auto deflate = time_point::now() - start;
+         start = time_point::now();
+         for( size_t i = 0; i < count; ++i )
+            decompress( compressed[i], decompressed );
+         auto inflate = time_point::now() - start;
+         std::cerr << "  " << name << ": ratio " << double( raw ) / total
+                   << ", compress " << deflate.count() * 1000.0 / count << " ns"
+                   << ", decompress " << inflate.count() * 1000.0 / count << " ns per message\n";
+      };
+
+      report( "lz4 with dictionary",
+              [&]( const std::string& m, auto& c ) { dictionary_compress( dict, m.data(), m.size(), c ); },
+              [&]( auto& c, auto& d ) { dictionary_decompress( dict, c.data(), c.size(), d ); } );
+      report( "lz4 alone",
+              [&]( const std::string& m, auto& c ) { dictionary_compress( compression_dictionary(), m.data(), m.size(), c ); },
+              [&]( auto& c, auto& d ) { dictionary_decompress( compression_dictionary(), c.data(), c.size(), d ); } );
+      report( "zlib level 6",
+              [&]( const std::string& m, auto& c ) { zlib_compress( m.data(), m.size(), c ); },
+              [&]( auto& c, auto& d ) { zlib_decompress( c.data(), c.size(), d ); } );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,14 +1,42 @@
 #define BOOST_TEST_MODULE cypher_suites
 #include <boost/test/included/unit_test.hpp>
 
+#include <fc/crypto/batch_verifier.hpp>
 #include <fc/crypto/public_key.hpp>
+#include <fc/crypto/public_key_cache.hpp>
 #include <fc/crypto/private_key.hpp>
 #include <fc/crypto/signature.hpp>
+#include <fc/crypto/signing_key.hpp>
+#include <fc/time.hpp>
 #include <fc/utility.hpp>
 
+#include <iostream>
+#include <thread>
+
 using namespace fc::crypto;
 using namespace fc;
 
+namespace {
+   struct signed_digests {
+      std::vector<public_key> keys;
+      std::vector<sha256>     digests;
+      std::vector<signature>  signatures;
+   };
+
+   // alternates K1 and R1 keys unless told otherwise
+   signed_digests make_signed_digests( size_t count, bool k1 = true, bool r1 = true ) {
+      signed_digests res;
+      for( size_t i = 0; i < count; ++i ) {
+         auto key = ( r1 && ( !k1 || i % 2 ) ) ? private_key::generate<r1::private_key_shim>()
+                                                : private_key::generate<ecc::private_key_shim>();
+         res.keys.push_back( key.get_public_key() );
+         res.digests.push_back( sha256::hash( std::to_string( i ) ) );
+         res.signatures.push_back( key.sign( res.digests.back() ) );
+      }
+      return res;
+   }
+}
+
 BOOST_AUTO_TEST_SUITE(cypher_suites)
 BOOST_AUTO_TEST_CASE(test_k1) try {
    auto private_key_string = std::string("5KQwrPbwdL6PhXujxW37FSSQZ1JiwsST4cqQzDeyXtP79zkvFD3");
@@ -79,4 +107,226 @@ BOOST_AUTO_TEST_CASE(test_r1_recyle) try {
 } FC_LOG_AND_RETHROW();
 
 
+BOOST_AUTO_TEST_CASE(test_batch_recovery) try {
+   auto batch = make_signed_digests( 64 );
+   // item 3 is signed over another digest, item 5 can't be recovered at all
+   std::swap( batch.digests[3], batch.digests[4] );
+   batch.signatures[5] = signature();
+
+   batch_verifier verifier( 4 );
+   auto recovered = verifier.recover( batch.signatures, batch.digests );
+   auto verified = verifier.verify( batch.signatures, batch.digests, batch.keys );
+   BOOST_REQUIRE_EQUAL( recovered.size(), batch.keys.size() );
+   BOOST_REQUIRE_EQUAL( verified.size(), batch.keys.size() );
+
+   for( size_t i = 0; i < batch.keys.size(); ++i ) {
+      if( i == 3 || i == 4 ) {
+         BOOST_CHECK( recovered[i].ok() );
+         BOOST_CHECK( *recovered[i].key != batch.keys[i] );
+         BOOST_CHECK_EQUAL( verified[i], batch_verifier::verify_status::mismatch );
+      } else if( i == 5 ) {
+         BOOST_CHECK( !recovered[i].ok() );
+         BOOST_CHECK( recovered[i].error );
+         BOOST_CHECK_EQUAL( verified[i], batch_verifier::verify_status::unrecoverable );
+      } else {
+         BOOST_CHECK( recovered[i].ok() );
+         BOOST_CHECK_EQUAL( std::string( *recovered[i].key ), std::string( batch.keys[i] ) );
+         BOOST_CHECK_EQUAL( verified[i], batch_verifier::verify_status::valid );
+      }
+   }
+
+   // a single thread gives the same answers
+   auto serial = batch_verifier( 1 ).verify( batch.signatures, batch.digests, batch.keys );
+   BOOST_CHECK( serial == verified );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(test_public_key_cache) try {
+   auto batch = make_signed_digests( 6 );
+   public_key_cache cache( 4, 1 );
+
+   BOOST_CHECK( !cache.find( batch.signatures[0], batch.digests[0] ) );
+   for( int round = 0; round < 2; ++round )
+      BOOST_CHECK_EQUAL( std::string( cache.recover( batch.signatures[0], batch.digests[0] ) ), std::string( batch.keys[0] ) );
+   auto stats = cache.get_stats();
+   BOOST_CHECK_EQUAL( stats.hits, 1u );
+   BOOST_CHECK_EQUAL( stats.misses, 2u );
+   BOOST_CHECK_EQUAL( stats.size, 1u );
+
+   // same signature over another digest is another entry
+   BOOST_CHECK( !cache.find( batch.signatures[0], batch.digests[1] ) );
+
+   // keys recovered without the canonical check don't answer lookups that require it
+   cache.recover( batch.signatures[1], batch.digests[1], false );
+   BOOST_CHECK( cache.find( batch.signatures[1], batch.digests[1], false ) );
+   BOOST_CHECK( !cache.find( batch.signatures[1], batch.digests[1], true ) );
+
+   // entry 0 was used last, so 1 is the first to go
+   cache.find( batch.signatures[0], batch.digests[0] );
+   for( size_t i = 2; i < 5; ++i )
+      cache.recover( batch.signatures[i], batch.digests[i] );
+   stats = cache.get_stats();
+   BOOST_CHECK_EQUAL( stats.size, 4u );
+   BOOST_CHECK_EQUAL( stats.evictions, 1u );
+   BOOST_CHECK( cache.find( batch.signatures[0], batch.digests[0] ) );
+   BOOST_CHECK( !cache.find( batch.signatures[1], batch.digests[1], false ) );
+
+   cache.clear();
+   BOOST_CHECK_EQUAL( cache.get_stats().size, 0u );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(test_signing_key) try {
+   std::vector<sha256> digests;
+   for( int i = 0; i < 64; ++i )
+      digests.push_back( sha256::hash( std::to_string( i ) ) );
+
+   for( const auto& key : { private_key::generate<ecc::private_key_shim>(), private_key::generate<r1::private_key_shim>() } ) {
+      signing_key signer( key, 4 );
+      BOOST_CHECK( signer.get_public_key() == key.get_public_key() );
+      BOOST_CHECK( signer.get_private_key() == key );
+
+      uint32_t attempts = 0;
+      auto sig = signer.sign( digests[0], true, &attempts );
+      BOOST_CHECK( attempts >= 1 );
+      BOOST_CHECK( public_key( sig, digests[0] ) == key.get_public_key() );
+
+      std::vector<uint32_t> batch_attempts( digests.size() );
+      auto sigs = signer.sign_many( digests.data(), digests.size(), true, batch_attempts.data() );
+      BOOST_REQUIRE_EQUAL( sigs.size(), digests.size() );
+      for( size_t i = 0; i < digests.size(); ++i ) {
+         BOOST_CHECK( public_key( sigs[i], digests[i] ) == key.get_public_key() );
+         BOOST_CHECK( batch_attempts[i] >= 1 );
+      }
+   }
+
+   // K1 signing is deterministic, so the cached key has to give exactly what private_key::sign does
+   auto k1 = private_key::generate<ecc::private_key_shim>();
+   signing_key signer( k1 );
+   uint64_t total_attempts = 0;
+   for( const auto& digest : digests ) {
+      uint32_t attempts = 0;
+      BOOST_CHECK( signer.sign( digest, true, &attempts ) == k1.sign( digest ) );
+      BOOST_CHECK( signer.sign( digest, false ) == k1.sign( digest, false ) );
+      total_attempts += attempts;
+   }
+   // about half of all K1 signatures need another nonce
+   BOOST_CHECK( total_attempts > digests.size() );
+   BOOST_CHECK( signing_key( k1, 4 ).sign_many( digests ) == signer.sign_many( digests ) );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(test_signing_key_k1_batch) try {
+   std::vector<sha256> digests;
+   for( int i = 0; i < 200; ++i )
+      digests.push_back( sha256::hash( "k1 batch " + std::to_string( i ) ) );
+
+   const auto k1 = private_key::generate<ecc::private_key_shim>();
+   const signing_key signer( k1, 4 );
+   BOOST_CHECK( signer.get_public_key() == k1.get_public_key() );
+
+   // the pool signs every digest once, in place, with the nonces private_key::sign would pick
+   for( bool canonical : { true, false } ) {
+      std::vector<uint32_t> attempts( digests.size() );
+      const auto sigs = signer.sign_many( digests.data(), digests.size(), canonical, attempts.data() );
+      BOOST_REQUIRE_EQUAL( sigs.size(), digests.size() );
+      for( size_t i = 0; i < digests.size(); ++i ) {
+         BOOST_REQUIRE( sigs[i] == k1.sign( digests[i], canonical ) );
+         BOOST_CHECK( public_key( sigs[i], digests[i], canonical ) == k1.get_public_key() );
+         uint32_t one = 0;
+         signer.sign( digests[i], canonical, &one );
+         BOOST_CHECK_EQUAL( attempts[i], one );
+         if( !canonical ) BOOST_CHECK_EQUAL( attempts[i], 1u );
+      }
+   }
+   BOOST_CHECK( signer.sign_many( nullptr, 0 ).empty() );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(test_recovery_benchmark, * boost::unit_test::disabled()) try {
+   const size_t count = 2000;
+   const std::pair<const char*, signed_digests> batches[] = {
+      { "K1", make_signed_digests( count, true, false ) },
+      { "R1", make_signed_digests( count, false, true ) },
+   };
+
+   for( const auto& batch : batches ) {
+      auto start = time_point::now();
+      for( size_t i = 0; i < count; ++i )
+         public_key( batch.second.signatures[i], batch.second.digests[i] );
+      auto elapsed = time_point::now() - start;
+      std::cerr << batch.first << " recovery: " << uint64_t( count * 1000000.0 / elapsed.count() ) << "/s\n";
+   }
+
+   const std::pair<const char*, private_key> keys[] = {
+      { "K1", private_key::generate<ecc::private_key_shim>() },
+      { "R1", private_key::generate<r1::private_key_shim>() },
+   };
+   for( const auto& key : keys ) {
+      const size_t signs = 500;
+      auto start = time_point::now();
+      for( size_t i = 0; i < signs; ++i )
+         key.second.sign( sha256::hash( std::to_string( i ) ) );
+      auto elapsed = time_point::now() - start;
+      std::cerr << key.first << " signing: " << uint64_t( signs * 1000000.0 / elapsed.count() ) << "/s\n";
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(test_batch_recovery_benchmark, * boost::unit_test::disabled()) try {
+   const size_t count = 4000;
+   const std::pair<const char*, signed_digests> batches[] = {
+      { "K1", make_signed_digests( count, true, false ) },
+      { "R1", make_signed_digests( count, false, true ) },
+   };
+
+   const uint32_t cores = std::max( 1u, std::thread::hardware_concurrency() );
+   for( const auto& batch : batches ) {
+      for( uint32_t threads = 1; threads <= cores; threads *= 2 ) {
+         batch_verifier verifier( threads );
+         auto start = time_point::now();
+         auto results = verifier.recover( batch.second.signatures, batch.second.digests );
+         auto elapsed = time_point::now() - start;
+         BOOST_CHECK( results.back().ok() );
+         std::cerr << batch.first << ", " << threads << " threads: "
+                   << uint64_t( count * 1000000.0 / elapsed.count() ) << " recoveries/s\n";
+      }
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(test_signing_key_benchmark, * boost::unit_test::disabled()) try {
+   const size_t count = 2000;
+   std::vector<sha256> digests;
+   for( size_t i = 0; i < count; ++i )
+      digests.push_back( sha256::hash( std::to_string( i ) ) );
+
+   const std::pair<const char*, private_key> keys[] = {
+      { "K1", private_key::generate<ecc::private_key_shim>() },
+      { "R1", private_key::generate<r1::private_key_shim>() },
+   };
+   const uint32_t cores = std::max( 1u, std::thread::hardware_concurrency() );
+   for( const auto& key : keys ) {
+      auto start = time_point::now();
+      for( const auto& digest : digests )
+         key.second.sign( digest );
+      auto elapsed = time_point::now() - start;
+      std::cerr << key.first << " private_key::sign: " << uint64_t( count * 1000000.0 / elapsed.count() ) << "/s";
+
+      signing_key signer( key.second );
+      uint64_t attempts = 0;
+      start = time_point::now();
+      for( const auto& digest : digests ) {
+         uint32_t a = 0;
+         signer.sign( digest, true, &a );
+         attempts += a;
+      }
+      elapsed = time_point::now() - start;
+      std::cerr << ", signing_key::sign: " << uint64_t( count * 1000000.0 / elapsed.count() ) << "/s, "
+                << double( attempts ) / count << " attempts per signature\n";
+
+      for( uint32_t threads = 1; threads <= cores; threads *= 2 ) {
+         signing_key pooled( key.second, threads );
+         start = time_point::now();
+         pooled.sign_many( digests );
+         elapsed = time_point::now() - start;
+         std::cerr << key.first << ", " << threads << " threads: " << uint64_t( count * 1000000.0 / elapsed.count() ) << " signatures/s\n";
+      }
+   }
+} FC_LOG_AND_RETHROW();
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
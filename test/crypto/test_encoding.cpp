@@ -0,0 +1,285 @@
+#define BOOST_TEST_MODULE encoding
+#include <boost/test/included/unit_test.hpp>
+
+#include <fc/crypto/base58.hpp>
+#include <fc/crypto/base64.hpp>
+#include <fc/crypto/hex.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/time.hpp>
+
+#include <iostream>
+
+using namespace fc;
+
+namespace encoding_test {
+   const char* alphabet = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+   // schoolbook long division by 58, one digit at a time
+   std::string reference_base58( std::vector<unsigned char> number ) {
+      std::string digits;
+      size_t zeros = 0;
+      while( zeros < number.size() && number[zeros] == 0 ) ++zeros;
+      for( size_t start = zeros; start < number.size(); ) {
+         unsigned remainder = 0;
+         for( size_t i = start; i < number.size(); ++i ) {
+            unsigned v = remainder * 256 + number[i];
+            number[i] = v / 58;
+            remainder = v % 58;
+         }
+         digits.push_back( alphabet[remainder] );
+         while( start < number.size() && number[start] == 0 ) ++start;
+      }
+      digits.append( zeros, '1' );
+      return std::string( digits.rbegin(), digits.rend() );
+   }
+
+   // a bit at a time
+   std::string reference_base64( const std::vector<char>& data ) {
+      const char* digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+      std::string out;
+      unsigned buffer = 0, bits = 0;
+      for( char c : data ) {
+         buffer = buffer << 8 | uint8_t( c );
+         bits += 8;
+         while( bits >= 6 ) {
+            bits -= 6;
+            out.push_back( digits[( buffer >> bits ) & 0x3f] );
+         }
+      }
+      if( bits ) out.push_back( digits[( buffer << ( 6 - bits ) ) & 0x3f] );
+      while( out.size() % 4 ) out.push_back( '=' );
+      return out;
+   }
+
+   std::vector<char> pattern( size_t size, size_t zeros, unsigned seed ) {
+      std::vector<char> data( size );
+      for( size_t i = 0; i < size; ++i )
+         data[i] = i < zeros ? 0 : char( ( i + 1 ) * 167 + seed * 31 );
+      return data;
+   }
+}
+
+using namespace encoding_test;
+
+BOOST_AUTO_TEST_SUITE(encoding_test_suite)
+
+BOOST_AUTO_TEST_CASE(base58_vectors) try {
+   const std::vector<std::pair<std::string, std::string>> vectors = {
+      { "", "" },
+      { std::string( "\x61", 1 ), "2g" },
+      { "\x62\x62\x62", "a3gV" },
+      { "\x63\x63\x63", "aPEr" },
+      { "simply a long string", "2cFupjhnEsSn59qHXstmK2ffpLv2" },
+      { std::string( "\x00\xeb\x15\x23\x1d\xfc\xeb\x60\x92\x58\x86\xb6\x7d\x06\x52\x99\x92\x59\x15\xae\xb1\x72\xc0\x66\x47", 25 ),
+        "1NS17iag9jJgTHD1VXjvLCEnZuQ3rJDE9L" },
+      { "\x51\x6b\x6f\xcd\x0f", "ABnLTmg" },
+      { std::string( "\x00\x00\x00\x28\x7f\xb4\xcd", 7 ), "111233QC4" },
+      { std::string( "\x00\x00\x00\x00", 4 ), "1111" },
+   };
+   for( const auto& v : vectors ) {
+      BOOST_CHECK_EQUAL( to_base58( v.first.data(), v.first.size() ), v.second );
+      auto decoded = from_base58( v.second );
+      BOOST_CHECK_EQUAL( std::string( decoded.begin(), decoded.end() ), v.first );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(base58_round_trip) try {
+   // the key and signature sizes take their own path, the rest the generic one
+   for( size_t size = 0; size <= 300; ++size ) {
+      for( size_t zeros : { size_t(0), size_t(1), size_t(3), size } ) {
+         if( zeros > size ) continue;
+         auto data = pattern( size, zeros, unsigned( size ) );
+         const auto text = to_base58( data.data(), data.size() );
+         BOOST_CHECK_EQUAL( text, reference_base58( std::vector<unsigned char>( data.begin(), data.end() ) ) );
+         BOOST_CHECK_LE( text.size(), base58_encoded_size_bound( size ) );
+
+         char out[base58_encoded_size_bound( 300 )];
+         BOOST_CHECK_EQUAL( std::string( out, to_base58( data.data(), data.size(), out ) ), text );
+
+         BOOST_CHECK( from_base58( text ) == data );
+         std::vector<char> buffer( size + 1, 'x' );
+         BOOST_REQUIRE_EQUAL( from_base58( text, buffer.data(), buffer.size() ), size );
+         BOOST_CHECK( std::equal( data.begin(), data.end(), buffer.begin() ) );
+      }
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(base58_bad_input) try {
+   BOOST_CHECK( from_base58( " \t2g\n " ) == std::vector<char>{ 'a' } );
+   BOOST_CHECK_THROW( from_base58( "2g0" ), parse_error_exception );
+   BOOST_CHECK_THROW( from_base58( "2 g" ), parse_error_exception );
+   BOOST_CHECK_THROW( from_base58( "O" ), parse_error_exception );
+   BOOST_CHECK_THROW( from_base58( std::string( "2g\0", 3 ) ), parse_error_exception );
+
+   char out[2];
+   BOOST_CHECK_THROW( from_base58( "a3gV", out, sizeof(out) ), assert_exception );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(hex_round_trip) try {
+   // sizes around the 32-byte vector step
+   for( size_t size = 0; size <= 200; ++size ) {
+      auto data = pattern( size, 0, unsigned( size ) );
+      std::string expected;
+      for( char c : data ) {
+         char pair[3];
+         snprintf( pair, sizeof(pair), "%02x", uint8_t( c ) );
+         expected += pair;
+      }
+      BOOST_CHECK_EQUAL( to_hex( data.data(), uint32_t( data.size() ) ), expected );
+      std::vector<char> out( 2 * size + 1, 'x' );
+      BOOST_CHECK_EQUAL( to_hex( data.data(), data.size(), out.data() ), 2 * size );
+      BOOST_CHECK_EQUAL( std::string( out.data(), 2 * size ), expected );
+
+      std::vector<char> decoded( size + 1, 'x' );
+      BOOST_REQUIRE_EQUAL( from_hex( expected, decoded.data(), decoded.size() ), size );
+      BOOST_CHECK( std::equal( data.begin(), data.end(), decoded.begin() ) );
+
+      std::string upper = expected;
+      for( auto& c : upper ) c = toupper( c );
+      BOOST_REQUIRE_EQUAL( from_hex( upper, decoded.data(), decoded.size() ), size );
+      BOOST_CHECK( std::equal( data.begin(), data.end(), decoded.begin() ) );
+
+      // a short buffer takes what fits
+      if( size ) {
+         BOOST_CHECK_EQUAL( from_hex( expected, decoded.data(), size - 1 ), size - 1 );
+         BOOST_CHECK( std::equal( data.begin(), data.end() - 1, decoded.begin() ) );
+      }
+   }
+
+   // an odd trailing digit fills the high half of one more byte
+   char out[4] = {};
+   BOOST_CHECK_EQUAL( from_hex( std::string( "abc" ), out, sizeof(out) ), 2u );
+   BOOST_CHECK_EQUAL( uint8_t( out[1] ), 0xc0 );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(hex_bad_input) try {
+   const std::string good( 200, 'a' );
+   char out[100];
+   // a bad character anywhere, inside a vector step or in the scalar tail, throws
+   for( size_t pos : { size_t(0), size_t(1), size_t(63), size_t(64), size_t(130), size_t(199) } ) {
+      for( char bad : { 'g', 'G', '/', ':', '@', '`', ' ', '\x80', '\xff', '\0' } ) {
+         std::string text = good;
+         text[pos] = bad;
+         BOOST_CHECK_THROW( from_hex( text, out, sizeof(out) ), fc::exception );
+      }
+   }
+   // but not past what fits the output
+   std::string text = good;
+   text[150] = 'z';
+   BOOST_CHECK_EQUAL( from_hex( text, out, 50 ), 50u );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(base64_round_trip) try {
+   BOOST_CHECK_EQUAL( base64_encode( std::vector<char>() ), "" );
+   BOOST_CHECK_EQUAL( base64_encode( "f", 1 ), "Zg==" );
+   BOOST_CHECK_EQUAL( base64_encode( "fo", 2 ), "Zm8=" );
+   BOOST_CHECK_EQUAL( base64_encode( "foo", 3 ), "Zm9v" );
+   BOOST_CHECK_EQUAL( base64_encode( "foobar", 6 ), "Zm9vYmFy" );
+   BOOST_CHECK_EQUAL( base64_decode( "Zm9vYg==" ), "foob" );
+   BOOST_CHECK_EQUAL( base64_decode( "Zm9vYmE=" ), "fooba" );
+
+   // sizes around the 12-byte vector step, with every byte value
+   for( size_t size = 0; size <= 300; ++size ) {
+      std::vector<char> data( size );
+      for( size_t i = 0; i < size; ++i )
+         data[i] = char( i * 89 + size );
+      const auto expected = reference_base64( data );
+      BOOST_CHECK_EQUAL( base64_encode( data ), expected );
+
+      std::vector<char> out( base64_encoded_size( size ) + 1, 'x' );
+      BOOST_CHECK_EQUAL( base64_encode( data.data(), data.size(), out.data() ), expected.size() );
+      BOOST_CHECK_EQUAL( std::string( out.data(), expected.size() ), expected );
+
+      const auto decoded = base64_decode( expected );
+      BOOST_CHECK( std::vector<char>( decoded.begin(), decoded.end() ) == data );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(base64_stops_at_bad_input) try {
+   std::vector<char> data( 150 );
+   for( size_t i = 0; i < data.size(); ++i )
+      data[i] = char( i * 13 );
+   const auto text = base64_encode( data );
+
+   // decoding ends at the first character outside the alphabet, wherever it is
+   for( size_t pos : { size_t(0), size_t(5), size_t(16), size_t(47), size_t(100), size_t(text.size() - 3) } ) {
+      for( char bad : { '=', '-', '_', ' ', '\n', '\x80', '\0', '.', ':', '@', '[', '`', '{' } ) {
+         std::string broken = text;
+         broken[pos] = bad;
+         const auto decoded = base64_decode( broken );
+         const auto expected = base64_decode( text.substr( 0, pos ) );
+         BOOST_CHECK_EQUAL( decoded, expected );
+         BOOST_CHECK_EQUAL( expected.size(), pos / 4 * 3 + ( pos % 4 ? pos % 4 - 1 : 0 ) );
+      }
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(hex_base64_benchmark, * boost::unit_test::disabled()) try {
+   for( size_t size : { 32, 256, 4096 } ) {
+      auto data = pattern( size, 0, 3 );
+      const int iterations = int( 20000000 / ( size + 50 ) );
+      size_t total = 0;
+      std::string text;
+
+      auto start = time_point::now();
+      for( int i = 0; i < iterations; ++i ) {
+         data[0] = char( i );
+         text = to_hex( data.data(), uint32_t( data.size() ) );
+         total += text.size();
+      }
+      auto hex_encode = time_point::now() - start;
+
+      std::vector<char> out( size );
+      start = time_point::now();
+      for( int i = 0; i < iterations; ++i )
+         total += from_hex( text, out.data(), out.size() );
+      auto hex_decode = time_point::now() - start;
+
+      start = time_point::now();
+      for( int i = 0; i < iterations; ++i ) {
+         data[0] = char( i );
+         text = base64_encode( data );
+         total += text.size();
+      }
+      auto b64_encode = time_point::now() - start;
+
+      start = time_point::now();
+      for( int i = 0; i < iterations; ++i )
+         total += base64_decode( text ).size();
+      auto b64_decode = time_point::now() - start;
+
+      auto per = [&]( const fc::microseconds& t ) { return t.count() * 1000.0 / iterations; };
+      std::cerr << size << " bytes: to_hex " << per( hex_encode ) << " ns, from_hex " << per( hex_decode )
+                << " ns, base64_encode " << per( b64_encode ) << " ns, base64_decode " << per( b64_decode )
+                << " ns (" << total << ")\n";
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(base58_benchmark, * boost::unit_test::disabled()) try {
+   const int iterations = 200000;
+   // compressed public keys and signatures, bare and with their checksum
+   for( size_t size : { 33, 37, 65, 69 } ) {
+      auto data = pattern( size, 0, 7 );
+      std::string text;
+      size_t total = 0;
+
+      auto start = time_point::now();
+      for( int i = 0; i < iterations; ++i ) {
+         data[1] = char( i );
+         text = to_base58( data.data(), data.size() );
+         total += text.size();
+      }
+      auto encode = time_point::now() - start;
+
+      char out[128];
+      start = time_point::now();
+      for( int i = 0; i < iterations; ++i )
+         total += from_base58( text, out, sizeof(out) );
+      auto decode = time_point::now() - start;
+
+      std::cerr << size << " bytes: " << encode.count() * 1000.0 / iterations << " ns to_base58, "
+                << decode.count() * 1000.0 / iterations << " ns from_base58 (" << total << ")\n";
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,440 @@
+#define BOOST_TEST_MODULE hash
+#include <boost/test/included/unit_test.hpp>
+
+#include <fc/crypto/buffered_hash_stream.hpp>
+#include <fc/crypto/city.hpp>
+#include <fc/crypto/crc32c.hpp>
+#include <fc/crypto/digest.hpp>
+#include <fc/crypto/merkle_tree.hpp>
+#include <fc/crypto/ripemd160.hpp>
+#include <fc/crypto/sha224.hpp>
+#include <fc/crypto/sha256.hpp>
+#include <fc/crypto/sha512.hpp>
+#include <fc/array.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/time.hpp>
+#include <fc/uint128.hpp>
+
+#include <iostream>
+
+using namespace fc;
+
+namespace hash_test {
+   struct action {
+      uint64_t                  account = 0;
+      uint64_t                  name = 0;
+      std::vector<uint64_t>     authorization;
+      std::vector<char>         data;
+   };
+
+   struct transaction {
+      fc::time_point_sec        expiration;
+      uint16_t                  ref_block_num = 0;
+      uint32_t                  ref_block_prefix = 0;
+      fc::unsigned_int          max_net_usage_words;
+      uint8_t                   max_cpu_usage_ms = 0;
+      fc::unsigned_int          delay_sec;
+      std::vector<action>       actions;
+      std::vector<std::string>  extensions;
+   };
+
+   transaction make_transaction( size_t actions, size_t data_size ) {
+      transaction trx;
+      trx.expiration = fc::time_point_sec( 1500000000 );
+      trx.ref_block_num = 1234;
+      trx.ref_block_prefix = 0xdeadbeef;
+      trx.max_net_usage_words = 300;
+      trx.delay_sec = 7;
+      for( size_t i = 0; i < actions; ++i ) {
+         action a;
+         a.account = 0x5530ea0000000000ull + i;
+         a.name = 0xcd4d7a8000000000ull;
+         a.authorization = { i, i + 1 };
+         a.data.resize( data_size, char( i ) );
+         trx.actions.push_back( std::move( a ) );
+      }
+      trx.extensions = { "one", "two" };
+      return trx;
+   }
+
+   std::vector<sha256::engine::type> supported_engines() {
+      std::vector<sha256::engine::type> engines;
+      const auto original = sha256::hash_many_engine();
+      for( auto e : { sha256::engine::scalar, sha256::engine::avx2, sha256::engine::shani } )
+         if( sha256::set_hash_many_engine( e ) ) engines.push_back( e );
+      sha256::set_hash_many_engine( original );
+      return engines;
+   }
+
+   sha256 naive_merkle_root( std::vector<sha256> nodes ) {
+      if( nodes.empty() ) return sha256();
+      while( nodes.size() > 1 ) {
+         if( nodes.size() % 2 ) nodes.push_back( nodes.back() );
+         std::vector<sha256> parents;
+         for( size_t i = 0; i < nodes.size(); i += 2 ) {
+            sha256::encoder e;
+            e.write( nodes[i].data(), sizeof( sha256 ) );
+            e.write( nodes[i + 1].data(), sizeof( sha256 ) );
+            parents.push_back( e.result() );
+         }
+         nodes = std::move( parents );
+      }
+      return nodes.front();
+   }
+
+   uint32_t bitwise_crc32c( const char* data, size_t size, uint32_t crc = 0 ) {
+      crc = ~crc;
+      for( size_t i = 0; i < size; ++i ) {
+         crc ^= uint8_t( data[i] );
+         for( int b = 0; b < 8; ++b )
+            crc = crc & 1 ? ( crc >> 1 ) ^ 0x82f63b78 : crc >> 1;
+      }
+      return ~crc;
+   }
+
+   std::vector<char> pseudo_random_bytes( size_t size ) {
+      std::vector<char> data( size );
+      uint64_t x = 0x9e3779b97f4a7c15ull;
+      for( auto& c : data ) {
+         x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+         c = char( x );
+      }
+      return data;
+   }
+
+   template<typename Hash, typename T>
+   Hash unbuffered_hash( const T& value ) {
+      typename Hash::encoder e;
+      fc::raw::pack( e, value );
+      return e.result();
+   }
+}
+
+FC_REFLECT( hash_test::action, (account)(name)(authorization)(data) )
+FC_REFLECT( hash_test::transaction, (expiration)(ref_block_num)(ref_block_prefix)(max_net_usage_words)
+                                    (max_cpu_usage_ms)(delay_sec)(actions)(extensions) )
+
+using namespace hash_test;
+
+BOOST_AUTO_TEST_SUITE(hash_test_suite)
+
+BOOST_AUTO_TEST_CASE(buffered_matches_unbuffered) try {
+   // data sizes around and across the buffer size exercise every path of write()
+   for( size_t data_size : { 0, 1, 63, 64, 65, 200, 255, 256, 257, 1000, 5000 } ) {
+      auto trx = make_transaction( 3, data_size );
+      auto packed = fc::raw::pack( trx );
+
+      BOOST_CHECK_EQUAL( sha256::hash( trx ).str(), sha256::hash( packed.data(), packed.size() ).str() );
+      BOOST_CHECK_EQUAL( sha256::hash( trx ).str(), unbuffered_hash<sha256>( trx ).str() );
+      BOOST_CHECK_EQUAL( fc::digest( trx ).str(), unbuffered_hash<sha256>( trx ).str() );
+      BOOST_CHECK_EQUAL( sha224::hash( trx ).str(), unbuffered_hash<sha224>( trx ).str() );
+      BOOST_CHECK_EQUAL( ripemd160::hash( trx ).str(), unbuffered_hash<ripemd160>( trx ).str() );
+
+      buffered_hash_stream<sha512::encoder> e;
+      fc::raw::pack( e, trx );
+      BOOST_CHECK_EQUAL( e.result().str(), unbuffered_hash<sha512>( trx ).str() );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(reset) try {
+   auto trx = make_transaction( 2, 100 );
+   buffered_hash_stream<sha256::encoder> e;
+   e.write( "garbage", 7 );
+   e.reset();
+   fc::raw::pack( e, trx );
+   BOOST_CHECK_EQUAL( e.result().str(), sha256::hash( trx ).str() );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(hash_many_matches_hash) try {
+   std::string text;
+   for( int i = 0; i < 1000; ++i )
+      text.push_back( char( i * 7 + i / 13 ) );
+
+   // every length up to a few blocks, including both sides of the one/two padding block cut at 55/56
+   std::vector<sha256::input> inputs;
+   for( size_t size = 0; size <= 300; ++size )
+      inputs.push_back( sha256::input{ text.data() + size % 17, size } );
+   inputs.push_back( sha256::input{ text.data(), text.size() } );
+
+   const auto original = sha256::hash_many_engine();
+   for( auto engine : supported_engines() ) {
+      BOOST_TEST_CONTEXT( "engine " << int( engine ) ) {
+         BOOST_REQUIRE( sha256::set_hash_many_engine( engine ) );
+         // counts which leave every number of AVX2 lanes unused
+         for( size_t count : { size_t(1), size_t(2), size_t(7), size_t(8), size_t(9), inputs.size() } ) {
+            std::vector<sha256> out( count );
+            sha256::hash_many( inputs.data(), count, out.data() );
+            for( size_t i = 0; i < count; ++i )
+               BOOST_CHECK_EQUAL( out[i].str(), sha256::hash( inputs[i].data, inputs[i].size ).str() );
+         }
+      }
+   }
+   sha256::set_hash_many_engine( original );
+
+   BOOST_CHECK( sha256::hash_many( std::vector<sha256::input>() ).empty() );
+   BOOST_CHECK_EQUAL( sha256::hash_many( { sha256::input{ "abc", 3 } } ).front().str(),
+                      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(merkle_root) try {
+   BOOST_CHECK( sha256::merkle_root( {} ) == sha256() );
+
+   std::vector<sha256> leaves;
+   for( int i = 0; i < 37; ++i )
+      leaves.push_back( sha256::hash( std::to_string( i ) ) );
+   BOOST_CHECK( sha256::merkle_root( { leaves.front() } ) == leaves.front() );
+
+   const auto original = sha256::hash_many_engine();
+   for( auto engine : supported_engines() ) {
+      BOOST_REQUIRE( sha256::set_hash_many_engine( engine ) );
+      for( size_t n = 1; n <= leaves.size(); ++n ) {
+         std::vector<sha256> prefix( leaves.begin(), leaves.begin() + n );
+         BOOST_CHECK_EQUAL( sha256::merkle_root( prefix ).str(), naive_merkle_root( prefix ).str() );
+      }
+   }
+   sha256::set_hash_many_engine( original );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(merkle_tree_roots) try {
+   std::vector<sha256> leaves;
+   for( int i = 0; i < 300; ++i )
+      leaves.push_back( sha256::hash( std::to_string( i ) ) );
+
+   BOOST_CHECK( merkle_tree().root() == sha256() );
+   for( uint32_t threads : { 1, 4 } ) {
+      merkle_tree one_by_one( threads );
+      for( size_t n = 1; n <= leaves.size(); ++n ) {
+         std::vector<sha256> prefix( leaves.begin(), leaves.begin() + n );
+         const auto expected = naive_merkle_root( prefix );
+
+         one_by_one.append( leaves[n - 1] );
+         BOOST_CHECK_EQUAL( one_by_one.size(), n );
+         BOOST_CHECK_EQUAL( one_by_one.root().str(), expected.str() );
+         BOOST_CHECK_EQUAL( merkle_tree( prefix, threads ).root().str(), expected.str() );
+      }
+
+      // batches which start and end on odd and even positions
+      merkle_tree batches( threads );
+      size_t n = 0;
+      for( size_t batch : { 3, 1, 6, 7, 64, 19 } ) {
+         batches.append( leaves.data() + n, batch );
+         n += batch;
+         BOOST_CHECK_EQUAL( batches.root().str(),
+                            naive_merkle_root( std::vector<sha256>( leaves.begin(), leaves.begin() + n ) ).str() );
+      }
+   }
+
+   // wide enough for the levels to be split between threads
+   std::vector<sha256> many( 20000 );
+   for( size_t i = 0; i < many.size(); ++i )
+      many[i] = sha256::hash( (const char*)&i, sizeof(i) );
+   merkle_tree wide( many, 4 );
+   BOOST_CHECK_EQUAL( wide.root().str(), naive_merkle_root( many ).str() );
+   wide.append( leaves );
+   many.insert( many.end(), leaves.begin(), leaves.end() );
+   BOOST_CHECK_EQUAL( wide.root().str(), naive_merkle_root( many ).str() );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(merkle_tree_proofs) try {
+   for( size_t n : { 1, 2, 5, 8, 13 } ) {
+      std::vector<sha256> leaves;
+      for( size_t i = 0; i < n; ++i )
+         leaves.push_back( sha256::hash( std::to_string( i * 31 ) ) );
+      merkle_tree tree( leaves );
+
+      for( size_t i = 0; i < n; ++i ) {
+         auto p = tree.prove( i );
+         BOOST_CHECK( merkle_tree::verify( leaves[i], p, tree.root() ) );
+         BOOST_CHECK( !merkle_tree::verify( sha256::hash( std::string( "other" ) ), p, tree.root() ) );
+         BOOST_CHECK( !merkle_tree::verify( leaves[i], p, sha256::hash( std::string( "other" ) ) ) );
+
+         // the proof survives a round trip through raw::pack
+         auto unpacked = fc::raw::unpack<merkle_tree::proof>( fc::raw::pack( p ) );
+         BOOST_CHECK( merkle_tree::verify( leaves[i], unpacked, tree.root() ) );
+
+         if( !p.path.empty() ) {
+            auto wrong_side = p;
+            wrong_side.index ^= 1;
+            if( wrong_side.path.front() != leaves[i] )
+               BOOST_CHECK( !merkle_tree::verify( leaves[i], wrong_side, tree.root() ) );
+
+            auto out_of_range = p;
+            out_of_range.index |= uint64_t(1) << p.path.size();
+            BOOST_CHECK( !merkle_tree::verify( leaves[i], out_of_range, tree.root() ) );
+         }
+      }
+   }
+   BOOST_CHECK_THROW( merkle_tree().prove( 0 ), fc::assert_exception );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(crc32c_vectors) try {
+   BOOST_CHECK_EQUAL( crc32c( "", 0 ), 0u );
+   BOOST_CHECK_EQUAL( crc32c( "123456789", 9 ), 0xe3069283u );
+   // RFC 3720 B.4
+   std::vector<char> zeros( 32, 0 ), ones( 32, char( 0xff ) ), ascending( 32 );
+   for( int i = 0; i < 32; ++i ) ascending[i] = char( i );
+   BOOST_CHECK_EQUAL( crc32c( zeros.data(), zeros.size() ), 0x8a9136aau );
+   BOOST_CHECK_EQUAL( crc32c( ones.data(), ones.size() ), 0x62a8ab43u );
+   BOOST_CHECK_EQUAL( crc32c( ascending.data(), ascending.size() ), 0x46dd794eu );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(crc32c_matches_bitwise) try {
+   const auto data = pseudo_random_bytes( 100000 + 8 );
+   // every path: the unaligned head, both interleaved block sizes and the tails
+   for( size_t size : { 1, 7, 8, 9, 63, 255, 767, 768, 769, 1000, 3 * 8192 - 1, 3 * 8192, 3 * 8192 + 777, 100000 } )
+      for( size_t offset = 0; offset < 8; ++offset )
+         BOOST_CHECK_EQUAL( crc32c( data.data() + offset, size ), bitwise_crc32c( data.data() + offset, size ) );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(crc32c_streaming) try {
+   const auto data = pseudo_random_bytes( 50000 );
+   const uint32_t whole = crc32c( data.data(), data.size() );
+   for( size_t split : { 0, 1, 100, 24576, 49999, 50000 } ) {
+      const uint32_t a = crc32c( data.data(), split );
+      const uint32_t b = crc32c( data.data() + split, data.size() - split );
+      BOOST_CHECK_EQUAL( crc32c( data.data() + split, data.size() - split, a ), whole );
+      BOOST_CHECK_EQUAL( crc32c_combine( a, b, data.size() - split ), whole );
+   }
+
+   crc32c_encoder enc;
+   for( size_t pos = 0; pos < data.size(); pos += 333 )
+      enc.write( data.data() + pos, std::min<size_t>( 333, data.size() - pos ) );
+   BOOST_CHECK_EQUAL( enc.result(), whole );
+   enc.reset();
+   BOOST_CHECK_EQUAL( enc.result(), 0u );
+
+   const auto trx = make_transaction( 3, 40 );
+   fc::raw::pack( enc, trx );
+   const auto packed = fc::raw::pack( trx );
+   BOOST_CHECK_EQUAL( enc.result(), crc32c( packed.data(), packed.size() ) );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(city_hash_crc) try {
+   const auto data = pseudo_random_bytes( 5000 );
+   // the crc hashes defer to the plain ones below 900 bytes
+   BOOST_CHECK_EQUAL( city_hash_crc_64( data.data(), 500 ), city_hash64( data.data(), 500 ) );
+   BOOST_CHECK( city_hash_crc_64( data.data(), 5000 ) != city_hash_crc_64( data.data(), 4999 ) );
+
+   // values from before the crc32 instruction was dispatched at run time
+   std::string s;
+   for( int i = 0; i < 5000; ++i ) s.push_back( char( i * 7 ) );
+   BOOST_CHECK_EQUAL( city_hash_crc_128( s.data(), 1000 ).hi, 0x9f12f4eb15994392ull );
+   BOOST_CHECK_EQUAL( city_hash_crc_128( s.data(), 4999 ).lo, 0x8569b85f68d42a53ull );
+   BOOST_CHECK_EQUAL( city_hash_crc_256( s.data(), 241 ).data[0], 0xd090d64a3e60beb6ull );
+   BOOST_CHECK_EQUAL( city_hash_crc_256( s.data(), 4999 ).data[0], 0x9bca7f2a80fb3f22ull );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(merkle_tree_benchmark, * boost::unit_test::disabled()) try {
+   for( size_t count : { 10000, 50000, 200000 } ) {
+      std::vector<sha256> leaves( count );
+      for( size_t i = 0; i < count; ++i )
+         leaves[i] = sha256::hash( (const char*)&i, sizeof(i) );
+
+      auto start = time_point::now();
+      auto naive = naive_merkle_root( leaves );
+      auto naive_time = time_point::now() - start;
+
+      std::cerr << count << " leaves: " << naive_time.count() / 1000.0 << " ms naive";
+      for( uint32_t threads : { 1u, 0u } ) {
+         start = time_point::now();
+         merkle_tree tree( leaves, threads );
+         auto built = time_point::now() - start;
+         FC_ASSERT( tree.root() == naive );
+         std::cerr << ", " << built.count() / 1000.0 << " ms merkle_tree("
+                   << ( threads ? std::to_string( threads ) : std::string( "all cores" ) ) << ")";
+      }
+
+      merkle_tree tree( leaves );
+      const int appends = 1000;
+      start = time_point::now();
+      for( int i = 0; i < appends; ++i )
+         tree.append( leaves[i] );
+      std::cerr << ", " << ( time_point::now() - start ).count() / double( appends ) << " us per appended leaf\n";
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(hash_many_benchmark, * boost::unit_test::disabled()) try {
+   const size_t count = 1 << 16;
+   const auto original = sha256::hash_many_engine();
+   for( size_t size : { 32, 64, 200, 1024 } ) {
+      std::vector<char> data( count * size, 'x' );
+      std::vector<sha256::input> inputs;
+      for( size_t i = 0; i < count; ++i )
+         inputs.push_back( sha256::input{ data.data() + i * size, size } );
+      std::vector<sha256> out( count );
+
+      auto start = time_point::now();
+      for( size_t i = 0; i < count; ++i )
+         out[i] = sha256::hash( inputs[i].data, inputs[i].size );
+      auto one_by_one = time_point::now() - start;
+      std::cerr << size << "-byte messages: " << one_by_one.count() * 1000.0 / count << " ns sha256::hash";
+
+      for( auto engine : supported_engines() ) {
+         sha256::set_hash_many_engine( engine );
+         start = time_point::now();
+         sha256::hash_many( inputs.data(), count, out.data() );
+         auto many = time_point::now() - start;
+         static const char* names[] = { "automatic", "scalar", "avx2", "shani" };
+         std::cerr << ", " << many.count() * 1000.0 / count << " ns " << names[engine];
+      }
+      std::cerr << "\n";
+   }
+
+   std::vector<sha256> leaves( 100000 );
+   for( size_t i = 0; i < leaves.size(); ++i )
+      leaves[i] = sha256::hash( (const char*)&i, sizeof(i) );
+   for( auto engine : supported_engines() ) {
+      sha256::set_hash_many_engine( engine );
+      auto start = time_point::now();
+      sha256::merkle_root( leaves );
+      std::cerr << "merkle root of " << leaves.size() << " leaves, engine " << int( engine ) << ": "
+                << ( time_point::now() - start ).count() / 1000.0 << " ms\n";
+   }
+   auto start = time_point::now();
+   naive_merkle_root( leaves );
+   std::cerr << "merkle root through sha256::encoder: " << ( time_point::now() - start ).count() / 1000.0 << " ms\n";
+   sha256::set_hash_many_engine( original );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(crc32c_benchmark, * boost::unit_test::disabled()) try {
+   const auto data = pseudo_random_bytes( 1 << 20 );
+   for( size_t size : { 64, 4096, 1 << 20 } ) {
+      const size_t rounds = ( size_t( 1 ) << 30 ) / size;
+      uint32_t sink = 0;
+      auto start = time_point::now();
+      for( size_t i = 0; i < rounds; ++i )
+         sink += crc32c( data.data(), size, sink );
+      auto elapsed = time_point::now() - start;
+      std::cerr << size << "-byte buffers: " << double( rounds * size ) / elapsed.count() / 1000 << " GB/s crc32c";
+
+      start = time_point::now();
+      for( size_t i = 0; i < rounds; ++i )
+         sink += city_hash_crc_64( data.data(), size );
+      elapsed = time_point::now() - start;
+      std::cerr << ", " << double( rounds * size ) / elapsed.count() / 1000 << " GB/s city_hash_crc_64 (" << sink % 2 << ")\n";
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(pack_benchmark, * boost::unit_test::disabled()) try {
+   const int iterations = 200000;
+   for( size_t actions : { 1, 4 } ) {
+      auto trx = make_transaction( actions, 32 );
+
+      auto start = time_point::now();
+      for( int i = 0; i < iterations; ++i )
+         unbuffered_hash<sha256>( trx );
+      auto plain = time_point::now() - start;
+
+      start = time_point::now();
+      for( int i = 0; i < iterations; ++i )
+         sha256::hash( trx );
+      auto buffered = time_point::now() - start;
+
+      std::cerr << "sha256 of a transaction with " << actions << " action(s), " << fc::raw::pack_size( trx ) << " bytes: "
+                << plain.count() * 1000.0 / iterations << " ns unbuffered, "
+                << buffered.count() * 1000.0 / iterations << " ns buffered\n";
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,258 @@
+#define BOOST_TEST_MODULE exception
+#include <boost/test/included/unit_test.hpp>
+
+#include <fc/exception/exception.hpp>
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+using namespace fc;
+
+namespace {
+
+   void check_negative( int i ) {
+      FC_ASSERT( i < 0, "value ${i} must be negative", ("i", i) );
+   }
+
+   void validate( int i ) {
+      try {
+         check_negative( i );
+      } FC_RETHROW_EXCEPTIONS( warn, "validating ${i}", ("i", i) )
+   }
+
+   void apply( int i ) {
+      try {
+         validate( i );
+      } FC_RETHROW_EXCEPTIONS( warn, "applying ${i}", ("i", i) )
+   }
+
+   // rethrows through depth levels, noting the log each level appends to
+   void rethrow_through( int depth, std::vector<const log_messages*>& logs, fc::exception_ptr& kept, int keep_at ) {
+      try {
+         if( depth == 0 )
+            check_negative( 1 );
+         else
+            rethrow_through( depth - 1, logs, kept, keep_at );
+      } catch( fc::exception& er ) {
+         if( depth == keep_at ) kept = er.dynamic_copy_exception();
+         logs.push_back( &er.get_log() );
+         FC_RETHROW_EXCEPTION( er, warn, "level ${d}", ("d", depth) );
+      }
+   }
+
+   // restores the default policy when the test is done
+   struct strace_policy_guard {
+      strace_policy_guard( exception::strace_policy::type policy, uint32_t sample_every = 100 ) {
+         exception::set_strace_policy( policy, sample_every );
+      }
+      ~strace_policy_guard() {
+         exception::set_strace_policy( exception::strace_policy::always );
+      }
+   };
+
+   std::string strace_of( void (*f)( int ) ) {
+      try {
+         f( 1 );
+      } catch( const fc::exception& e ) {
+         return e.strace();
+      }
+      BOOST_FAIL( "no exception" );
+      return {};
+   }
+
+}
+
+BOOST_AUTO_TEST_SUITE(exception_test_suite)
+
+BOOST_AUTO_TEST_CASE(rethrow_chain) try {
+   try {
+      apply( 1 );
+      BOOST_FAIL( "no exception" );
+   } catch( const assert_exception& e ) {
+      const auto& log = e.get_log();
+      BOOST_REQUIRE_EQUAL( log.size(), 3u );
+      BOOST_CHECK_EQUAL( log[0].get_message(), "i < 0: value 1 must be negative" );
+      BOOST_CHECK_EQUAL( log[1].get_message(), "validating 1" );
+      BOOST_CHECK_EQUAL( log[2].get_message(), "applying 1" );
+      BOOST_CHECK_EQUAL( log[0].get_data()["i"].as_int64(), 1 );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(strace_policy) try {
+   BOOST_CHECK_EQUAL( exception::get_strace_policy(), exception::strace_policy::always );
+   BOOST_CHECK( !strace_of( check_negative ).empty() );
+   {
+      strace_policy_guard guard( exception::strace_policy::never );
+      BOOST_CHECK( strace_of( check_negative ).empty() );
+      BOOST_CHECK( strace_of( apply ).empty() );
+   }
+   {
+      strace_policy_guard guard( exception::strace_policy::sampled, 3 );
+      size_t captured = 0;
+      for( int i = 0; i < 9; ++i )
+         captured += !strace_of( check_negative ).empty();
+      BOOST_CHECK_EQUAL( captured, 3u );
+   }
+   BOOST_CHECK_THROW( exception::set_strace_policy( exception::strace_policy::sampled, 0 ), assert_exception );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(strace_survives_copy) try {
+   try {
+      check_negative( 1 );
+   } catch( const fc::exception& e ) {
+      fc::exception copy( e );
+      BOOST_CHECK_EQUAL( std::string( copy.strace() ), std::string( e.strace() ) );
+      BOOST_CHECK( !std::string( copy.strace() ).empty() );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(copy_on_append) try {
+   try {
+      apply( 1 );
+   } catch( const fc::exception& e ) {
+      fc::exception copy( e );
+      BOOST_CHECK( copy.what() == e.what() ); // the same string, not a copy of it
+      copy.append_log( FC_LOG_MESSAGE( info, "copy only" ) );
+      BOOST_CHECK_EQUAL( copy.get_log().size(), 4u );
+      BOOST_CHECK_EQUAL( e.get_log().size(), 3u );
+      BOOST_CHECK_EQUAL( std::string( copy.strace() ), std::string( e.strace() ) );
+
+      auto dynamic = e.dynamic_copy_exception();
+      BOOST_CHECK_EQUAL( dynamic->get_log().size(), 3u );
+      BOOST_CHECK_EQUAL( dynamic->code(), assert_exception::code_value );
+
+      fc::exception assigned;
+      assigned = copy;
+      assigned.append_log( FC_LOG_MESSAGE( info, "assigned only" ) );
+      BOOST_CHECK_EQUAL( copy.get_log().size(), 4u );
+      BOOST_CHECK_EQUAL( assigned.get_log().size(), 5u );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(rethrow_chain_appends_in_place) try {
+   // nothing else holds the state, so every level appends to the same log
+   std::vector<const log_messages*> logs;
+   fc::exception_ptr kept;
+   try {
+      rethrow_through( 10, logs, kept, -1 );
+   } catch( const fc::exception& e ) {
+      BOOST_CHECK_EQUAL( e.get_log().size(), 12u );
+      BOOST_REQUIRE_EQUAL( logs.size(), 11u );
+      for( auto log : logs )
+         BOOST_CHECK( log == &e.get_log() );
+   }
+
+   // a copy kept along the way makes the next level copy the log, once
+   logs.clear();
+   try {
+      rethrow_through( 10, logs, kept, 5 );
+   } catch( const fc::exception& e ) {
+      BOOST_REQUIRE_EQUAL( logs.size(), 11u );
+      for( size_t i = 0; i < logs.size(); ++i )
+         BOOST_CHECK( logs[i] == ( i < 6 ? logs[0] : &e.get_log() ) );
+      BOOST_CHECK( logs[0] != &e.get_log() );
+      BOOST_CHECK_EQUAL( kept->get_log().size(), 6u );
+      BOOST_CHECK_EQUAL( e.get_log().size(), 12u );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(copy_on_append_across_threads) try {
+   fc::exception_ptr shared;
+   try {
+      apply( 1 );
+   } catch( const fc::exception& e ) {
+      shared = e.dynamic_copy_exception();
+   }
+   BOOST_REQUIRE( shared );
+
+   // copies come and go on every thread while each appends to its own
+   const int rounds = 2000;
+   std::vector<std::thread> threads;
+   std::atomic<bool> ok{ true };
+   for( int t = 0; t < 4; ++t )
+      threads.emplace_back( [&, t]() {
+         for( int i = 0; i < rounds; ++i ) {
+            fc::exception copy( *shared );
+            auto dynamic = copy.dynamic_copy_exception();
+            copy.append_log( FC_LOG_MESSAGE( info, "thread ${t}", ("t", t) ) );
+            dynamic->append_log( FC_LOG_MESSAGE( info, "dynamic" ) );
+            dynamic->append_log( FC_LOG_MESSAGE( info, "dynamic" ) );
+            if( copy.get_log().size() != 4 || dynamic->get_log().size() != 5 || shared->get_log().size() != 3 )
+               ok = false;
+         }
+      } );
+   for( auto& t : threads )
+      t.join();
+   BOOST_CHECK( ok );
+   BOOST_CHECK_EQUAL( shared->get_log().back().get_message(), "applying 1" );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(across_threads) try {
+   fc::exception_ptr caught;
+   std::thread worker( [&]() {
+      try {
+         apply( 1 );
+      } catch( const fc::exception& e ) {
+         caught = e.dynamic_copy_exception();
+      }
+   } );
+   worker.join();
+   BOOST_REQUIRE( caught );
+
+   // strace() of copies on several threads symbolizes once, all see the same string
+   std::vector<fc::exception> copies( 4, *caught );
+   std::vector<std::string> straces( copies.size() );
+   std::vector<std::thread> readers;
+   for( size_t i = 0; i < copies.size(); ++i )
+      readers.emplace_back( [&, i]() { straces[i] = copies[i].strace(); } );
+   for( auto& t : readers )
+      t.join();
+   for( const auto& s : straces )
+      BOOST_CHECK_EQUAL( s, straces.front() );
+
+   try {
+      caught->dynamic_rethrow_exception();
+   } catch( const assert_exception& e ) {
+      BOOST_CHECK_EQUAL( e.get_log().size(), 3u );
+      BOOST_CHECK_EQUAL( e.get_log()[2].get_message(), "applying 1" );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(copy_benchmark, * boost::unit_test::disabled()) try {
+   const int iterations = 1000000;
+   fc::exception e;
+   for( int i = 0; i < 10; ++i )
+      e.append_log( FC_LOG_MESSAGE( warn, "level ${i}", ("i", i) ) );
+   auto start = time_point::now();
+   for( int i = 0; i < iterations; ++i )
+      auto copy = e.dynamic_copy_exception();
+   auto elapsed = time_point::now() - start;
+   std::cerr << "dynamic_copy_exception with 10 messages: " << elapsed.count() * 1000.0 / iterations << " ns\n";
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(throw_benchmark, * boost::unit_test::disabled()) try {
+   const int iterations = 100000;
+   const std::pair<exception::strace_policy::type, const char*> policies[] = {
+      { exception::strace_policy::always, "always" },
+      { exception::strace_policy::sampled, "sampled" },
+      { exception::strace_policy::never, "never" },
+   };
+   for( const auto& policy : policies ) {
+      strace_policy_guard guard( policy.first );
+      for( auto f : { check_negative, apply } ) {
+         auto start = time_point::now();
+         for( int i = 0; i < iterations; ++i ) {
+            try {
+               f( i );
+            } catch( const fc::exception& ) {
+            }
+         }
+         auto elapsed = time_point::now() - start;
+         std::cerr << ( f == check_negative ? "FC_ASSERT" : "FC_ASSERT + 2 FC_RETHROW_EXCEPTIONS" )
+                   << ", strace " << policy.second << ": " << elapsed.count() * 1000.0 / iterations << " ns\n";
+      }
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,433 @@
+#define BOOST_TEST_MODULE interprocess
+#include <boost/test/included/unit_test.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/interprocess/file_mapping.hpp>
+#include <fc/interprocess/mmap_struct.hpp>
+#include <fc/interprocess/record_log.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/time.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+using namespace fc;
+
+namespace interprocess_test {
+   struct counters {
+      uint64_t   values[512];
+   };
+
+   struct entry {
+      uint64_t                  id = 0;
+      std::string               name;
+      std::vector<char>         data;
+   };
+
+   uint64_t next_random( uint64_t& x ) {
+      x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+      return x;
+   }
+
+   /** Record @p i of the test logs: its number, then filler up to a size that varies with it */
+   std::string make_record( uint64_t i ) {
+      uint64_t x = i * 0x9e3779b97f4a7c15ull + 1;
+      std::string r = std::to_string( i ) + ":";
+      r.resize( r.size() + next_random( x ) % 300, char( 'a' + i % 26 ) );
+      return r;
+   }
+
+   std::string read_record( const record_log& log, uint64_t seq ) {
+      auto ds = log.read( seq );
+      return std::string( ds.pos(), ds.remaining() );
+   }
+
+   /** What a crash would leave of @p from: a copy of its first @p size bytes */
+   void copy_image( const fc::path& from, const fc::path& to, size_t size = std::string::npos ) {
+      std::ifstream in( from.generic_string().c_str(), std::ios::binary );
+      std::string content( (std::istreambuf_iterator<char>( in )), std::istreambuf_iterator<char>() );
+      std::ofstream out( to.generic_string().c_str(), std::ios::binary | std::ios::trunc );
+      out.write( content.data(), std::min( size, content.size() ) );
+   }
+
+   /** A file of @p size bytes of zeros, written out the way mmap_struct used to */
+   void write_zeros( const fc::path& file, size_t size ) {
+      std::ofstream out( file.generic_string().c_str() );
+      char buffer[1024];
+      memset( buffer, 0, sizeof(buffer) );
+      for( size_t left = size; left > 0; ) {
+         const size_t n = std::min<size_t>( left, sizeof(buffer) );
+         out.write( buffer, n );
+         left -= n;
+      }
+   }
+}
+
+FC_REFLECT( interprocess_test::entry, (id)(name)(data) )
+
+using namespace interprocess_test;
+
+BOOST_AUTO_TEST_SUITE(interprocess_test_suite)
+
+BOOST_AUTO_TEST_CASE(mmap_struct_create) try {
+   temp_directory dir;
+   const fc::path file = dir.path() / "counters";
+   {
+      mmap_struct<counters> c;
+      c.open( file, true );
+      BOOST_CHECK_EQUAL( c.size(), sizeof(counters) );
+      BOOST_CHECK_EQUAL( fc::file_size( file ), sizeof(counters) );
+      for( auto v : c->values ) BOOST_CHECK_EQUAL( v, 0u );
+      c->values[7] = 42;
+      c.flush();
+   }
+   {
+      // the right size is kept as it is
+      mmap_struct<counters> c;
+      c.open( file, true, mapped_region::prefault_map );
+      BOOST_CHECK_EQUAL( c->values[7], 42u );
+   }
+
+   // a file of the wrong size starts over as zeros
+   write_zeros( file, 100 );
+   {
+      std::ofstream out( file.generic_string().c_str(), std::ios::in | std::ios::out );
+      out << "garbage";
+   }
+   mmap_struct<counters> c;
+   c.open( file, true );
+   BOOST_CHECK_EQUAL( fc::file_size( file ), sizeof(counters) );
+   for( auto v : c->values ) BOOST_CHECK_EQUAL( v, 0u );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(mapped_region_flags) try {
+   temp_directory dir;
+   const fc::path file = dir.path() / "region";
+   const size_t page = mapped_region::page_size();
+   BOOST_CHECK( page >= 4096 && ( page & ( page - 1 ) ) == 0 );
+   const size_t size = 64 * page;
+   write_zeros( file, size );
+
+   file_mapping fm( file.generic_string().c_str(), read_write );
+   for( uint32_t flags : std::initializer_list<uint32_t>{ mapped_region::default_map, mapped_region::prefault_map, mapped_region::huge_pages,
+                           mapped_region::prefault_map | mapped_region::huge_pages } ) {
+      mapped_region region( fm, read_write, 0, size, flags );
+      BOOST_REQUIRE_EQUAL( region.get_size(), size );
+      char* p = (char*)region.get_address();
+      p[flags * page + 1] = char( 1 + flags );
+      region.flush();
+   }
+
+   mapped_region region( fm, read_only, 0, size, mapped_region::default_map );
+   const char* p = (const char*)region.get_address();
+   for( uint32_t flags = 0; flags < 4; ++flags )
+      BOOST_CHECK_EQUAL( int( p[flags * page + 1] ), int( 1 + flags ) );
+
+   // locking may be refused for want of RLIMIT_MEMLOCK, but must not break the mapping either way
+   if( region.lock() ) region.unlock();
+   BOOST_CHECK_EQUAL( int( p[1] ), 1 );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(mapped_region_advise) try {
+   temp_directory dir;
+   const fc::path file = dir.path() / "region";
+   const size_t page = mapped_region::page_size();
+   const size_t size = 16 * page;
+   write_zeros( file, size );
+
+   file_mapping fm( file.generic_string().c_str(), read_write );
+   mapped_region region( fm, read_write, 0, size );
+   char* p = (char*)region.get_address();
+   memset( p, 'x', size );
+   region.flush();
+
+#ifndef _WIN32
+   for( auto a : { mapped_region::normal_access, mapped_region::sequential_access, mapped_region::random_access,
+                   mapped_region::will_need, mapped_region::dont_need } ) {
+      BOOST_CHECK( region.advise( a ) );
+      BOOST_CHECK( region.advise( a, page + 5, 3 * page ) );
+      BOOST_CHECK( region.advise( a, size, 0 ) );
+   }
+#endif
+   BOOST_CHECK_THROW( region.advise( mapped_region::will_need, size - page, 2 * page ), fc::assert_exception );
+   BOOST_CHECK_THROW( region.advise( mapped_region::will_need, size + 1, 0 ), fc::assert_exception );
+
+   // a shared mapping reads dropped pages back from the file
+   region.prefault();
+   region.prefault( true );
+   for( size_t i = 0; i < size; i += 97 ) BOOST_REQUIRE_EQUAL( p[i], 'x' );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(mmap_struct_benchmark, * boost::unit_test::disabled()) try {
+   struct big { char data[256 * 1024 * 1024]; };
+   temp_directory dir;
+   const fc::path file = dir.path() / "big";
+   const size_t page = mapped_region::page_size();
+
+   auto start = time_point::now();
+   write_zeros( file, sizeof(big) );
+   std::cerr << "writing " << sizeof(big) / ( 1024 * 1024 ) << " MB of zeros: "
+             << ( time_point::now() - start ).count() / 1000 << " ms\n";
+   fc::remove( file );
+
+   start = time_point::now();
+   {
+      mmap_struct<big> m;
+      m.open( file, true );
+      std::cerr << "creating it with mmap_struct: " << ( time_point::now() - start ).count() / 1000 << " ms\n";
+   }
+   fc::remove( file );
+
+   for( uint32_t flags : std::initializer_list<uint32_t>{ mapped_region::default_map, mapped_region::prefault_map,
+                           mapped_region::prefault_map | mapped_region::huge_pages } ) {
+      mmap_struct<big> m;
+      start = time_point::now();
+      m.open( file, true, flags );
+      const auto opened = time_point::now() - start;
+      start = time_point::now();
+      for( size_t i = 0; i < sizeof(big); i += page ) m->data[i] = 1;
+      const auto touched = time_point::now() - start;
+      std::cerr << "flags " << flags << ": open " << opened.count() / 1000 << " ms, first write to every page "
+                << touched.count() / 1000 << " ms\n";
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(record_log_round_trip) try {
+   temp_directory dir;
+   const fc::path file = dir.path() / "records";
+   const uint64_t count = 5000;
+   uint64_t bytes = 0;
+   {
+      record_log log( file );
+      BOOST_CHECK( log.is_open() );
+      BOOST_CHECK_EQUAL( log.size(), 0u );
+      for( uint64_t i = 0; i < count; ++i ) {
+         const auto r = make_record( i );
+         BOOST_REQUIRE_EQUAL( log.append( r.data(), r.size() ), i );
+      }
+      // empty, and large enough to grow the files more than once
+      BOOST_CHECK_EQUAL( log.append( nullptr, 0 ), count );
+      const std::string big( 5 * 1024 * 1024, 'z' );
+      BOOST_CHECK_EQUAL( log.append( big.data(), big.size() ), count + 1 );
+      BOOST_CHECK_EQUAL( log.size(), count + 2 );
+
+      for( uint64_t i = 0; i < count; i += 7 )
+         BOOST_REQUIRE_EQUAL( read_record( log, i ), make_record( i ) );
+      BOOST_CHECK_EQUAL( read_record( log, count ), "" );
+      BOOST_CHECK( read_record( log, count + 1 ) == big );
+      BOOST_CHECK( log.verify( count + 1 ) );
+      BOOST_CHECK_THROW( log.read( count + 2 ), fc::out_of_range_exception );
+      BOOST_CHECK_THROW( log.verify( count + 2 ), fc::out_of_range_exception );
+      BOOST_CHECK_THROW( log.open( file ), fc::assert_exception );
+      bytes = log.bytes();
+   }
+
+   // closed, the files are down to their content
+   BOOST_CHECK_EQUAL( fc::file_size( file ), bytes );
+   BOOST_CHECK_EQUAL( fc::file_size( file.generic_string() + ".index" ), 16 + ( count + 2 ) * 8 );
+   record_log log;
+   BOOST_CHECK( !log.is_open() );
+   BOOST_CHECK_THROW( log.append( "x", 1 ), fc::assert_exception );
+   log.open( file );
+   BOOST_REQUIRE_EQUAL( log.size(), count + 2 );
+   BOOST_CHECK_EQUAL( log.bytes(), bytes );
+   BOOST_CHECK_LT( log.bytes(), 6 * 1024 * 1024 + count * 320 );
+
+   uint64_t next = 100;
+   log.for_each( 100, [&]( uint64_t seq, datastream<const char*>& ds ) {
+      BOOST_REQUIRE_EQUAL( seq, next++ );
+      if( seq < count )
+         BOOST_REQUIRE_EQUAL( std::string( ds.pos(), ds.remaining() ), make_record( seq ) );
+   } );
+   BOOST_CHECK_EQUAL( next, count + 2 );
+   log.for_each( count + 2, []( uint64_t, datastream<const char*>& ) { BOOST_FAIL( "past the end" ); } );
+
+   const auto r = make_record( count + 2 );
+   BOOST_CHECK_EQUAL( log.append( r.data(), r.size() ), count + 2 );
+   BOOST_CHECK_EQUAL( read_record( log, count + 2 ), r );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(record_log_pack) try {
+   temp_directory dir;
+   record_log log( dir.path() / "entries" );
+   for( uint64_t i = 0; i < 100; ++i ) {
+      entry e{ i, "entry " + std::to_string( i ), std::vector<char>( i, char(i) ) };
+      BOOST_REQUIRE_EQUAL( log.pack( e ), i );
+   }
+   for( uint64_t i = 0; i < 100; ++i ) {
+      const auto e = log.unpack<entry>( i );
+      BOOST_REQUIRE_EQUAL( e.id, i );
+      BOOST_REQUIRE_EQUAL( e.name, "entry " + std::to_string( i ) );
+      BOOST_REQUIRE( e.data == std::vector<char>( i, char(i) ) );
+   }
+   // zero-copy: the stream points into the mapping
+   auto ds = log.read( 42 );
+   uint64_t id = 0;
+   fc::raw::unpack( ds, id );
+   BOOST_CHECK_EQUAL( id, 42u );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(record_log_recovery) try {
+   temp_directory dir;
+   const fc::path file = dir.path() / "records";
+   const fc::path crashed = dir.path() / "crashed";
+   const fc::path index = file.generic_string() + ".index";
+   const fc::path crashed_index = crashed.generic_string() + ".index";
+   auto reopen = [&]( size_t log_size ) {
+      copy_image( file, crashed, log_size );
+      copy_image( index, crashed_index );
+      record_log log( crashed );
+      for( uint64_t i = 0; i < log.size(); ++i )
+         BOOST_REQUIRE_EQUAL( read_record( log, i ), make_record( i ) );
+      return log.size();
+   };
+
+   record_log log( file );
+   uint64_t offsets[301];
+   for( uint64_t i = 0; i < 300; ++i ) {
+      offsets[i] = log.bytes();
+      const auto r = make_record( i );
+      log.append( r.data(), r.size() );
+      if( i == 99 ) log.flush();
+   }
+   offsets[300] = log.bytes();
+
+   // what the index has since its last flush, and whatever follows in the log, is checked record by record
+   BOOST_CHECK_EQUAL( reopen( std::string::npos ), 300u );
+   BOOST_CHECK_EQUAL( reopen( offsets[300] ), 300u );
+   BOOST_CHECK_EQUAL( reopen( offsets[250] + 11 ), 250u );
+   BOOST_CHECK_EQUAL( reopen( offsets[250] + 3 ), 250u );
+   BOOST_CHECK_EQUAL( reopen( offsets[150] ), 150u );
+   // an index ahead of the log is thrown away and rebuilt
+   BOOST_CHECK_EQUAL( reopen( offsets[60] + 20 ), 60u );
+   BOOST_CHECK_EQUAL( reopen( 5 ), 0u );
+
+   // a damaged record ends the log
+   copy_image( file, crashed );
+   copy_image( index, crashed_index );
+   {
+      std::fstream f( crashed.generic_string().c_str(), std::ios::in | std::ios::out | std::ios::binary );
+      f.seekp( offsets[200] + 12 );
+      f.put( '!' );
+   }
+   BOOST_CHECK_EQUAL( record_log( crashed ).size(), 200u );
+   // and stays cut off there, even where the records after it were intact
+   {
+      record_log again( crashed );
+      BOOST_CHECK_EQUAL( again.size(), 200u );
+      const auto r = make_record( 200 );
+      again.append( r.data(), r.size() );
+      BOOST_CHECK_EQUAL( read_record( again, 200 ), r );
+   }
+
+   // without its index, or with another log's, the log is read from the start
+   log.flush();
+   copy_image( file, crashed );
+   fc::remove( crashed_index );
+   BOOST_CHECK_EQUAL( record_log( crashed ).size(), 300u );
+   {
+      record_log other( dir.path() / "other" );
+      const std::string r = "other";
+      for( int i = 0; i < 400; ++i ) other.append( r.data(), r.size() );
+   }
+   copy_image( dir.path() / "other.index", crashed_index );
+   copy_image( file, crashed );
+   BOOST_CHECK_EQUAL( record_log( crashed ).size(), 300u );
+
+   copy_image( index, dir.path() / "junk" );
+   BOOST_CHECK_THROW( record_log( dir.path() / "junk" ), fc::parse_error_exception );
+   // a failed open leaves nothing behind, and the same log opens another file after it
+   record_log reused;
+   BOOST_CHECK_THROW( reused.open( dir.path() / "junk" ), fc::parse_error_exception );
+   BOOST_CHECK( !reused.is_open() );
+   BOOST_CHECK_EQUAL( reused.size(), 0u );
+   BOOST_CHECK_EQUAL( reused.bytes(), 0u );
+   reused.open( crashed );
+   BOOST_CHECK_EQUAL( reused.size(), 300u );
+   BOOST_CHECK_EQUAL( read_record( reused, 299 ), make_record( 299 ) );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(record_log_truncate) try {
+   temp_directory dir;
+   const fc::path file = dir.path() / "records";
+   record_log log( file );
+   for( uint64_t i = 0; i < 100; ++i ) {
+      const auto r = make_record( i );
+      log.append( r.data(), r.size() );
+   }
+   log.flush();
+   log.truncate( 200 );
+   BOOST_CHECK_EQUAL( log.size(), 100u );
+   log.truncate( 40 );
+   BOOST_CHECK_EQUAL( log.size(), 40u );
+   BOOST_CHECK_THROW( log.read( 40 ), fc::out_of_range_exception );
+
+   // a shorter record where the dropped ones were doesn't bring them back after a crash
+   log.append( "x", 1 );
+   copy_image( file, dir.path() / "crashed" );
+   copy_image( file.generic_string() + ".index", dir.path() / "crashed.index" );
+   BOOST_CHECK_EQUAL( record_log( dir.path() / "crashed" ).size(), 41u );
+
+   log.truncate( 0 );
+   BOOST_CHECK_EQUAL( log.size(), 0u );
+   const auto r = make_record( 0 );
+   log.append( r.data(), r.size() );
+   log.close();
+   log.open( file );
+   BOOST_REQUIRE_EQUAL( log.size(), 1u );
+   BOOST_CHECK_EQUAL( read_record( log, 0 ), r );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(record_log_benchmark, * boost::unit_test::disabled()) try {
+   temp_directory dir;
+   const fc::path file = dir.path() / "records";
+   const uint64_t count = 2000000;
+   const std::string record( 200, 'r' );
+   {
+      record_log log( file );
+      auto start = time_point::now();
+      for( uint64_t i = 0; i < count; ++i )
+         log.append( record.data(), record.size() );
+      auto elapsed = time_point::now() - start;
+      std::cerr << "append " << count << " records of " << record.size() << " bytes: "
+                << double( count ) / elapsed.count() << "M records/s, "
+                << double( log.bytes() ) / elapsed.count() << " MB/s\n";
+      start = time_point::now();
+      log.flush();
+      std::cerr << "flush " << log.bytes() / ( 1024 * 1024 ) << " MB: " << ( time_point::now() - start ).count() / 1000 << " ms\n";
+
+      entry e{ 1, "an entry", std::vector<char>( 150, 'e' ) };
+      start = time_point::now();
+      for( uint64_t i = 0; i < count / 4; ++i )
+         log.pack( e );
+      std::cerr << "pack " << count / 4 << " entries: " << double( count / 4 ) / ( time_point::now() - start ).count() << "M entries/s\n";
+   }
+
+   auto start = time_point::now();
+   record_log log( file );
+   std::cerr << "reopen " << log.size() << " records: " << ( time_point::now() - start ).count() << " us\n";
+
+   uint64_t x = 1, sum = 0;
+   const uint64_t reads = 2000000;
+   start = time_point::now();
+   for( uint64_t i = 0; i < reads; ++i )
+      sum += *log.read( next_random( x ) % count ).pos();
+   auto elapsed = time_point::now() - start;
+   std::cerr << "random read: " << double( reads ) / elapsed.count() << "M records/s\n";
+
+   start = time_point::now();
+   for( uint64_t i = 0; i < reads; ++i )
+      sum += log.verify( next_random( x ) % count );
+   std::cerr << "random read and verify: " << double( reads ) / ( time_point::now() - start ).count() << "M records/s\n";
+
+   start = time_point::now();
+   log.for_each( 0, [&]( uint64_t, datastream<const char*>& ds ) { sum += ds.remaining(); } );
+   elapsed = time_point::now() - start;
+   std::cerr << "for_each: " << double( log.size() ) / elapsed.count() << "M records/s\n";
+   BOOST_CHECK( sum > 0 );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_SUITE_END()
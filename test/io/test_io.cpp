@@ -0,0 +1,224 @@
+#define BOOST_TEST_MODULE io
+#include <boost/test/included/unit_test.hpp>
+
+#include <stdint.h>
+
+namespace try_unpack_test {
+   // reflected, but with a wire format of its own: b first, and a limited to 8 bits
+   struct own_format {
+      uint32_t   a = 0;
+      uint32_t   b = 0;
+   };
+}
+
+// declared ahead of fc/io/raw.hpp, as in raw_fwd.hpp, so that the containers find them
+namespace fc { namespace raw {
+   template<typename Stream> void pack( Stream& s, const try_unpack_test::own_format& v );
+   template<typename Stream> void unpack( Stream& s, try_unpack_test::own_format& v );
+} }
+
+#include <fc/io/raw.hpp>
+#include <fc/io/raw_try_unpack.hpp>
+#include <fc/static_variant.hpp>
+
+#include <iostream>
+#include <limits>
+
+using namespace fc;
+
+namespace try_unpack_test {
+   enum class color { red, green };
+
+   struct item {
+      std::string                name;
+      std::vector<uint32_t>      values;
+      fc::optional<bool>         flag;
+   };
+
+   struct document {
+      uint64_t                               id = 0;
+      color                                  shade = color::red;
+      std::vector<item>                      items;
+      std::map<std::string, int32_t>         index;
+      fc::static_variant<int64_t, std::string> payload;
+      fc::time_point_sec                     created;
+   };
+
+   bool operator==( const item& a, const item& b ) {
+      return a.name == b.name && a.values == b.values && a.flag == b.flag;
+   }
+
+   document sample() {
+      document d;
+      d.id = 42;
+      d.shade = color::green;
+      d.items = { { "first", { 1, 2, 3 }, {} }, { "second", {}, true } };
+      d.index = { { "a", 1 }, { "b", -2 } };
+      d.payload = std::string( "payload" );
+      d.created = fc::time_point_sec( 1000000 );
+      return d;
+   }
+
+   void check_equal( const document& a, const document& b ) {
+      BOOST_CHECK_EQUAL( a.id, b.id );
+      BOOST_CHECK( a.shade == b.shade );
+      BOOST_CHECK( a.items == b.items );
+      BOOST_CHECK( a.index == b.index );
+      BOOST_CHECK_EQUAL( a.payload.which(), b.payload.which() );
+      BOOST_CHECK_EQUAL( a.payload.get<std::string>(), b.payload.get<std::string>() );
+      BOOST_CHECK( a.created == b.created );
+   }
+}
+
+FC_REFLECT_ENUM( try_unpack_test::color, (red)(green) )
+FC_REFLECT( try_unpack_test::item, (name)(values)(flag) )
+FC_REFLECT( try_unpack_test::document, (id)(shade)(items)(index)(payload)(created) )
+FC_REFLECT( try_unpack_test::own_format, (a)(b) )
+
+namespace fc { namespace raw {
+   template<typename Stream>
+   void pack( Stream& s, const try_unpack_test::own_format& v ) {
+      fc::raw::pack( s, v.b );
+      fc::raw::pack( s, uint8_t( v.a ) );
+   }
+   template<typename Stream>
+   void unpack( Stream& s, try_unpack_test::own_format& v ) {
+      uint8_t a;
+      fc::raw::unpack( s, v.b );
+      fc::raw::unpack( s, a );
+      FC_ASSERT( a != 0xff, "reserved" );
+      v.a = a;
+   }
+} }
+
+using namespace try_unpack_test;
+
+BOOST_AUTO_TEST_SUITE(raw_test_suite)
+
+BOOST_AUTO_TEST_CASE(try_unpack_matches_unpack) try {
+   const auto data = raw::pack( sample() );
+
+   document decoded;
+   auto st = raw::try_unpack( data, decoded );
+   BOOST_REQUIRE_MESSAGE( st, st.to_string() );
+   BOOST_CHECK_EQUAL( st.to_string(), "ok" );
+   check_equal( decoded, raw::unpack<document>( data ) );
+
+   // every truncation is reported where unpack() would throw
+   for( size_t size = 0; size < data.size(); ++size ) {
+      document partial;
+      auto st = raw::try_unpack( data.data(), size, partial );
+      BOOST_REQUIRE( !st );
+      BOOST_CHECK_EQUAL( st.kind(), raw::unpack_status::out_of_range );
+      BOOST_CHECK_LE( st.offset(), size );
+      BOOST_CHECK_THROW( raw::unpack<document>( data.data(), size ), fc::exception );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(type_path) try {
+   auto d = sample();
+   auto data = raw::pack( d );
+
+   // "second" is the 2nd item's name, its flag follows the empty values vector
+   const auto name_pos = std::search( data.begin(), data.end(), std::begin( "second" ), std::end( "second" ) - 1 ) - data.begin();
+   const size_t flag_pos = name_pos + 6 + 1;
+   BOOST_REQUIRE_EQUAL( data[flag_pos], 1 );
+   data[flag_pos + 1] = 2;
+
+   document decoded;
+   auto st = raw::try_unpack( data, decoded );
+   BOOST_REQUIRE( !st );
+   BOOST_CHECK_EQUAL( st.kind(), raw::unpack_status::invalid_value );
+   BOOST_CHECK_EQUAL( st.offset(), flag_pos + 1 );
+   BOOST_CHECK_EQUAL( st.type_path(), "try_unpack_test::document.items[1].flag (bool)" );
+   BOOST_CHECK_EQUAL( st.to_string(), "invalid value at byte " + std::to_string( flag_pos + 1 ) +
+                                      " in try_unpack_test::document.items[1].flag (bool)" );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(invalid_sizes_and_tags) try {
+   {
+      const auto data = raw::pack( unsigned_int( MAX_NUM_ARRAY_ELEMENTS + 1 ) );
+      std::vector<item> items;
+      auto st = raw::try_unpack( data, items );
+      BOOST_CHECK_EQUAL( st.kind(), raw::unpack_status::too_large );
+      BOOST_CHECK_EQUAL( st.offset(), 0u );
+   }
+   {
+      const auto data = raw::pack( unsigned_int( 2 ) );
+      fc::static_variant<int64_t, std::string> sv;
+      auto st = raw::try_unpack( data, sv );
+      BOOST_CHECK_EQUAL( st.kind(), raw::unpack_status::invalid_value );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(own_unpack_overload) try {
+   const std::vector<own_format> values = { { 1, 2 }, { 200, 70000 } };
+   const auto data = raw::pack( values );
+   BOOST_REQUIRE_EQUAL( data.size(), 1 + 2 * 5u );
+
+   std::vector<own_format> decoded;
+   auto st = raw::try_unpack( data, decoded );
+   BOOST_REQUIRE_MESSAGE( st, st.to_string() );
+   const auto expected = raw::unpack<std::vector<own_format>>( data );
+   BOOST_REQUIRE_EQUAL( decoded.size(), 2u );
+   for( size_t i = 0; i < 2; ++i ) {
+      BOOST_CHECK_EQUAL( decoded[i].a, values[i].a );
+      BOOST_CHECK_EQUAL( decoded[i].b, values[i].b );
+      BOOST_CHECK_EQUAL( decoded[i].a, expected[i].a );
+      BOOST_CHECK_EQUAL( decoded[i].b, expected[i].b );
+   }
+
+   // what the overload rejects by throwing is reported, not thrown
+   auto bad = data;
+   bad.back() = char( 0xff );
+   st = raw::try_unpack( bad, decoded );
+   BOOST_CHECK_EQUAL( st.kind(), raw::unpack_status::exception );
+   BOOST_CHECK_EQUAL( st.offset(), 1 + 5u );
+   BOOST_CHECK_THROW( raw::unpack<std::vector<own_format>>( bad ), fc::exception );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(overlong_signed_int) try {
+   for( int32_t v : { 0, -1, 1, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max() } ) {
+      signed_int decoded;
+      auto st = raw::try_unpack( raw::pack( signed_int( v ) ), decoded );
+      BOOST_REQUIRE_MESSAGE( st, st.to_string() );
+      BOOST_CHECK_EQUAL( decoded.value, v );
+   }
+
+   // continuation bits past the 5th byte, which would shift past 32 bits
+   for( size_t continued : { 5, 6, 10 } ) {
+      std::vector<char> data( continued, char( 0xff ) );
+      data.push_back( 0x01 );
+      signed_int decoded;
+      auto st = raw::try_unpack( data, decoded );
+      BOOST_CHECK_EQUAL( st.kind(), raw::unpack_status::invalid_value );
+      BOOST_CHECK_EQUAL( st.offset(), 0u );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(malformed_benchmark, * boost::unit_test::disabled()) try {
+   const int iterations = 100000;
+   const auto data = raw::pack( sample() );
+   const size_t size = data.size() - 1;
+
+   auto start = time_point::now();
+   for( int i = 0; i < iterations; ++i ) {
+      try {
+         raw::unpack<document>( data.data(), size );
+      } catch( const fc::exception& ) {
+      }
+   }
+   auto throwing = time_point::now() - start;
+
+   start = time_point::now();
+   for( int i = 0; i < iterations; ++i ) {
+      document d;
+      auto st = raw::try_unpack( data.data(), size, d );
+      BOOST_REQUIRE( !st );
+   }
+   auto status = time_point::now() - start;
+   std::cerr << "truncated document: unpack " << throwing.count() * 1000.0 / iterations << " ns, try_unpack "
+             << status.count() * 1000.0 / iterations << " ns\n";
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,423 @@
+#define BOOST_TEST_MODULE log
+#include <boost/test/included/unit_test.hpp>
+
+#include <boost/asio.hpp>
+
+#include <fc/log/console_appender.hpp>
+#include <fc/log/gelf_appender.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/io/json.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace fc;
+using boost::asio::ip::udp;
+using boost::asio::ip::tcp;
+
+namespace {
+
+   // stands in for a graylog server: collects whatever datagrams arrived
+   std::vector<std::string> receive_datagrams( udp::socket& sock, size_t expected ) {
+      std::vector<std::string> result;
+      std::vector<char> buffer( 65536 );
+      sock.non_blocking( true );
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 5 );
+      while( result.size() < expected && std::chrono::steady_clock::now() < deadline ) {
+         boost::system::error_code ec;
+         udp::endpoint from;
+         size_t n = sock.receive_from( boost::asio::buffer( buffer ), from, 0, ec );
+         if( ec == boost::asio::error::would_block ) {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+            continue;
+         }
+         BOOST_REQUIRE( !ec );
+         result.emplace_back( buffer.data(), n );
+      }
+      return result;
+   }
+
+   // points stdout at @p path for as long as it lives
+   struct redirect_stdout {
+      redirect_stdout( const char* path ) {
+         fflush( stdout );
+         saved = dup( STDOUT_FILENO );
+         int fd = open( path, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+         dup2( fd, STDOUT_FILENO );
+         close( fd );
+      }
+      ~redirect_stdout() {
+         fflush( stdout );
+         dup2( saved, STDOUT_FILENO );
+         close( saved );
+      }
+      int saved;
+   };
+
+   console_appender::config stdout_config() {
+      console_appender::config cfg;
+      cfg.stream = console_appender::stream::std_out;
+      return cfg;
+   }
+
+   variant gelf_config( uint16_t port, mutable_variant_object args ) {
+      return args( "endpoint", "127.0.0.1:" + std::to_string( port ) )( "host", "test" );
+   }
+
+   // keeps the messages it was given
+   struct capture_appender : appender {
+      void initialize( boost::asio::io_service& ) override {}
+      void log( const log_message& m ) override { messages.push_back( m.get_message() ); }
+      std::vector<std::string> messages;
+   };
+
+   // sums up the messages let through and the ones reported as suppressed
+   std::pair<uint64_t, uint64_t> count_messages( const std::vector<std::string>& messages ) {
+      uint64_t logged = 0, suppressed = 0;
+      for( const auto& m : messages ) {
+         if( m.rfind( "suppressed ", 0 ) == 0 )
+            suppressed += std::stoull( m.substr( 11 ) );
+         else
+            ++logged;
+      }
+      return { logged, suppressed };
+   }
+
+   logger capture_logger( const std::shared_ptr<capture_appender>& appender ) {
+      logger l( "capture", nullptr );
+      l.set_log_level( log_level::all );
+      l.add_appender( appender );
+      return l;
+   }
+
+}
+
+BOOST_AUTO_TEST_SUITE(log_context_test_suite)
+
+static_assert( fc::detail::file_basename_offset( "/a/b/file.cpp" ) == 5 );
+static_assert( fc::detail::file_basename_offset( "file.cpp" ) == 0 );
+
+BOOST_AUTO_TEST_CASE(file_and_method) try {
+   auto context = FC_LOG_CONTEXT( info );
+   BOOST_CHECK_EQUAL( context.get_file(), "test_log.cpp" );
+   BOOST_CHECK_EQUAL( context.get_method(), "test_method" );
+   BOOST_CHECK( context.get_file_view().data() == FC_LOG_FILE ); // not copied
+
+   log_context restored( context.to_variant() );
+   BOOST_CHECK_EQUAL( restored.get_file(), "test_log.cpp" );
+   BOOST_CHECK_EQUAL( restored.get_method(), "test_method" );
+   BOOST_CHECK_EQUAL( restored.to_string(), context.to_string() );
+
+   log_context full_path( log_level::info, "/some/dir/source.cpp", 1, "method" );
+   BOOST_CHECK_EQUAL( full_path.get_file(), "source.cpp" );
+
+   // strings that don't outlive the context are copied
+   auto file = std::make_unique<std::string>( "/tmp/generated.cpp" );
+   auto method = std::make_unique<std::string>( "generated" );
+   log_context copied( log_level::info, file->c_str(), 2, method->c_str() );
+   std::fill( file->begin(), file->end(), 'x' );
+   std::fill( method->begin(), method->end(), 'x' );
+   file.reset();
+   method.reset();
+   BOOST_CHECK_EQUAL( copied.get_file(), "generated.cpp" );
+   BOOST_CHECK_EQUAL( copied.get_method(), "generated" );
+   BOOST_CHECK_EQUAL( copied.get_method_view(), "generated" );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(format_from_char_array) try {
+   // a char array that isn't a literal, reused and then freed while messages made from it live on
+   auto buffer = std::make_unique<char[][32]>( 1 );
+   strcpy( buffer[0], "value ${v}" );
+   log_message first( FC_LOG_CONTEXT( info ), buffer[0], mutable_variant_object( "v", 1 ) );
+   BOOST_CHECK_EQUAL( first.get_message(), "value 1" );
+   strcpy( buffer[0], "other ${v}" );
+   log_message second( FC_LOG_CONTEXT( info ), buffer[0], mutable_variant_object( "v", 2 ) );
+   BOOST_CHECK_EQUAL( second.get_message(), "other 2" );
+   BOOST_CHECK_EQUAL( first.get_message(), "value 1" );
+   buffer.reset();
+   BOOST_CHECK_EQUAL( first.get_message(), "value 1" );
+   BOOST_CHECK_EQUAL( first.get_limited_message(), "value 1" );
+   std::string out;
+   second.append_message( out );
+   BOOST_CHECK_EQUAL( out, "other 2" );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(logger_test_suite)
+
+BOOST_AUTO_TEST_CASE(rate_limited) try {
+   auto appender = std::make_shared<capture_appender>();
+   auto l = capture_logger( appender );
+   auto log = [&]( int i ) { fc_wlog_rate( l, 10, "message ${i}", ("i", i) ); };
+
+   for( int i = 0; i < 1000; ++i )
+      log( i );
+   auto counts = count_messages( appender->messages );
+   BOOST_CHECK_GE( counts.first, 10u );
+   BOOST_CHECK_LE( counts.first, 20u ); // the loop may straddle a second
+   BOOST_CHECK_EQUAL( appender->messages.front(), "message 0" );
+
+   // the next second reports what the last one dropped
+   std::this_thread::sleep_for( std::chrono::milliseconds( 1100 ) );
+   log( 1000 );
+   counts = count_messages( appender->messages );
+   BOOST_CHECK_EQUAL( counts.first + counts.second, 1001u );
+   BOOST_CHECK_EQUAL( appender->messages.back(), "message 1000" );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(sampled) try {
+   auto appender = std::make_shared<capture_appender>();
+   auto l = capture_logger( appender );
+   auto log = [&]( int i ) { fc_ilog_every( l, 100, "message ${i}", ("i", i) ); };
+
+   for( int i = 0; i < 1000; ++i )
+      log( i );
+   auto counts = count_messages( appender->messages );
+   BOOST_CHECK_EQUAL( counts.first, 10u );
+   BOOST_CHECK_EQUAL( appender->messages.front(), "message 0" );
+   BOOST_CHECK_EQUAL( appender->messages.back(), "message 900" );
+
+   std::this_thread::sleep_for( std::chrono::milliseconds( 1100 ) );
+   for( int i = 1000; i <= 1100; ++i )
+      log( i );
+   counts = count_messages( appender->messages );
+   BOOST_CHECK_EQUAL( counts.first, 12u );
+   BOOST_CHECK_EQUAL( counts.first + counts.second, 1101u - 99u ); // 1001..1099 not reported yet
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(disabled_level) try {
+   auto appender = std::make_shared<capture_appender>();
+   auto l = capture_logger( appender );
+   l.set_log_level( log_level::error );
+   for( int i = 0; i < 10; ++i )
+      fc_dlog_every( l, 1, "message ${i}", ("i", i) );
+   BOOST_CHECK( appender->messages.empty() );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(suppressed_benchmark, * boost::unit_test::disabled()) try {
+   const int iterations = 10000000;
+   auto appender = std::make_shared<capture_appender>();
+   auto l = capture_logger( appender );
+   auto start = time_point::now();
+   for( int i = 0; i < iterations; ++i )
+      fc_ilog_every( l, 1000000, "message ${i}", ("i", i) );
+   auto sampled = time_point::now() - start;
+   start = time_point::now();
+   for( int i = 0; i < iterations; ++i )
+      fc_ilog_rate( l, 1, "message ${i}", ("i", i) );
+   auto limited = time_point::now() - start;
+   std::cerr << "suppressed message: sampled " << sampled.count() * 1000.0 / iterations << " ns, rate limited "
+             << limited.count() * 1000.0 / iterations << " ns\n";
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(console_appender_test_suite)
+
+BOOST_AUTO_TEST_CASE(line_format) try {
+   const auto path = boost::unit_test::framework::current_test_case().p_name.get() + ".log";
+   {
+      redirect_stdout redirect( path.c_str() );
+      console_appender appender( stdout_config() );
+      appender.log( FC_LOG_MESSAGE( warn, "hello ${who}", ("who", "world") ) );
+      appender.log( FC_LOG_MESSAGE( debug, "second" ) );
+   }
+   std::ifstream in( path );
+   std::string first, second;
+   std::getline( in, first );
+   std::getline( in, second );
+   unlink( path.c_str() );
+
+   // level(5) timestamp thread(9) file:line(29) method(20) ] message
+   BOOST_TEST_MESSAGE( first );
+   BOOST_REQUIRE_GT( first.size(), 95u );
+   BOOST_CHECK_EQUAL( first.substr( 0, 6 ), "warn  " );
+   auto now = string( time_point::now() );
+   BOOST_CHECK_EQUAL( first.substr( 6, 11 ), now.substr( 0, 11 ) ); // same day, no color codes for a file
+   BOOST_CHECK_EQUAL( first[6 + 23], ' ' );
+   BOOST_CHECK_EQUAL( first.substr( 40, 13 ), "test_log.cpp:" );
+   BOOST_CHECK_EQUAL( first.substr( 70, 20 ), "test_method         " );
+   BOOST_CHECK_EQUAL( first.substr( 91 ), "] hello world" );
+   BOOST_CHECK_EQUAL( second.substr( 0, 6 ), "debug " );
+   BOOST_CHECK_EQUAL( second.substr( 91 ), "] second" );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(application_output_order) try {
+   const auto path = boost::unit_test::framework::current_test_case().p_name.get() + ".log";
+   {
+      redirect_stdout redirect( path.c_str() );
+      console_appender appender( stdout_config() );
+      // still in the stdio buffer when the line is logged
+      printf( "printed before\n" );
+      std::cout << "streamed before\n";
+      appender.log( FC_LOG_MESSAGE( info, "logged" ) );
+      printf( "printed after\n" );
+
+      auto cfg = stdout_config();
+      cfg.flush = false;
+      console_appender unflushed( cfg );
+      unflushed.log( FC_LOG_MESSAGE( info, "logged unflushed" ) );
+   }
+   std::ifstream in( path );
+   std::vector<std::string> lines;
+   for( std::string line; std::getline( in, line ); ) lines.push_back( line );
+   unlink( path.c_str() );
+
+   BOOST_REQUIRE_EQUAL( lines.size(), 5u );
+   BOOST_CHECK_EQUAL( lines[0], "printed before" );
+   BOOST_CHECK_EQUAL( lines[1], "streamed before" );
+   BOOST_CHECK_EQUAL( lines[2].substr( 91 ), "] logged" );
+   BOOST_CHECK_EQUAL( lines[3], "printed after" );
+   BOOST_CHECK_EQUAL( lines[4].substr( 91 ), "] logged unflushed" );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(benchmark, * boost::unit_test::disabled()) try {
+   const int iterations = 1000000;
+   redirect_stdout redirect( "/dev/null" );
+   console_appender appender( stdout_config() );
+   auto start = time_point::now();
+   for( int i = 0; i < iterations; ++i )
+      appender.log( FC_LOG_MESSAGE( info, "benchmark message ${i} from ${who}", ("i", i)("who", "console_appender") ) );
+   auto elapsed = time_point::now() - start;
+   std::cerr << "console_appender: " << iterations * 1000000.0 / elapsed.count() << " lines/s, "
+             << elapsed.count() * 1000.0 / iterations << " ns/line\n";
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(gelf_appender_test_suite)
+
+BOOST_AUTO_TEST_CASE(udp_uncompressed) try {
+   boost::asio::io_service io;
+   udp::socket server( io, udp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+
+   {
+      gelf_appender appender( gelf_config( server.local_endpoint().port(), mutable_variant_object( "compress", false ) ) );
+      appender.initialize( io );
+      appender.log( FC_LOG_MESSAGE( warn, "hello ${who}", ("who", "world") ) );
+      appender.log( FC_LOG_MESSAGE( error, "quote \" and newline \n" ) );
+   } // destruction flushes the sender thread
+
+   auto datagrams = receive_datagrams( server, 2 );
+   BOOST_REQUIRE_EQUAL( datagrams.size(), 2u );
+
+   auto first = json::from_string( datagrams[0] ).get_object();
+   BOOST_CHECK_EQUAL( first["version"].as_string(), "1.1" );
+   BOOST_CHECK_EQUAL( first["host"].as_string(), "test" );
+   BOOST_CHECK_EQUAL( first["short_message"].as_string(), "hello world" );
+   BOOST_CHECK_EQUAL( first["level"].as_int64(), 4 );
+   BOOST_CHECK_EQUAL( first["_file"].as_string(), "test_log.cpp" );
+
+   auto second = json::from_string( datagrams[1] ).get_object();
+   BOOST_CHECK_EQUAL( second["short_message"].as_string(), "quote \" and newline \n" );
+   BOOST_CHECK_EQUAL( second["level"].as_int64(), 3 );
+   BOOST_CHECK_NE( first["_log_id"].as_string(), second["_log_id"].as_string() );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(udp_chunked) try {
+   boost::asio::io_service io;
+   udp::socket server( io, udp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+
+   const std::string long_text( 2000, 'x' );
+   {
+      gelf_appender appender( gelf_config( server.local_endpoint().port(),
+                                           mutable_variant_object( "compress", false )( "max_payload_size", 200 ) ) );
+      appender.initialize( io );
+      appender.log( FC_LOG_MESSAGE( info, "${text}", ("text", long_text) ) );
+   }
+
+   auto datagrams = receive_datagrams( server, 1 );
+   BOOST_REQUIRE( !datagrams.empty() );
+   const unsigned count = (unsigned char)datagrams[0][11];
+   BOOST_REQUIRE_GT( count, 1u );
+   auto rest = receive_datagrams( server, count - 1 );
+   datagrams.insert( datagrams.end(), rest.begin(), rest.end() );
+   BOOST_REQUIRE_EQUAL( datagrams.size(), count );
+
+   std::map<unsigned, std::string> chunks;
+   for( const auto& d : datagrams ) {
+      BOOST_REQUIRE_LE( d.size(), 200u );
+      BOOST_CHECK_EQUAL( (unsigned char)d[0], 0x1e );
+      BOOST_CHECK_EQUAL( (unsigned char)d[1], 0x0f );
+      BOOST_CHECK( d.compare( 2, 8, datagrams[0], 2, 8 ) == 0 ); // same message id
+      BOOST_CHECK_EQUAL( (unsigned char)d[11], count );
+      chunks[(unsigned char)d[10]] = d.substr( 12 );
+   }
+   std::string message;
+   for( const auto& c : chunks )
+      message += c.second;
+
+   BOOST_CHECK_EQUAL( json::from_string( message ).get_object()["short_message"].as_string(), long_text );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(udp_compressed) try {
+   boost::asio::io_service io;
+   udp::socket server( io, udp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+
+   {
+      gelf_appender appender( gelf_config( server.local_endpoint().port(), mutable_variant_object() ) );
+      appender.initialize( io );
+      appender.log( FC_LOG_MESSAGE( info, "compressed" ) );
+   }
+
+   auto datagrams = receive_datagrams( server, 1 );
+   BOOST_REQUIRE_EQUAL( datagrams.size(), 1u );
+   // zlib header as expected by graylog
+   BOOST_CHECK_EQUAL( (unsigned char)datagrams[0][0], 0x78 );
+   BOOST_CHECK_EQUAL( (unsigned char)datagrams[0][1], 0x9c );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(tcp_null_delimited) try {
+   boost::asio::io_service io;
+   tcp::acceptor acceptor( io, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+
+   const int message_count = 100;
+   {
+      gelf_appender appender( gelf_config( acceptor.local_endpoint().port(), mutable_variant_object( "transport", "tcp" ) ) );
+      appender.initialize( io );
+      for( int i = 0; i < message_count; ++i )
+         appender.log( FC_LOG_MESSAGE( info, "message ${i}", ("i", i) ) );
+   } // flushed and closed, the connection waits in the backlog
+
+   tcp::socket conn( io );
+   acceptor.accept( conn );
+   std::string received;
+   boost::system::error_code ec;
+   boost::asio::read( conn, boost::asio::dynamic_buffer( received ), ec );
+   BOOST_REQUIRE( ec == boost::asio::error::eof );
+
+   std::vector<std::string> messages;
+   size_t pos = 0;
+   for( size_t end; (end = received.find( '\0', pos )) != std::string::npos; pos = end + 1 )
+      messages.push_back( received.substr( pos, end - pos ) );
+   BOOST_CHECK_EQUAL( pos, received.size() );
+   BOOST_REQUIRE_EQUAL( messages.size(), message_count );
+   for( int i = 0; i < message_count; ++i )
+      BOOST_CHECK_EQUAL( json::from_string( messages[i] ).get_object()["short_message"].as_string(), "message " + std::to_string( i ) );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(tcp_write_timeout) try {
+   boost::asio::io_service io;
+   tcp::acceptor acceptor( io, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+
+   // a server that never reads: the socket buffers fill up and the write stalls until the timeout
+   const std::string filler( 100 * 1024, 'x' );
+   const auto start = time_point::now();
+   {
+      gelf_appender appender( gelf_config( acceptor.local_endpoint().port(),
+                                           mutable_variant_object( "transport", "tcp" )( "tcp_timeout_ms", 200 ) ) );
+      appender.initialize( io );
+      for( int i = 0; i < 500; ++i )
+         appender.log( FC_LOG_MESSAGE( info, "message ${f}", ("f", filler) ) );
+   }
+   BOOST_CHECK_LT( ( time_point::now() - start ).count(), 5000000 );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_SUITE_END()
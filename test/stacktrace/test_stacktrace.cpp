@@ -0,0 +1,115 @@
+#define BOOST_TEST_MODULE stacktrace
+// the benchmark compares against the addr2line backend
+#define BOOST_STACKTRACE_USE_ADDR2LINE
+#include <boost/test/included/unit_test.hpp>
+
+#include <fc/stacktrace.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/time.hpp>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+using namespace fc;
+
+namespace {
+
+   BOOST_NOINLINE stacktrace capture_here() {
+      return stacktrace();
+   }
+
+   std::atomic<int> parked_{ 0 };
+
+   BOOST_NOINLINE void parked_thread() {
+      ++parked_;
+      for( ;; ) ::pause();
+   }
+
+   int* volatile null_ = nullptr;
+
+   BOOST_NOINLINE void crash_here() {
+      *null_ = 1;
+   }
+
+   size_t count_of( const std::string& text, const std::string& what ) {
+      size_t n = 0;
+      for( auto pos = text.find( what ); pos != std::string::npos; pos = text.find( what, pos + 1 ) )
+         ++n;
+      return n;
+   }
+
+}
+
+BOOST_AUTO_TEST_SUITE(stacktrace_test_suite)
+
+BOOST_AUTO_TEST_CASE(detail_string_names_functions) try {
+   auto strace = capture_here();
+   auto detail = to_detail_string( strace );
+   BOOST_TEST_MESSAGE( detail );
+   BOOST_CHECK( detail.find( "capture_here" ) != std::string::npos );
+   BOOST_CHECK_EQUAL( count_of( detail, "\n" ), strace.size() );
+
+   // served from the cache the second time
+   BOOST_CHECK_EQUAL( to_detail_string( strace ), detail );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(crash_dump_covers_all_threads) try {
+   const fc::path dump = fc::temp_directory_path() / ( "fc_btrace_" + fc::to_string( int64_t( ::getpid() ) ) + ".dump" );
+   remove_btrace( dump );
+
+   auto child = ::fork();
+   BOOST_REQUIRE( child >= 0 );
+   if( child == 0 ) {
+      install_btrace_signal_handler( dump );
+      std::thread( parked_thread ).detach();
+      std::thread( parked_thread ).detach();
+      while( parked_ < 2 ) std::this_thread::yield();
+      crash_here();
+      ::_exit( 0 );
+   }
+
+   int status = 0;
+   BOOST_REQUIRE_EQUAL( ::waitpid( child, &status, 0 ), child );
+   BOOST_REQUIRE( WIFSIGNALED( status ) );
+   BOOST_CHECK_EQUAL( WTERMSIG( status ), SIGSEGV );
+
+   BOOST_REQUIRE( has_btrace( dump ) );
+   auto btrace = get_btrace( dump );
+   remove_btrace( dump );
+   BOOST_TEST_MESSAGE( btrace );
+
+   BOOST_CHECK_EQUAL( count_of( btrace, "Thread " ), 3u );
+   BOOST_CHECK_EQUAL( count_of( btrace, "crashed with signal " + fc::to_string( int64_t( SIGSEGV ) ) ), 1u );
+   BOOST_CHECK_EQUAL( count_of( btrace, "crash_here" ), 1u );
+   BOOST_CHECK_EQUAL( count_of( btrace, "parked_thread" ), 2u );
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(detail_string_benchmark, * boost::unit_test::disabled()) try {
+   auto strace = capture_here();
+
+   auto start = time_point::now();
+   boost::stacktrace::detail::to_string_impl_base<boost::stacktrace::detail::to_string_using_addr2line> addr2line;
+   for( auto& frame : strace.as_vector() )
+      addr2line( frame.address() );
+   auto elapsed = time_point::now() - start;
+   std::cerr << "addr2line, " << strace.size() << " frames: " << elapsed.count() / 1000.0 << " ms\n";
+
+   start = time_point::now();
+   to_detail_string( strace );
+   elapsed = time_point::now() - start;
+   std::cerr << "to_detail_string, first trace: " << elapsed.count() / 1000.0 << " ms\n";
+
+   const int iterations = 10000;
+   start = time_point::now();
+   for( int i = 0; i < iterations; ++i )
+      to_detail_string( strace );
+   elapsed = time_point::now() - start;
+   std::cerr << "to_detail_string, cached: " << elapsed.count() * 1.0 / iterations << " us\n";
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,7 +3,10 @@
 
 #include <fc/variant_object.hpp>
 #include <fc/exception/exception.hpp>
+#include <fc/time.hpp>
 
+#include <cstring>
+#include <iostream>
 #include <string>
 
 using namespace fc;
@@ -31,4 +34,83 @@ BOOST_AUTO_TEST_CASE(mutable_variant_object_test)
   FC_LOG_AND_RETHROW();
 }
 
+BOOST_AUTO_TEST_CASE(format_string_test)
+{
+  try {
+    variant_object args = mutable_variant_object( "a", 1 )( "b", "bee" )( "neg", -5 )( "t", true )
+                             ( "big", uint64_t(18446744073709551615ull) )( "obj", mutable_variant_object( "x", 1 ) );
+    const std::pair<const char*, std::string> cases[] = {
+       { "", "" },
+       { "plain", "plain" },
+       { "${a}", "1" },
+       { "x${a}y${b}z", "x1ybeez" },
+       { "cost $5", "cost 5" },
+       { "${missing}", "${missing}" },
+       { "${a", "{a" },
+       { "a${}b", "a${}b" },
+       { "$$", "$" },
+       { "${a}${a}", "11" },
+       { "}${b}{", "}bee{" },
+       { "${neg} ${big} ${t} ${obj}", "-5 18446744073709551615 true {\"x\":1}" },
+       { "a$", std::string( "a\0", 2 ) },
+    };
+    for( const auto& c : cases ) {
+      BOOST_CHECK_EQUAL( format_string( c.first, args ), c.second );
+      std::string out = "prefix ";
+      append_format_string( out, c.first, strlen( c.first ), args );
+      append_format_string( out, c.first, strlen( c.first ), args ); // cached the second time
+      BOOST_CHECK_EQUAL( out, "prefix " + c.second + c.second );
+    }
+
+    // arguments in a different order than last time
+    std::string out;
+    append_format_string( out, "${b}${a}", 8, mutable_variant_object( "a", 2 )( "b", 3 ) );
+    append_format_string( out, "${b}${a}", 8, mutable_variant_object( "b", 4 )( "a", 5 ) );
+    BOOST_CHECK_EQUAL( out, "3245" );
+
+    // same address, different string
+    char buffer[16] = "${a}";
+    out.clear();
+    append_format_string( out, buffer, strlen( buffer ), args );
+    strcpy( buffer, "${b}" );
+    append_format_string( out, buffer, strlen( buffer ), args );
+    BOOST_CHECK_EQUAL( out, "1bee" );
+
+    // minimize leaves out objects and cuts long strings
+    BOOST_CHECK_EQUAL( format_string( "${obj} ${b}", args, true ), "${obj} bee" );
+    auto limited = format_string( "${s}", mutable_variant_object( "s", std::string( 1000, 'z' ) ), true );
+    BOOST_CHECK_EQUAL( limited, std::string( 256, 'z' ) + "..." );
+    limited = format_string( std::string( 2000, 'q' ) + "${a}", args, true );
+    BOOST_CHECK_EQUAL( limited, std::string( 1024, 'q' ) + "..." );
+  }
+  FC_LOG_AND_RETHROW();
+}
+
+BOOST_AUTO_TEST_CASE(format_string_benchmark, * boost::unit_test::disabled())
+{
+  const int iterations = 1000000;
+  variant_object args = mutable_variant_object( "block", 123456 )( "producer", "producer.name" )( "count", 42 );
+  const char* format = "Produced block ${block} by ${producer}, ${count} transactions, ${missing} here";
+  const size_t size = strlen( format );
+
+  auto start = time_point::now();
+  size_t total = 0;
+  for( int i = 0; i < iterations; ++i )
+    total += format_string( format, args ).size();
+  auto plain = time_point::now() - start;
+
+  start = time_point::now();
+  std::string out;
+  for( int i = 0; i < iterations; ++i ) {
+    out.clear();
+    append_format_string( out, format, size, args );
+    total -= out.size();
+  }
+  auto cached = time_point::now() - start;
+  BOOST_CHECK_EQUAL( total, 0u );
+
+  std::cerr << "format_string:        " << plain.count() * 1000.0 / iterations << " ns/call\n"
+            << "append_format_string: " << cached.count() * 1000.0 / iterations << " ns/call (cached)\n";
+}
+
 BOOST_AUTO_TEST_SUITE_END()